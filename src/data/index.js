@@ -211,6 +211,11 @@ SP.init = function(options = {}) {
     return this;
 };
 
+// true once init() fell back to the in-memory store
+SP.isLocal = function() {
+    return local !== null;
+};
+
 SP.runQueue = function() {
     if (this.queue.length > 0) {
         let i = 0, q = this.queue, e;
@@ -1,35 +1,83 @@
 /** Copyright Stewart Allen -- All Rights Reserved */
 
+import { base } from './base.js';
+import { tpmsSlice } from './wasm.js';
+
 const PI2 = Math.PI * 2;
 
-let cache = {};
-let lastVal;
-let lastRes = 0;
-let lastSlice = 0;
+// triply periodic surfaces by name. values are the native type ids
+const TYPES = {
+    gyroid: 0,
+    schwarz: 1,
+    diamond: 2
+};
+
+const FIELD = {
+    gyroid: (x, y, z) => Math.sin(x) * Math.cos(y) + Math.sin(y) * Math.cos(z) + Math.sin(z) * Math.cos(x),
+    schwarz: (x, y, z) => Math.cos(x) + Math.cos(y) + Math.cos(z),
+    diamond: (x, y, z) =>
+        Math.sin(x) * Math.sin(y) * Math.sin(z) + Math.sin(x) * Math.cos(y) * Math.cos(z) +
+        Math.cos(x) * Math.sin(y) * Math.cos(z) + Math.cos(x) * Math.cos(y) * Math.sin(z)
+};
+
+// contoured layers survive across slices. least recently used go first
+const cacheMax = 2000;
+const cache = new Map();
 
 /**
  * @param off {number} z offset value from 0-1
  * @param res {number} resolution (pixels/slices per side)
+ * @param val {number} contour at +/- this field value
+ * @param type {string} gyroid, schwarz or diamond
  */
-export function slice(off, res, val) {
-    // auto clear cach if it hasn't been hit in the last 20 seconds
-    // or the requested resolution or tip values have changed
-    let now = Date.now();
-    if (res !== lastRes || val !== lastVal || now - lastSlice > 20000) {
-        cache = {};
-    }
-    lastVal = val;
-    lastRes = res;
-    lastSlice = now;
+export function slice(off, res, val, type) {
+    return sliceAll([ off ], res, val, type)[0];
+}
+
+/**
+ * contour every layer not already cached in one batch
+ *
+ * @param offs {number[]} z offset values from 0-1
+ * @returns {Object[]} { points, dir, polys } for each offset
+ */
+export function sliceAll(offs, res, val, type = 'gyroid') {
     let rez = parseInt(res || 200);
-    let inc = PI2 / rez;
-    let z = PI2 * off;
-    let key = (z % PI2).round(3);
-    let hit = cache[key];
-    if (hit) {
+    let tip = val || 0;
+    let zs = offs.map(off => ((PI2 * off) % PI2).round(3));
+    let keys = zs.map(z => `${type}/${rez}/${tip}/${z}`);
+    let missing = new Map();
+    keys.forEach((key, i) => {
+        if (!cache.has(key)) missing.set(key, zs[i]);
+    });
+    if (missing.size && base.wasm?.fn.tpms) {
+        let layers = tpmsSlice(TYPES[type] ?? 0, rez, [...missing.values()].map(z => z / PI2), tip);
+        [...missing.keys()].forEach((key, i) => {
+            let { lr, td, polys } = layers[i];
+            remember(key, { points: lr + td, dir: td > lr ? 'lr' : 'td', polys });
+        });
+    } else {
+        for (let [ key, z ] of missing) {
+            remember(key, sliceField(z, rez, tip, FIELD[type] || FIELD.gyroid));
+        }
+    }
+    return keys.map(key => {
+        let hit = cache.get(key);
+        cache.delete(key);
+        cache.set(key, hit);
         return hit;
+    });
+}
+
+function remember(key, slice) {
+    cache.set(key, slice);
+    if (cache.size > cacheMax) {
+        cache.delete(cache.keys().next().value);
     }
-    let tip = val || 0;
+}
+
+// contour a field in js when the native module is not loaded
+function sliceField(z, rez, tip, field) {
+    let inc = PI2 / rez;
     let edge = [];
     let vals = [];
     let points = 0;
@@ -42,11 +90,7 @@ export function slice(off, res, val) {
         vals.push(vrow);
         for (let y=0; y<PI2; y += inc) {
             erow.push(0);
-            vrow.push(
-                Math.sin(x) * Math.cos(y) +
-                Math.sin(y) * Math.cos(z) +
-                Math.sin(z) * Math.cos(x)
-            );
+            vrow.push(field(x, y, z));
         }
     }
 
@@ -158,9 +202,7 @@ export function slice(off, res, val) {
         .map(poly => filter(poly, 0))
         .map(poly => filter(poly, inc));
 
-    let slice = {edge, points, dir, polys: psimple};
-    cache[key] = slice;
-    return slice;
+    return {edge, points, dir, polys: psimple};
 }
 
 // merge co-linear and distance threshold
@@ -11,6 +11,7 @@ import { newPolygon } from '../geo/polygon.js';
 import { polygons } from '../geo/polygons.js';
 import { newPoint } from '../geo/point.js';
 import { config } from '../geo/base.js';
+import { meshSlice } from '../geo/wasm.js';
 
 const epsilon = 10e-5;
 
@@ -125,19 +126,25 @@ export async function slice(points, options = {}) {
     // allow zGen to override or update zIndexes
     // FDM, CAM, Laser slicers will use this to align or interpolate layers
     if (zGen) {
-        zIndexes = zGen({ zMin, zMax, zLine, zFlat, zIndexes, options });
+        zIndexes = zGen({ zMin, zMax, zLine, zFlat, zIndexes, points, options });
     }
 
     // ensure bucket aligmnent
     zIndexes = zIndexes.map(v => v.round(3));
 
+    // raw contours from an earlier slice of the same mesh and layers
+    let cache = options.cache;
+    let cached = cache ? await cache.get(zIndexes) : undefined;
+
     /**
      * bucket polygons into z-bounded groups (inside or crossing)
      * to reduce the search space in complex models
      */
     let zSpan = zMax - zMin;
     let zSpanAvg = zSum / points.length;
-    let bucketCount = options.bucket !== false ?
+    // sliceZ() sweeps triangles in z on both of its paths, wherever it
+    // runs, so buckets would only add copies. other slicers are bucketed
+    let bucketCount = options.bucket !== false && sliceFn !== sliceZ && !cached ?
         Math.min(bucketMax, Math.max(1, Math.floor(zSpan / zSpanAvg))) : 1;
 
     zScale = 1 / (zMax / bucketCount);
@@ -209,7 +216,7 @@ export async function slice(points, options = {}) {
     async function sliceBuckets() {
         let output = [];
         let count = 0;
-        let opt = { ...options, zMin, zMax, zIndexes };
+        let opt = { ...options, zMin, zMax, zIndexes, cached, raw: cache && !cached };
         let ps = [];
 
         for (let i = 0, l = buckets.length; i < l; i++) {
@@ -235,6 +242,13 @@ export async function slice(points, options = {}) {
     let slices = sliceFn ? await sliceBuckets() : [];
     slices = slices.sort((a,b) => a.z - b.z);
 
+    if (cache && !cached) {
+        cache.put(zIndexes, packSlices(slices));
+        for (let slice of slices) {
+            delete slice.raw;
+        }
+    }
+
     return { slices, points, zMin, zMax, zIndexes, zFlat };
 }
 
@@ -318,10 +332,19 @@ export function makeZLine(phash, p1, p2, coplanar, edge) {
  */
 export async function sliceZ(z, points, options = {}) {
     if (Array.isArray(z)) {
-        return Promise.all(z.map(z => sliceZ(z, points, options)));
+        if (options.cached) {
+            return sliceCached(z, options);
+        }
+        let native = sliceNative(z, points, options);
+        if (native) {
+            return native;
+        }
+        return sliceSweep(z, toPoints(points), options);
     }
 
-    let { zMin, zMax, under, over, both, each } = options,
+    points = toPoints(points);
+
+    let { zMin, zMax, under, over, both } = options,
         groupFn = dval(options.groupr, both ? null : sliceConnect),
         phash = {},
         lines = [],
@@ -380,7 +403,67 @@ export async function sliceZ(z, points, options = {}) {
 
     let rval = { z, lines };
     if (groupFn) {
-        let groups = groupFn(lines, options);
+        rval.groups = groupFn(lines, options);
+    }
+
+    return sliceFinish(rval, options);
+}
+
+/**
+ * slice at every z in JS. like the native slicer the layers are swept in
+ * ascending z over the triangles spanning the current z so each layer
+ * only tests those. this takes the place of bucketing in slice() for
+ * whichever thread ends up running the JS path. results are in zs order
+ * while options.each() sees them in ascending z
+ *
+ * @param {number[]} zs slice heights
+ * @param {Point[]} points triangle vertices
+ * @param {Object} options slicing parameters
+ * @returns {Promise<Object[]>}
+ */
+function sliceSweep(zs, points, options) {
+    let count = points.length / 3,
+        order = new Array(count),
+        lo = new Float64Array(count),
+        hi = new Float64Array(count),
+        pad = config.precision_slice_z + 0.001,
+        layers = zs.map((z, i) => i).sort((a, b) => zs[a] - zs[b]),
+        output = new Array(zs.length),
+        active = [],
+        next = 0;
+    for (let t = 0, i = 0; t < count; t++) {
+        let z1 = points[i++].z, z2 = points[i++].z, z3 = points[i++].z;
+        lo[t] = Math.min(z1, z2, z3);
+        hi[t] = Math.max(z1, z2, z3);
+        order[t] = t;
+    }
+    order.sort((a, b) => lo[a] - lo[b]);
+    for (let l of layers) {
+        let z = zs[l], tris = [];
+        while (next < count && lo[order[next]] <= z + pad) {
+            active.push(order[next++]);
+        }
+        active = active.filter(t => hi[t] >= z - pad);
+        for (let t of active) {
+            tris.push(points[t * 3], points[t * 3 + 1], points[t * 3 + 2]);
+        }
+        output[l] = sliceZ(z, tris, options);
+    }
+    return Promise.all(output);
+}
+
+/**
+ * apply the xor, union and driver post-processing options to the
+ * grouped polygons of a slice then hand it to options.each()
+ *
+ * @param {Object} rval slice record with z and groups
+ * @param {Object} options slicing parameters
+ * @returns {Object} rval
+ */
+function sliceFinish(rval, options) {
+    let { each } = options;
+    let { groups } = rval;
+    if (groups) {
         if (options.xor) {
             groups = polygons.xor(groups);
         }
@@ -408,6 +491,11 @@ export async function sliceZ(z, points, options = {}) {
         rval.groups = groups;
     }
 
+    // raw contours for the slice cache are taken before post-processing
+    if (options.raw && rval.groups) {
+        rval.raw = packGroups(rval.groups);
+    }
+
     // look for driver-specific slice post-processor
     if (options.post) {
         let fn = slicer.slicePost[options.post];
@@ -442,6 +530,206 @@ export async function sliceZ(z, points, options = {}) {
     return rval;
 }
 
+/**
+ * slice a bucket at every z in the native slicer of the wasm geometry
+ * module. open paths it could not bridge are dropped as in sliceConnect().
+ * lines are the raw segments, one per cut triangle. duplicates are gone
+ * but collinear runs are not merged as removeDuplicateLines() does on the
+ * JS path, so there are more of them. returns undefined when the module
+ * is not loaded or the options need a custom grouping so the caller falls
+ * back to sliceZ()
+ *
+ * @param {number[]} zs slice heights
+ * @param {Point[]|Float32Array} points triangle vertices
+ * @param {Object} options slicing parameters
+ * @returns {Object[]|undefined}
+ */
+function sliceNative(zs, points, options) {
+    let { under, over, noEmpty } = options;
+    if (!nativeSlicing(options)) {
+        return;
+    }
+    if (!under) over = true;
+    let output = [];
+    for (let rec of meshSlice(points, zs, {
+        over,
+        under,
+        zMin: options.zMin,
+        zMax: options.zMax,
+        clean: options.dirty ? 0 : undefined
+    })) {
+        // empty layers stay in place as undefined like the JS path
+        if (rec.lines.length === 0 && noEmpty) {
+            output.push(undefined);
+            continue;
+        }
+        let rval = { z: rec.z, groups: rec.closed };
+        // built on first use since only xray and debug views read them
+        Object.defineProperty(rval, 'lines', {
+            configurable: true,
+            enumerable: true,
+            get() {
+                let lines = zLines(rec);
+                Object.defineProperty(rval, 'lines', { value: lines, writable: true, configurable: true, enumerable: true });
+                return lines;
+            }
+        });
+        output.push(sliceFinish(rval, options));
+    }
+    return output;
+}
+
+// native segments as ordered lines. not merged: the points are rounded to
+// clipper units, which moves near collinear joints either side of the
+// isCollinear() tolerance, so a merge would not give the JS lines anyway
+function zLines(rec) {
+    let { z, lines } = rec, phash = {}, factor = config.clipper;
+    return lines.map(([x1, y1, x2, y2, edge]) => makeZLine(phash,
+        newPoint(x1 / factor, y1 / factor, z),
+        newPoint(x2 / factor, y2 / factor, z),
+        false, edge ? true : false));
+}
+
+/**
+ * rebuild slices from cached raw contours and run only the driver
+ * post-processing. layers not in the cache were empty when stored
+ *
+ * @param {number[]} zs slice heights
+ * @param {Object} options slicing parameters with cached buffer
+ * @returns {Object[]}
+ */
+function sliceCached(zs, options) {
+    let layers = readSlices(options.cached);
+    let opt = { ...options, xor: false, union: false };
+    let output = [];
+    for (let z of zs) {
+        let layer = layers.get(z);
+        if (layer) {
+            let { ints, changes } = layer;
+            output.push(sliceFinish({
+                z,
+                groups: unpackGroups(ints, z),
+                changes: changes || undefined
+            }, opt));
+        }
+    }
+    return output;
+}
+
+/**
+ * pack flat polygons into int32 words: polygon count then per polygon
+ * the point count and x,y pairs scaled by config.clipper
+ *
+ * @param {Polygon[]} groups
+ * @returns {Int32Array}
+ */
+export function packGroups(groups) {
+    let factor = config.clipper;
+    let words = 1;
+    for (let poly of groups) {
+        words += 1 + poly.length * 2;
+    }
+    let ints = new Int32Array(words);
+    let pos = 0;
+    ints[pos++] = groups.length;
+    for (let poly of groups) {
+        ints[pos++] = poly.length;
+        for (let point of poly.points) {
+            ints[pos++] = (point.x * factor) | 0;
+            ints[pos++] = (point.y * factor) | 0;
+        }
+    }
+    return ints;
+}
+
+/**
+ * @param {Int32Array} ints words from packGroups()
+ * @param {number} z
+ * @returns {Polygon[]}
+ */
+export function unpackGroups(ints, z) {
+    let factor = config.clipper;
+    let groups = [];
+    for (let pos = 1, count = ints[0]; count-- > 0; ) {
+        let poly = newPolygon();
+        for (let points = ints[pos++]; points-- > 0; pos += 2) {
+            poly.add(ints[pos] / factor, ints[pos + 1] / factor, z);
+        }
+        groups.push(poly);
+    }
+    return groups;
+}
+
+/**
+ * binary slice cache layout. 4 byte words, little endian:
+ * magic 'KSC1', layer count, then per layer a 20 byte entry of
+ * float64 z, int32 heal changes, word offset and word count of the
+ * packed contours which follow. contours are read in place
+ *
+ * @param {Object[]} slices with z, raw (packGroups) and changes
+ * @returns {ArrayBuffer}
+ */
+export function packSlices(slices) {
+    slices = slices.filter(slice => slice.raw);
+    let table = 2 + slices.length * 5;
+    let words = table;
+    for (let slice of slices) {
+        words += slice.raw.length;
+    }
+    let buffer = new ArrayBuffer(words * 4);
+    let view = new DataView(buffer);
+    let ints = new Int32Array(buffer);
+    view.setUint32(0, 0x3143534b, true);
+    view.setUint32(4, slices.length, true);
+    for (let i = 0, at = 8, pos = table; i < slices.length; i++, at += 20) {
+        let { z, raw, changes } = slices[i];
+        view.setFloat64(at, z, true);
+        view.setInt32(at + 8, changes || 0, true);
+        view.setUint32(at + 12, pos, true);
+        view.setUint32(at + 16, raw.length, true);
+        ints.set(raw, pos);
+        pos += raw.length;
+    }
+    return buffer;
+}
+
+/**
+ * @param {ArrayBuffer} buffer from packSlices()
+ * @returns {Map} z to { ints, changes } with ints a view into buffer
+ */
+export function readSlices(buffer) {
+    let view = new DataView(buffer);
+    let layers = new Map();
+    if (view.getUint32(0, true) !== 0x3143534b) {
+        return layers;
+    }
+    for (let i = 0, count = view.getUint32(4, true), at = 8; i < count; i++, at += 20) {
+        layers.set(view.getFloat64(at, true), {
+            changes: view.getInt32(at + 8, true),
+            ints: new Int32Array(buffer, view.getUint32(at + 12, true) * 4, view.getUint32(at + 16, true))
+        });
+    }
+    return layers;
+}
+
+// true when sliceZ() will hand a bucket to the native slicer
+function nativeSlicing(options) {
+    let { both, debug, groupr } = options;
+    return base.wasm?.fn.slice && !both && !debug && groupr === undefined ? true : false;
+}
+
+// minions receive vertices as flat x,y,z floats
+function toPoints(points) {
+    if (!(points instanceof Float32Array)) {
+        return points;
+    }
+    let i = 0, p = 0, realp = new Array(points.length / 3);
+    while (i < points.length) {
+        realp[p++] = newPoint(points[i++], points[i++], points[i++]).round(3);
+    }
+    return realp;
+}
+
 /**
  * Given an array of input lines (line soup), find the path through
  * joining line ends that encompasses the greatest area without self
@@ -12,7 +12,13 @@ export const wasm_ctrl = {
     count: {
         offset: 0,
         union: 0,
-        diff: 0
+        diff: 0,
+        slice: 0,
+        layers: 0,
+        flats: 0,
+        tpms: 0,
+        fill: 0,
+        solids: 0
     }
 };
 
@@ -54,6 +60,8 @@ function writePoly(view, poly, inner) {
 function readPoly(view, z) {
     let points = view.readU16(true);
     if (points === 0) return;
+    // long paths escape to a 32 bit count
+    if (points === 0xffff) points = view.readU32(true);
     let poly = newPolygon();
     while (points-- > 0) {
         poly.add(view.readI32(true)/factor, view.readI32(true)/factor, z || 0);
@@ -73,13 +81,21 @@ function readPolys(view, z, out = []) {
     return out;
 }
 
+// memory may grow during any call which detaches views on the old buffer
+function heapView(wasm) {
+    if (wasm.heap.buffer !== wasm.memory.buffer) {
+        wasm.heap = new DataView(wasm.memory.buffer);
+    }
+    return wasm.heap;
+}
+
 export function polyOffset(polys, offset, z, clean, simple) {
     wasm_ctrl.count.offset++;
     let wasm = base.wasm,
         buffer = wasm.shared,
-        pcount = writePolys(new DataWriter(wasm.heap, buffer), polys),
+        pcount = writePolys(new DataWriter(heapView(wasm), buffer), polys),
         resat = wasm.fn.offset(buffer, pcount, offset * factor, clean, simple),
-        out = readPolys(new DataReader(wasm.heap, resat), z);
+        out = readPolys(new DataReader(heapView(wasm), resat), z);
     return polyNest(out);
 }
 
@@ -87,9 +103,9 @@ export function polyUnion(polys, z) {
     wasm_ctrl.count.union++;
     let wasm = base.wasm,
         buffer = wasm.shared,
-        pcount = writePolys(new DataWriter(wasm.heap, buffer), polys),
+        pcount = writePolys(new DataWriter(heapView(wasm), buffer), polys),
         resat = wasm.fn.union(buffer, pcount),
-        out = readPolys(new DataReader(wasm.heap, resat), z);
+        out = readPolys(new DataReader(heapView(wasm), resat), z);
     return polyNest(out);
 }
 
@@ -97,11 +113,11 @@ export function polyDiff(polysA, polysB, z, AB, BA) {
     wasm_ctrl.count.diff++;
     let wasm = base.wasm,
         buffer = wasm.shared,
-        writer = new DataWriter(wasm.heap, buffer),
+        writer = new DataWriter(heapView(wasm), buffer),
         pcountA = writePolys(writer, polysA),
         pcountB = writePolys(writer, polysB),
         resat = wasm.fn.diff(buffer, pcountA, pcountB, AB?1:0, BA?1:0, config.clipperClean),
-        reader = new DataReader(wasm.heap, resat);
+        reader = new DataReader(heapView(wasm), resat);
     if (AB) {
         AB.appendAll(polyNest(readPolys(reader, z)));
     }
@@ -110,6 +126,278 @@ export function polyDiff(polysA, polysB, z, AB, BA) {
     }
 }
 
+/**
+ * slice a triangle soup at each z. points are Point triples or a flat
+ * x,y,z Float32Array. returns { z, lines, closed, open } for each z where
+ * lines are the de-duplicated segments as [x1, y1, x2, y2, edge] ints
+ * in clipper units, closed are cleaned polygons (including open paths
+ * bridged under opt.bridge) and open the rest
+ */
+export function meshSlice(points, zs, opt = {}) {
+    wasm_ctrl.count.slice++;
+    let wasm = base.wasm,
+        flat = points instanceof Float32Array,
+        count = flat ? points.length / 9 : points.length / 3,
+        zat = wasm.malloc(zs.length * 8 + count * 36),
+        vat = zat + zs.length * 8,
+        verts = new Float32Array(wasm.memory.buffer, vat, count * 9);
+    new Float64Array(wasm.memory.buffer, zat, zs.length).set(zs);
+    if (flat) {
+        verts.set(points);
+    } else {
+        for (let i = 0, j = 0; i < points.length; i++) {
+            let p = points[i];
+            verts[j++] = p.x;
+            verts[j++] = p.y;
+            verts[j++] = p.z;
+        }
+    }
+    let resat = wasm.fn.slice(
+            vat, count, zat, zs.length,
+            (opt.over ? 1 : 0) | (opt.under ? 2 : 0),
+            opt.zMin ?? NaN, opt.zMax ?? NaN,
+            config.precision_slice_z,
+            opt.bridge ?? config.bridgeLineGapDistanceMax,
+            opt.clean ?? config.clipperClean
+        ),
+        reader = new DataReader(heapView(wasm), resat + 4),
+        out = zs.map(z => {
+            let lines = new Array(reader.readU32(true));
+            for (let i = 0; i < lines.length; i++) {
+                lines[i] = [
+                    reader.readI32(true), reader.readI32(true),
+                    reader.readI32(true), reader.readI32(true),
+                    reader.readU32(true)
+                ];
+            }
+            return {
+                z,
+                lines,
+                closed: readPolys(reader, z),
+                open: readPolys(reader, z)
+            };
+        });
+    wasm.free(resat);
+    wasm.free(zat);
+    return out;
+}
+
+/**
+ * facet slope histogram of a mesh along z for meshLayers(). points are
+ * Point triples or a flat x,y,z Float32Array. opt holds zMin, zMax and
+ * hmin which sets the bin height. returns { zMin, zMax, bin, nbins, hist }
+ * where hist holds 3 floats per bin. it depends only on the mesh and
+ * these so callers may keep it to re-plan with other heights or cusp
+ */
+export function meshZHist(points, opt) {
+    let { zMin, zMax, hmin } = opt,
+        wasm = base.wasm,
+        flat = points instanceof Float32Array,
+        count = flat ? points.length / 9 : points.length / 3,
+        bin = hmin / 4,
+        nbins = Math.min(1 << 20, Math.max(1, Math.ceil((zMax - zMin) / bin))),
+        vat = wasm.malloc(count * 36 + nbins * 12),
+        hat = vat + count * 36,
+        verts = new Float32Array(wasm.memory.buffer, vat, count * 9);
+    bin = (zMax - zMin) / nbins;
+    if (flat) {
+        verts.set(points);
+    } else {
+        for (let i = 0, j = 0; i < points.length; i++) {
+            let p = points[i];
+            verts[j++] = p.x;
+            verts[j++] = p.y;
+            verts[j++] = p.z;
+        }
+    }
+    wasm.exports.mesh_zhist(vat, count, zMin, bin, nbins, hat);
+    let hist = new Float32Array(wasm.memory.buffer, hat, nbins * 3).slice();
+    wasm.free(vat);
+    return { zMin, zMax, bin, nbins, hist };
+}
+
+/**
+ * plan adaptive layers for a mesh from its facet slopes. points are
+ * Point triples or a flat x,y,z Float32Array. opt holds zMin, zMax,
+ * hmin, hmax, the first layer height h0 and the max cusp error. a
+ * meshZHist() result for the same zMin, zMax and hmin in opt.hist skips
+ * the pass over the mesh. returns { tops, heights } bottom up
+ */
+export function meshLayers(points, opt) {
+    wasm_ctrl.count.layers++;
+    let { hmin, hmax, h0, cusp } = opt,
+        { zMin, zMax, bin, nbins, hist } = opt.hist || meshZHist(points, opt),
+        wasm = base.wasm,
+        outmax = Math.ceil((zMax - zMin) / hmin) + 2,
+        hat = wasm.malloc(nbins * 12 + outmax * 8),
+        oat = hat + nbins * 12;
+    new Float32Array(wasm.memory.buffer, hat, nbins * 3).set(hist);
+    let layers = wasm.exports.mesh_zplan(hat, nbins, zMin, zMax, bin, hmin, hmax, h0 || 0, cusp, oat, outmax),
+        out = new Float32Array(wasm.memory.buffer, oat, layers * 2),
+        tops = [],
+        heights = [];
+    for (let i = 0; i < layers; i++) {
+        tops.push(out[i * 2].round(3));
+        heights.push(out[i * 2 + 1].round(3));
+    }
+    wasm.free(hat);
+    return { tops, heights };
+}
+
+/**
+ * horizontal regions of a mesh and the outline change between layers.
+ * points are Point triples or a flat x,y,z Float32Array. zs ascending.
+ * returns { flats, gaps } where flats are { z, up, polys } for regions
+ * facing up (up true) or down and gaps[i] is the largest horizontal
+ * run of a sloped facet between zs[i-1] and zs[i]
+ */
+export function meshFlats(points, zs) {
+    wasm_ctrl.count.flats++;
+    let wasm = base.wasm,
+        flat = points instanceof Float32Array,
+        count = flat ? points.length / 9 : points.length / 3,
+        zat = wasm.malloc(zs.length * 12 + count * 36),
+        gat = zat + zs.length * 8,
+        vat = gat + zs.length * 4,
+        verts = new Float32Array(wasm.memory.buffer, vat, count * 9);
+    new Float64Array(wasm.memory.buffer, zat, zs.length).set(zs);
+    if (flat) {
+        verts.set(points);
+    } else {
+        for (let i = 0, j = 0; i < points.length; i++) {
+            let p = points[i];
+            verts[j++] = p.x;
+            verts[j++] = p.y;
+            verts[j++] = p.z;
+        }
+    }
+    let resat = wasm.fn.flats(vat, count, zat, zs.length, gat),
+        gaps = [...new Float32Array(wasm.memory.buffer, gat, zs.length)],
+        reader = new DataReader(heapView(wasm), resat + 4),
+        flats = [];
+    for (let i = 0, regions = reader.readU32(true); i < regions; i++) {
+        let z = reader.readF32(true).round(3),
+            up = reader.readI32(true) > 0,
+            polys = polyNest(readPolys(reader, z));
+        flats.push({ z, up, polys });
+    }
+    wasm.free(resat);
+    wasm.free(zat);
+    return { flats, gaps };
+}
+
+/**
+ * contour a triply periodic minimal surface (0 gyroid, 1 schwarz p,
+ * 2 diamond) sampled rez times per side for each z in zs, given as a
+ * fraction of the period. returns { lr, td, polys } for each z where
+ * polys are { x, y } arrays in tile units and lr / td count the field
+ * crossings along x and y
+ */
+export function tpmsSlice(type, rez, zs, tip = 0) {
+    wasm_ctrl.count.tpms++;
+    let wasm = base.wasm,
+        zat = wasm.malloc(zs.length * 8);
+    new Float64Array(wasm.memory.buffer, zat, zs.length).set(zs);
+    let resat = wasm.fn.tpms(type, rez, zat, zs.length, tip),
+        reader = new DataReader(heapView(wasm), resat + 4),
+        out = zs.map(() => {
+            let lr = reader.readU32(true),
+                td = reader.readU32(true),
+                polys = [];
+            for (;;) {
+                let points = reader.readU16(true);
+                if (points === 0) break;
+                if (points === 0xffff) points = reader.readU32(true);
+                let poly = [];
+                while (points-- > 0) {
+                    poly.push({ x: reader.readI32(true) / 100000, y: reader.readI32(true) / 100000 });
+                }
+                polys.push(poly);
+            }
+            return { lr, td, polys };
+        });
+    wasm.free(resat);
+    wasm.free(zat);
+    return out;
+}
+
+/**
+ * generate a fill pattern (kiri-geo FILL_* id) and clip it to each
+ * layer in one pass. layers are { z, index, polys } where polys are the
+ * nested fill regions. opt carries bounds { min, max }, lineWidth,
+ * spacing, density, repeat and for periodic surfaces tile and rez.
+ * a missing repeat stays NaN so linear and cubic match the js fill.
+ * returns an array of open polylines for each layer
+ */
+export function fillSparse(type, layers, opt) {
+    wasm_ctrl.count.fill++;
+    let wasm = base.wasm,
+        { bounds, lineWidth, spacing, density, repeat, tile, rez } = opt,
+        size = 80;
+    for (let layer of layers) {
+        size += 16;
+        for (let poly of layer.polys) {
+            size += (poly.deepLength + (poly.inner?.length || 0) + 1) * 8;
+        }
+    }
+    let paramsat = wasm.malloc(size),
+        memat = paramsat + 80;
+    new Float64Array(wasm.memory.buffer, paramsat, 10).set([
+        bounds.min.x, bounds.min.y, bounds.max.x, bounds.max.y,
+        lineWidth, spacing, density, repeat, tile || 1, rez || 0
+    ]);
+    let writer = new DataWriter(heapView(wasm), memat);
+    for (let layer of layers) {
+        writer.writeF64(layer.z, true);
+        writer.writeU32(layer.index, true);
+        let countat = writer.writeU32(0, true);
+        writer.view.setUint32(countat, writePolys(writer, layer.polys), true);
+    }
+    let resat = wasm.fn.fill(type, memat, layers.length, paramsat),
+        reader = new DataReader(heapView(wasm), resat + 4),
+        out = layers.map(layer => readPolys(reader, layer.z).map(p => p.setOpen()));
+    wasm.free(resat);
+    wasm.free(paramsat);
+    return out;
+}
+
+/**
+ * project flats down and bridges up through a stack of layers and merge
+ * them into solid areas. layers are { z, down, up, flats, bridges, inner }
+ * ordered bottom up where down / up are the layers to project over and
+ * inner, when given, is the fill region the solids are trimmed to.
+ * returns nested solid polygons for each layer
+ */
+export function solidProject(layers) {
+    wasm_ctrl.count.solids++;
+    let wasm = base.wasm,
+        size = 0;
+    for (let layer of layers) {
+        size += 24;
+        for (let poly of [ ...layer.flats, ...layer.bridges, ...(layer.inner || []) ]) {
+            size += (poly.deepLength + (poly.inner?.length || 0) + 1) * 8;
+        }
+    }
+    let memat = wasm.malloc(size),
+        writer = new DataWriter(heapView(wasm), memat);
+    for (let { down, up, flats, bridges, inner } of layers) {
+        let head = writer.pos;
+        writer.skip(24);
+        writer.view.setUint32(head, inner ? 1 : 0, true);
+        writer.view.setUint32(head + 4, down, true);
+        writer.view.setUint32(head + 8, up, true);
+        writer.view.setUint32(head + 12, writePolys(writer, flats), true);
+        writer.view.setUint32(head + 16, writePolys(writer, bridges), true);
+        writer.view.setUint32(head + 20, inner ? writePolys(writer, inner) : 0, true);
+    }
+    let resat = wasm.fn.solids(memat, layers.length),
+        reader = new DataReader(heapView(wasm), resat + 4),
+        out = layers.map(layer => polyNest(readPolys(reader, layer.z)));
+    wasm.free(resat);
+    wasm.free(memat);
+    return out;
+}
+
 // nest closed polygons without existing parent / child relationships
 function polyNest(polys) {
     polys.sort((a,b) => {
@@ -139,7 +427,7 @@ function polyNest(polys) {
 }
 
 function readString(pos, len) {
-    let view = new DataReader(base.wasm.heap, pos);
+    let view = new DataReader(heapView(base.wasm), pos);
     let out = [];
     while (len-- > 0) {
         out.push(String.fromCharCode(view.readU8()));
@@ -184,12 +472,24 @@ export function enable() {
             wasm.fn = {
                 diff: exports.poly_diff,
                 union: exports.poly_union,
-                offset: exports.poly_offset
+                offset: exports.poly_offset,
+                slice: exports.mesh_slice,
+                layers: exports.mesh_zplan,
+                flats: exports.mesh_flats,
+                tpms: exports.tpms_slice,
+                fill: exports.fill_sparse,
+                solids: exports.solid_project
             };
             wasm.js = {
                 diff: polyDiff,
                 union: polyUnion,
-                offset: polyOffset
+                offset: polyOffset,
+                slice: meshSlice,
+                layers: meshLayers,
+                flats: meshFlats,
+                tpms: tpmsSlice,
+                fill: fillSparse,
+                solids: solidProject
             };
         });
 }
@@ -315,6 +315,7 @@ export const conf = {
                 processName: "default",
                 ranges: [],
                 sliceAdaptive: false,
+                sliceAdaptiveCusp: 0.05,
                 sliceAngle: 45,
                 sliceBottomLayers: 3,
                 sliceCompInner: 0,
@@ -377,6 +378,10 @@ export const conf = {
                 slaOpenTop: false,
                 slaOpenBase: false,
                 slaAntiAlias: 1,
+                slaCompBase: 0,
+                slaCompBaseErode: 0,
+                slaCompErode: 0,
+                slaCompBlur: 0,
                 slaLayerOff: 0.1,
                 slaLayerOn: 7,
                 slaPeelDist: 6,
@@ -395,6 +400,7 @@ export const conf = {
                 slaSupportSize: 0.6,
                 slaSupportPoints: 4,
                 slaSupportGap: 10,
+                slaSupportNative: false,
                 slaSupportEnable: false
             }
         },
@@ -28,6 +28,8 @@ const LISTS = {
         { name: "linear" },
         { name: "triangle" },
         { name: "gyroid" },
+        { name: "schwarz" },
+        { name: "diamond" },
         { name: "vase" }
     ],
     units: [
@@ -8,6 +8,7 @@ import { util } from '../../geo/base.js';
 import { MODES } from './consts.js';
 import { LASER as laser_driver } from '../mode/laser/init-work.js';
 import { SLA as sla_client } from '../mode/sla/app/init-ui.js';
+import { CAM as cam_client } from '../mode/cam/app/dispatch.js';
 import { hash } from '../../ext/md5.js';
 
 /**
@@ -44,7 +45,7 @@ export function exportFile(options) {
         case 'DRAG':
         case 'LASER': return callExportLaser(options, names);
         case 'FDM': return callExport(options, mode, names);
-        case 'CAM': return callExport(options, mode, names);
+        case 'CAM': return callExportCAM(options, names);
         case 'SLA': return callExportSLA(options, names);
     }
 }
@@ -82,6 +83,33 @@ function callExport(callback, mode, names) {
     });
 }
 
+/**
+ * Export CAM gcode after a headless simulation of the program checks the
+ * tool shank against the stock. Collisions ask before exporting. The
+ * simulation also leaves per move material removal on the worker print
+ * for the op summaries in the gcode. The worker keeps the result with
+ * the prepared program, so exporting it again skips the simulation. When
+ * the simulator is unavailable the export goes ahead unchecked.
+ * @param {function} options - Optional callback passed to callExport()
+ * @param {string[]} names - Widget filenames for export naming
+ */
+function callExportCAM(options, names) {
+    let alert = api.feature.work_alerts ? api.show.alert("Checking tool clearance") : null;
+    cam_client.simulate(undefined, output => {
+        api.hide.alert(alert);
+        let hits = output?.collisions || [];
+        if (!hits.length) {
+            return callExport(options, 'CAM', names);
+        }
+        let depth = hits.reduce((max, hit) => Math.max(max, hit.depth), 0);
+        api.uc.confirm(`tool shank hits stock in ${hits.length} moves (up to ${depth.toFixed(2)}mm deep). export anyway?`).then(ok => {
+            if (ok) {
+                callExport(options, 'CAM', names);
+            }
+        });
+    });
+}
+
 /**
  * Export laser/waterjet/drag knife toolpaths.
  * Worker generates output, then presents export dialog with SVG/DXF/STL/GCode options.
@@ -30,6 +30,10 @@ function toCodable(object) {
             if (Array.isArray(object)) {
                 return object.map(v => toCodable(v));
             }
+            // binary data is posted as is
+            if (object instanceof ArrayBuffer || ArrayBuffer.isView(object)) {
+                return object;
+            }
             break;
     }
     let o = {};
@@ -121,7 +125,7 @@ function registerDecoder(type, handler) {
 }
 
 function genericObjectEncode(o, state) {
-    if (o instanceof Float32Array) return o;
+    if (o instanceof Float32Array || o instanceof Int32Array) return o;
     let out = {};
     for (let k in o) {
         if (o.hasOwnProperty(k)) out[k] = encode(o[k], state);
@@ -130,7 +134,7 @@ function genericObjectEncode(o, state) {
 }
 
 function genODecode(o, state) {
-    if (o instanceof Float32Array) return o;
+    if (o instanceof Float32Array || o instanceof Int32Array) return o;
     let out = {};
     for (let k in o) {
         if (o.hasOwnProperty(k)) out[k] = decode(o[k], state);
@@ -0,0 +1,224 @@
+/** Copyright Stewart Allen <sa@grid.space> -- All Rights Reserved */
+
+// WORKER binary slice cache. raw per-layer contours (slicer packSlices)
+// keyed by a hash of the transformed vertices, slicing options and layer
+// heights. kept in memory and persisted to indexedDB with size eviction
+
+import { open as dataOpen } from '../../data/index.js';
+import { base, config } from '../../geo/base.js';
+
+// bump when packSlices() layout or raw contour generation changes
+const FORMAT = 1;
+
+const memMax = 128 * 1024 * 1024;
+const dbMax = 512 * 1024 * 1024;
+// without indexedDB "persisted" slices live in the page heap
+const localMax = 32 * 1024 * 1024;
+
+const metrics = {
+    hits: 0,
+    misses: 0,
+    puts: 0,
+    evictions: 0,
+    bytes: 0
+};
+
+// insertion order is use order (LRU first)
+const memory = new Map();
+
+let store, index;
+
+// persisted buffers with an '_index' record of { key: { bytes, used } }
+function db() {
+    if (store === undefined) {
+        try {
+            store = dataOpen('kiri-slices', { stores: [ 'slices' ] });
+            store.init();
+        } catch (error) {
+            console.log({ slice_cache_disabled: error });
+            store = null;
+        }
+    }
+    return store;
+}
+
+function dbIndex() {
+    return index ??= new Promise(resolve => {
+        let idb = db();
+        if (!idb) {
+            return resolve({});
+        }
+        idb.get('_index', rec => resolve(rec || {}));
+    });
+}
+
+// minions get shared buffers instead of a structured clone per layer batch
+function shared(buffer) {
+    if (!self.SharedArrayBuffer || buffer instanceof SharedArrayBuffer) {
+        return buffer;
+    }
+    let copy = new SharedArrayBuffer(buffer.byteLength);
+    new Uint8Array(copy).set(new Uint8Array(buffer));
+    return copy;
+}
+
+function remember(key, buffer) {
+    buffer = shared(buffer);
+    let old = memory.get(key);
+    if (old) {
+        memory.delete(key);
+        metrics.bytes -= old.byteLength;
+    }
+    memory.set(key, buffer);
+    metrics.bytes += buffer.byteLength;
+    for (let [ k, b ] of memory) {
+        if (metrics.bytes <= memMax || k === key) {
+            break;
+        }
+        memory.delete(k);
+        metrics.bytes -= b.byteLength;
+        metrics.evictions++;
+    }
+    return buffer;
+}
+
+async function persist(key, buffer) {
+    let idb = db();
+    if (!idb) {
+        return;
+    }
+    let recs = await dbIndex();
+    let max = idb.isLocal() ? localMax : dbMax;
+    if (buffer.byteLength > max) {
+        return;
+    }
+    recs[key] = { bytes: buffer.byteLength, used: Date.now() };
+    let total = 0;
+    for (let rec of Object.values(recs)) {
+        total += rec.bytes;
+    }
+    // oldest persisted slices go first
+    let order = Object.entries(recs).sort((a, b) => a[1].used - b[1].used);
+    for (let [ k, rec ] of order) {
+        if (total <= max || k === key) {
+            break;
+        }
+        total -= rec.bytes;
+        delete recs[k];
+        idb.remove(k);
+        metrics.evictions++;
+    }
+    idb.put(key, buffer);
+    idb.put('_index', recs);
+}
+
+// 53 bit content hash over float bits and strings
+function hasher() {
+    let h1 = 0xdeadbeef, h2 = 0x41c6ce57;
+    let f32 = new Float32Array(1);
+    let u32 = new Uint32Array(f32.buffer);
+    function mix(v) {
+        h1 = Math.imul(h1 ^ v, 2654435761);
+        h2 = Math.imul(h2 ^ v, 1597334677);
+    }
+    return {
+        float(v) {
+            f32[0] = v;
+            mix(u32[0]);
+        },
+        string(s) {
+            for (let i = 0; i < s.length; i++) {
+                mix(s.charCodeAt(i));
+            }
+        },
+        value() {
+            let a = Math.imul(h1 ^ (h1 >>> 16), 2246822507) ^ Math.imul(h2 ^ (h2 >>> 13), 3266489909);
+            let b = Math.imul(h2 ^ (h2 >>> 16), 2246822507) ^ Math.imul(h1 ^ (h1 >>> 13), 3266489909);
+            return (4294967296 * (2097151 & b) + (a >>> 0)).toString(36);
+        }
+    };
+}
+
+/**
+ * cache bound to one mesh. points are hashed once here so the vertex
+ * positions after transforms and z adjustments are part of the key.
+ * parts holds slicing options which change the raw contours. the cache
+ * format, geo precision settings and slicer in use are always folded in
+ *
+ * @param {Point[]} points triangle vertices as sliced
+ * @param {Object} parts options folded into the key
+ * @returns {Object} { get(zIndexes), put(zIndexes, buffer) } for slice()
+ */
+export function sliceCacheFor(points, parts = {}) {
+    let hash = hasher();
+    // slice() rounds vertices in place so hash what it will see
+    for (let p of points) {
+        hash.float(p.x.round(3));
+        hash.float(p.y.round(3));
+        hash.float(p.z.round(3));
+    }
+    hash.string(JSON.stringify({
+        ...parts,
+        format: FORMAT,
+        clean: config.clipperClean,
+        bridge: config.bridgeLineGapDistanceMax,
+        zprec: config.precision_slice_z,
+        native: base.wasm?.fn.slice ? true : false
+    }));
+    let mesh = hash.value();
+
+    function keyFor(zIndexes) {
+        let zh = hasher();
+        zh.string(mesh);
+        for (let z of zIndexes) {
+            zh.float(z);
+        }
+        return `${mesh}-${zh.value()}`;
+    }
+
+    return {
+        async get(zIndexes) {
+            let key = keyFor(zIndexes);
+            let buffer = memory.get(key);
+            if (!buffer) {
+                let recs = await dbIndex();
+                if (recs[key]) {
+                    buffer = await new Promise(resolve => db().get(key, resolve));
+                }
+            }
+            if (buffer) {
+                metrics.hits++;
+                buffer = remember(key, buffer);
+                let recs = await dbIndex();
+                if (recs[key]) {
+                    recs[key].used = Date.now();
+                }
+            } else {
+                metrics.misses++;
+            }
+            return buffer;
+        },
+
+        put(zIndexes, buffer) {
+            let key = keyFor(zIndexes);
+            metrics.puts++;
+            remember(key, buffer);
+            persist(key, buffer);
+        }
+    };
+}
+
+/**
+ * @returns {Object} hit, miss, put and eviction counts and bytes in memory
+ */
+export function sliceCacheMetrics() {
+    return { ...metrics, entries: memory.size };
+}
+
+// drop all cached slices in memory and storage
+export function sliceCacheClear() {
+    memory.clear();
+    metrics.bytes = 0;
+    index = Promise.resolve({});
+    db()?.clear();
+}
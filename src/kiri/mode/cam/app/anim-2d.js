@@ -113,6 +113,16 @@ Object.assign(client, {
 
     animate_cleanup(data, ondone) {
         client.send("animate_cleanup", data, ondone);
+    },
+
+    // { to, snapshots } skip ahead without pacing, keeping stock copies
+    animate_fast(data, ondone) {
+        client.send("animate_fast", data, ondone);
+    },
+
+    // { index } scrub the stock to a path index
+    animate_seek(data, ondone) {
+        client.send("animate_seek", data, ondone);
     }
 });
 
@@ -151,12 +161,19 @@ function meshAdd(id, ind, pos, sab) {
     meshes[id] = mesh;
 }
 
-function meshUpdates(id) {
+function meshUpdates(id, range) {
     const mesh = meshes[id];
     if (!mesh) {
         return; // animate cancelled
     }
-    mesh.geometry.attributes.position.needsUpdate = true;
+    const position = mesh.geometry.attributes.position;
+    if (range) {
+        // upload only the changed spans of the shared grid. several tile
+        // updates can land before the deferred frame and three.js clears
+        // the collected ranges itself once they are uploaded
+        position.addUpdateRange(...range);
+    }
+    position.needsUpdate = true;
     space.update();
 }
 
@@ -193,6 +210,9 @@ function play(opts) {
         button.play.style.display = 'none';
         button.pause.style.display = '';
     }
+    if (steps !== 1 && speedIndex === speedMax) {
+        return skip();
+    }
     client.animate({
         speed,
         steps: steps || Infinity,
@@ -212,6 +232,17 @@ function fast(opts) {
     }, handleGridUpdate);
 }
 
+// at top speed jump straight to the end state
+function skip() {
+    client.animate_fast({}, data => {
+        handleGridUpdate(data);
+        if (data && data.index !== undefined) {
+            button.play.style.display = '';
+            button.pause.style.display = 'none';
+        }
+    });
+}
+
 function pause() {
     button.play.style.display = '';
     button.pause.style.display = 'none';
@@ -272,7 +303,7 @@ function checkMeshCommands(data) {
         label.z.value = (pos.z - origin.z).toFixed(2);
     }
     if (data.mesh_update) {
-        meshUpdates(data.id);
+        meshUpdates(data.id, data.range);
     }
 }
 
@@ -21,12 +21,15 @@ let meshes = {},
     color = 0,
     dark = false,
     manifold = false,
+    quadIndex = new Uint32Array(0),
+    stockAngle = 0,
     A2R = Math.PI / 180;
 
 export function animate_clear2(api) {
     let { anim } = api.ui;
     lineTracker?.clear();
     Object.keys(meshes).forEach(id => deleteMesh(id));
+    stockAngle = 0;
     api.widgets.setAxisIndex(0);
     api.uc.setVisible(anim.laba, true);
     api.uc.setVisible(anim.vala, true);
@@ -118,6 +121,16 @@ Object.assign(client, {
 
     animate_cleanup2(data, ondone) {
         client.send("animate_cleanup2", data, ondone);
+    },
+
+    // { to, snapshots } skip ahead without pacing, keeping stock copies
+    animate_fast2(data, ondone) {
+        client.send("animate_fast2", data, ondone);
+    },
+
+    // { index } scrub the stock to a path index
+    animate_seek2(data, ondone) {
+        client.send("animate_seek2", data, ondone);
     }
 });
 
@@ -217,6 +230,55 @@ function meshUpdate(id, ind, pos, ilen, plen) {
     space.update();
 }
 
+// patch stock tile meshes from a shared ring buffer. tiles holds
+// [ mesh id, float offset, quad count ] triples
+function tileUpdate(pos, tiles) {
+    for (let i = 0; i < tiles.length; i += 3) {
+        const id = tiles[i], off = tiles[i + 1], quads = tiles[i + 2];
+        const mesh = meshes[id] || tileAdd(id);
+        const geo = mesh.geometry;
+        if (mesh.quads < quads) {
+            // grow with headroom so later patches stay in place
+            mesh.quads = Math.ceil(quads * 1.5);
+            mesh.pos = new Float32Array(mesh.quads * 12);
+            geo.setAttribute('position', new THREE.BufferAttribute(mesh.pos, 3));
+            geo.setIndex(new THREE.BufferAttribute(quadPattern(mesh.quads), 1));
+        }
+        const position = geo.attributes.position;
+        mesh.pos.set(pos.subarray(off, off + quads * 12));
+        position.clearUpdateRanges();
+        position.addUpdateRange(0, quads * 12);
+        position.needsUpdate = true;
+        geo.setDrawRange(0, quads * 6);
+    }
+    space.update();
+}
+
+// new tiles start at the current stock rotation
+function tileAdd(id) {
+    const mesh = new THREE.Mesh(new THREE.BufferGeometry(), material);
+    mesh.quads = 0;
+    mesh.rotation.x = stockAngle * A2R;
+    space.world.add(mesh);
+    return meshes[id] = mesh;
+}
+
+// two triangles per quad of 4 consecutive vertices
+function quadPattern(quads) {
+    if (quadIndex.length < quads * 6) {
+        quadIndex = new Uint32Array(quads * 6);
+        for (let q = 0, i = 0, v = 0; q < quads; q++, v += 4) {
+            quadIndex[i++] = v;
+            quadIndex[i++] = v + 1;
+            quadIndex[i++] = v + 2;
+            quadIndex[i++] = v;
+            quadIndex[i++] = v + 2;
+            quadIndex[i++] = v + 3;
+        }
+    }
+    return quadIndex.subarray(0, quads * 6);
+}
+
 function deleteMesh(id) {
     space.world.remove(meshes[id]);
     meshes[id].geometry.dispose();
@@ -258,6 +320,9 @@ function play(opts) {
         button.play.style.display = 'none';
         button.pause.style.display = '';
     }
+    if (steps !== 1 && speedIndex === speedMax) {
+        return skip();
+    }
     client.animate2({
         speed,
         steps: steps || Infinity
@@ -275,6 +340,17 @@ function fast(opts) {
     }, handleUpdate);
 }
 
+// at top speed jump straight to the end state
+function skip() {
+    client.animate_fast2({}, data => {
+        handleUpdate(data);
+        if (data && data.index !== undefined) {
+            button.play.style.display = '';
+            button.pause.style.display = 'none';
+        }
+    });
+}
+
 function pause() {
     button.play.style.display = '';
     button.pause.style.display = 'none';
@@ -312,12 +388,21 @@ function handleUpdate(data) {
         lineTracker.rotate(-data.stock_index);
     }
     if (data.mesh_index) {
-        const { id, index } = data.mesh_index;
-        const mesh = meshes[id];
-        if (mesh) {
-            mesh.rotation.x = (Math.PI / 180) * index;
-            space.refresh();
+        const { id, ids, index } = data.mesh_index;
+        stockAngle = index;
+        for (let mid of ids || [ id ]) {
+            const mesh = meshes[mid];
+            if (mesh) {
+                mesh.rotation.x = (Math.PI / 180) * index;
+            }
         }
+        space.refresh();
+    }
+    if (data.tile_update) {
+        const { pos, busy, tiles } = data.tile_update;
+        tileUpdate(pos, tiles);
+        // hand the shared buffer back to the worker
+        Atomics.store(busy, 0, 0);
     }
     if (data.mesh_update) {
         const { id, ind, pos, ilen, plen } = data.mesh_update;
@@ -329,6 +414,18 @@ function handleUpdate(data) {
     if (data.line) {
         lineTracker.add(...data.line);
     }
+    if (data.lines_clear) {
+        lineTracker.clear();
+    }
+    if (data.lines) {
+        const { lines } = data;
+        for (let i = 0; i < lines.length; i += 8) {
+            lineTracker.add(
+                { x: lines[i], y: lines[i + 1], z: lines[i + 2], a: lines[i + 3] },
+                { x: lines[i + 4], y: lines[i + 5], z: lines[i + 6], a: lines[i + 7] }
+            );
+        }
+    }
 }
 
 function updateSpeed(inc = 0) {
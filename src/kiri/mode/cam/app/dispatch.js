@@ -82,6 +82,25 @@ function holes(indiv, rec, onProgress, onDone) {
     })
 };
 
+// run the current program headless and report shank or holder contact
+// with the stock as [{ index, depth }]. holder = { diameter, length }
+function collide(holder, ondone) {
+    const settings = api.conf.get();
+    api.client.send("cam_collide", { settings, holder }, output => {
+        ondone(output);
+    });
+};
+
+// simulate the current program at full speed without rendering. reports
+// collisions and per move removal [ volume, engagement, depth ] kept by
+// the worker for export
+function simulate(holder, ondone) {
+    const settings = api.conf.get();
+    api.client.send("cam_simulate", { settings, holder }, output => {
+        ondone(output);
+    });
+};
+
 function cylinderToggle(widget, face, onDone) {
     let cyls = widget._cylinders = widget._cylinders || {};
     for (let [root, faces] of Object.entries(cyls)) {
@@ -118,5 +137,7 @@ export const CAM = {
     surface_clear,
     traces,
     traces_clear,
-    holes
+    holes,
+    collide,
+    simulate
 };
@@ -3,6 +3,7 @@
 // WORKER BACK END ANIMATION CODE for 2D
 
 import { Tool } from '../core/tool.js';
+import { ANI } from './anim-wasm.js';
 
 const asPoints = false;
 const asLines = false;
@@ -10,11 +11,21 @@ const asLines = false;
 let stock, center, grid, gridX, gridY, rez;
 let path, pathIndex, tool, tools, last, toolID = 1;
 let settings;
+let native, nativeAt;
+let snapshots = new Map(), snapWant = new Set();
+
+// moves applied per native call
+const batchMax = 4096;
+// moves applied per native call when fast forwarding
+const fastMax = 65536;
 
 export function init(worker) {
     const { dispatch } = worker;
 
-    dispatch.animate_setup = function(data, send) {
+    // native heightfield simulation when the module is available
+    ANI.load().catch(error => console.log({ kiri_ani: error }));
+
+    dispatch.animate_setup = async function(data, send) {
         settings = data.settings;
 
         const { process } = settings;
@@ -45,6 +56,8 @@ export function init(worker) {
         grid = pos;
         gridX = stepsX;
         gridY = stepsY;
+        dirtyMin = Infinity;
+        dirtyMax = -Infinity;
 
         tool = null;
         last = null;
@@ -54,6 +67,16 @@ export function init(worker) {
         center = Object.assign({}, stock.center);
         center.z -= stock.z / 2;
 
+        native = await ANI.load().catch(() => undefined);
+        if (native) {
+            // heights live in wasm memory followed by tool profile and moves
+            nativeAt = { tool: stepsX * stepsY * 4 };
+            ANI.reserve(nativeAt.tool);
+            native.exports.stock_init(native.base, 0, stepsX, stepsY, rez, stock.z);
+        }
+        snapshots = new Map();
+        snapWant = new Set();
+
         send.data({ mesh_add: { id: 0, ind, offset, sab } }, [ ]); // sab not transferrable
         send.data({ mesh_move: { id: 0, pos: center } });
         send.done();
@@ -76,6 +99,48 @@ export function init(worker) {
             animateClear = true;
         }
     };
+
+    // run to path index `to` (default the end) with no pacing and send
+    // only the final stock. stock copies are kept at the path indices
+    // in `snapshots` for animate_seek
+    dispatch.animate_fast = function(data, send) {
+        if (!native) {
+            // nothing to batch, play at top speed instead
+            return dispatch.animate({ speed: 32, steps: Infinity }, send);
+        }
+        if (animating) {
+            return send.done({ index: pathIndex });
+        }
+        for (let index of data.snapshots || []) {
+            snapWant.add(index);
+        }
+        fastForward(Math.min(data.to ?? path.length, path.length), send);
+        renderSync(send);
+        send.done({ index: pathIndex });
+    };
+
+    // move the stock to path index from the nearest snapshot at or
+    // before it, or from the start
+    dispatch.animate_seek = function(data, send) {
+        if (!native || animating) {
+            return send.done({ index: pathIndex });
+        }
+        const index = Math.max(0, Math.min(data.index, path.length));
+        let from;
+        for (let at of snapshots.keys()) {
+            if (at <= index && (from === undefined || at > from)) from = at;
+        }
+        if (from !== undefined && (index < pathIndex || from > pathIndex)) {
+            restore(from, send);
+        } else if (index < pathIndex) {
+            native.exports.stock_init(native.base, 0, gridX, gridY, rez, stock.z);
+            pathIndex = 0;
+            last = null;
+        }
+        fastForward(index, send);
+        renderSync(send);
+        send.done({ index: pathIndex });
+    };
 }
 
 function createGrid(stepsX, stepsY, size, step, stock) {
@@ -133,13 +198,29 @@ let renderSpeed = 0;
 let skipMove = null;
 let toolUpdate;
 let depth = 0;
+let dirtyMin = Infinity;
+let dirtyMax = -Infinity;
 
-// send latest tool position and progress bar
+// widen the grid column range changed since the last update
+function markDirty(minx, maxx) {
+    dirtyMin = Math.min(dirtyMin, Math.max(0, minx));
+    dirtyMax = Math.max(dirtyMax, Math.min(gridX, maxx));
+}
+
+// send latest tool position and progress bar. grid columns are
+// contiguous so changed heights go up as a single float range
 function renderUpdate(send) {
     if (toolUpdate) {
         send.data(toolUpdate);
     }
-    send.data({ progress: pathIndex / path.length, id: 0, mesh_update: 1 });
+    if (dirtyMax <= dirtyMin) {
+        send.data({ progress: pathIndex / path.length });
+        return;
+    }
+    const range = [ dirtyMin * gridY * 3, (dirtyMax - dirtyMin) * gridY * 3 ];
+    dirtyMin = Infinity;
+    dirtyMax = -Infinity;
+    send.data({ progress: pathIndex / path.length, id: 0, mesh_update: 1, range });
 }
 
 function renderPath(send) {
@@ -192,7 +273,9 @@ function renderPath(send) {
 
     const id = toolID;
     const rezstep = rez;
-    if (last) {
+    if (last && native) {
+        renderBatch(id, next, send);
+    } else if (last) {
         const lp = last.point, np = next.point;
         last = next;
         // dwell ops have no point
@@ -254,6 +337,192 @@ function renderMoves(id, moves, send, seed = 0) {
     renderPath(send);
 }
 
+// gather moves up to the next pause, step limit, tool change or path end
+// and apply them to the native heightfield in one call
+function renderBatch(id, next, send) {
+    const { exports, base } = native;
+    const view = new Float32Array(native.memory.buffer, base + nativeAt.moves, batchMax * 4);
+    const flags = new Uint32Array(view.buffer, view.byteOffset, batchMax * 4);
+    const ox = stock.x / 2 - center.x;
+    const oy = stock.y / 2 - center.y;
+    let count = 0;
+
+    function add(p, cut) {
+        let i = count++ * 4;
+        view[i++] = p.x + ox;
+        view[i++] = p.y + oy;
+        view[i++] = p.z;
+        flags[i] = cut ? 1 : 0;
+    }
+
+    if (last.point) {
+        add(last.point, false);
+    }
+    for (;;) {
+        const lp = last.point, np = next.point;
+        last = next;
+        // dwell ops have no point
+        if (np) {
+            if (lp) {
+                const dx = np.x - lp.x, dy = np.y - lp.y, dz = np.z - lp.z;
+                renderDist += Math.sqrt(dx*dx  + dy*dy + dz*dz);
+            }
+            add(np, lp);
+            tool.pos = np;
+            toolUpdate = { mesh_move: { id, pos: np }};
+        }
+        if (renderDist >= renderSpeed || renderSteps <= 0 || count >= batchMax - 1) {
+            break;
+        }
+        let peek = path[pathIndex];
+        while (peek && peek.type === 'laser') {
+            last = peek;
+            peek = path[++pathIndex];
+        }
+        if (!peek || !peek.tool || peek.tool.getID() !== tool.getID()) {
+            break;
+        }
+        next = peek;
+        pathIndex++;
+        renderSteps--;
+    }
+
+    if (count && exports.stock_moves(base, nativeAt.moves, count, nativeAt.region)) {
+        // copy changed heights into the shared render grid
+        const region = new Uint32Array(native.memory.buffer, base + nativeAt.region, 4);
+        const heights = new Float32Array(native.memory.buffer, base, gridX * gridY);
+        const [ minx, maxx, miny, maxy ] = region;
+        markDirty(minx, maxx);
+        for (let x=minx; x<maxx; x++) {
+            for (let y=miny, gi=x*gridY+y; y<maxy; y++, gi++) {
+                grid[gi * 3 + 2] = heights[gi];
+            }
+        }
+    }
+
+    if (renderDist >= renderSpeed) {
+        renderDist = 0;
+        renderUpdate(send);
+        setTimeout(() => {
+            renderPath(send);
+        }, renderPause);
+    } else {
+        renderPath(send);
+    }
+}
+
+// apply path moves up to index `to` in large native batches without
+// pacing or rendering, stopping to copy the stock at wanted snapshots
+function fastForward(to, send) {
+    const { exports, base } = native;
+    const ox = stock.x / 2 - center.x;
+    const oy = stock.y / 2 - center.y;
+    let count = 0, view, flags, region;
+
+    // batch then region output, reserved past the animation batch
+    function views() {
+        region = nativeAt.moves + fastMax * 16;
+        ANI.reserve(region + 16);
+        view = new Float32Array(native.memory.buffer, base + nativeAt.moves, fastMax * 4);
+        flags = new Uint32Array(view.buffer, view.byteOffset, fastMax * 4);
+    }
+
+    function add(p, cut) {
+        let i = count++ * 4;
+        view[i++] = p.x + ox;
+        view[i++] = p.y + oy;
+        view[i++] = p.z;
+        flags[i] = cut ? 1 : 0;
+    }
+
+    // apply queued moves. the last point starts the next batch
+    function flush() {
+        if (count > 1) {
+            exports.stock_moves(base, nativeAt.moves, count, region);
+        }
+        count = 0;
+        if (last?.point) {
+            add(last.point, false);
+        }
+    }
+
+    if (nativeAt.moves !== undefined) {
+        views();
+        flush();
+    }
+    while (pathIndex < to) {
+        if (snapWant.has(pathIndex)) {
+            flush();
+            snapshot();
+        }
+        const next = path[pathIndex++];
+        if (next.type === 'laser') {
+            last = next;
+            continue;
+        }
+        if (next.tool && (!tool || tool.getID() !== next.tool.getID())) {
+            flush();
+            // on real tool change, go to safe Z first
+            if (tool && last.point) {
+                last.point = { x: last.point.x, y: last.point.y, z: stock.z };
+            }
+            updateTool(next.tool, send);
+            views();
+            count = 0;
+            if (last?.point) {
+                add(last.point, false);
+            }
+        }
+        const lp = last?.point, np = next.point;
+        last = next;
+        // dwell ops have no point
+        if (np && view) {
+            add(np, lp);
+            tool.pos = np;
+            toolUpdate = { mesh_move: { id: toolID, pos: np }};
+        }
+        if (count >= fastMax) {
+            flush();
+        }
+    }
+    if (view) {
+        flush();
+    }
+    if (snapWant.has(pathIndex)) {
+        snapshot();
+    }
+}
+
+// keep a copy of the stock and walk state at the current path index
+function snapshot() {
+    ANI.keep(snapshots, pathIndex, {
+        data: new Float32Array(native.memory.buffer, native.base, gridX * gridY).slice(),
+        last,
+        tool
+    });
+}
+
+function restore(at, send) {
+    const snap = snapshots.get(at);
+    new Float32Array(native.memory.buffer, native.base, gridX * gridY).set(snap.data);
+    native.exports.stock_touch();
+    pathIndex = at;
+    last = snap.last;
+    if (snap.tool && snap.tool.getID() !== tool?.getID()) {
+        updateTool(snap.tool, send);
+    }
+}
+
+// copy the whole native stock into the render grid and send it
+function renderSync(send) {
+    const heights = new Float32Array(native.memory.buffer, native.base, gridX * gridY);
+    for (let gi = 0, n = gridX * gridY; gi < n; gi++) {
+        grid[gi * 3 + 2] = heights[gi];
+    }
+    markDirty(0, gridX);
+    renderUpdate(send);
+}
+
 // update stock mesh to reflect tool tip geometry at given XYZ position
 function deformMesh(pos, send) {
     const prof = tool.profile;
@@ -283,6 +552,9 @@ function deformMesh(pos, send) {
             grid[iz] = tz;
         }
     }
+    if (upos) {
+        markDirty(rx, rx + pix + 1);
+    }
 }
 
 function updateTool(toolobj, send) {
@@ -305,5 +577,18 @@ function updateTool(toolobj, send) {
         const dz = prof[i++];
         pos[(dx * pix + dy) * 3 + 2] = -dz;
     }
+    if (native) {
+        // register the profile as (dx, dy, dz) cells after the heights
+        const count = prof.length / 3;
+        nativeAt.moves = nativeAt.tool + count * 8;
+        nativeAt.region = nativeAt.moves + batchMax * 16;
+        const { view } = ANI.reserve(nativeAt.region + 16);
+        for (let i=0, o=nativeAt.tool; i<prof.length; o += 8) {
+            view.setInt16(o, mid + prof[i++], true);
+            view.setInt16(o + 2, mid + prof[i++], true);
+            view.setFloat32(o + 4, prof[i++], true);
+        }
+        native.exports.tool_init(native.base, nativeAt.tool, count, size, mid, rez);
+    }
     send.data({ mesh_add: { id:++toolID, ind, sab }});
 }
@@ -4,6 +4,7 @@
 
 import { CSG } from '../../../../geo/csg.js';
 import { Tool } from '../core/tool.js';
+import { ANI } from './anim-wasm.js';
 
 let nextMeshID = 1,
     stock,
@@ -29,12 +30,25 @@ let nextMeshID = 1,
     renderSpeed = 0,
     indexCount = 0,
     updates = 0,
-    maxR;
+    maxR,
+    native,
+    nativeAt,
+    dexelTiles,
+    snapshots = new Map(),
+    snapWant = new Set();
+
+// rays per side of a native stock mesh tile
+const TILE_RAYS = 32;
+// shared buffers cycled for tile vertex uploads. a slot is reused only
+// after the client has copied out of it
+const TILE_RING = 4;
+// moves applied per native call when fast forwarding
+const FAST_MAX = 65536;
 
 export function init(worker) {
     const { dispatch, minions } = worker;
 
-    dispatch.animate_setup2 = function (data, send) {
+    dispatch.animate_setup2 = async function (data, send) {
         settings = data.settings;
 
         const { controller, process } = settings;
@@ -57,11 +71,32 @@ export function init(worker) {
         maxR = Math.hypot(stock.y, stock.z);
 
         stockSlices = [];
+        dexelTiles = undefined;
+        snapshots = new Map();
+        snapWant = new Set();
         const { x, y, z } = stock;
         const sliceCount = parseInt(settings.controller.animesh || 2000) / 100;
         const sliceWidth = stock.x / sliceCount;
 
-        if (controller.manifold)
+        native = await ANI.load().catch(() => undefined);
+        if (native) {
+            // dexel stock: rays along z at a density following animesh
+            const cell = Math.sqrt((x * y) / (parseInt(controller.animesh || 2000) * 250));
+            const width = Math.max(1, Math.round(x / cell));
+            const height = Math.max(1, Math.round(y / cell));
+            const size = native.exports.dexel_size(width, height, TILE_RAYS);
+            const tiles = Math.ceil(width / TILE_RAYS) * Math.ceil(height / TILE_RAYS);
+            // stock, a move pair, the dirty tile list, then mesh (and tool profile) scratch
+            nativeAt = { cell, size, move: Math.ceil(size / 16) * 16 };
+            nativeAt.width = width;
+            nativeAt.height = height;
+            nativeAt.list = nativeAt.move + 32;
+            nativeAt.mesh = nativeAt.list + Math.ceil(tiles / 4) * 16;
+            meshReserve(1024 * 1024);
+            native.exports.dexel_init(native.base, 0, width, height, TILE_RAYS, x, y, z);
+            dexelTiles = new DexelTiles(tiles);
+            dexelTiles.update(send);
+        } else if (controller.manifold)
         for (let i = 0; i < sliceCount; i++) {
             let xmin = -(x / 2) + (i * sliceWidth) + sliceWidth / 2;
             let slice = new Stock(sliceWidth, y, z).translate(xmin, 0, 0);
@@ -91,6 +126,54 @@ export function init(worker) {
             animateClear = true;
         }
     };
+
+    // run to path index `to` (default the end) with no pacing and send
+    // only the final stock. stock copies are kept at the path indices
+    // in `snapshots` for animate_seek2
+    dispatch.animate_fast2 = function (data, send) {
+        if (!native) {
+            // nothing to batch, play at top speed instead
+            return dispatch.animate2({ speed: 32, steps: Infinity }, send);
+        }
+        if (animating) {
+            return send.done({ index: pathIndex });
+        }
+        for (let index of data.snapshots || []) {
+            snapWant.add(index);
+        }
+        const from = pathIndex;
+        fastForward(Math.min(data.to ?? path.length, path.length), send);
+        send.data({ lines: pathLines(from, pathIndex) });
+        renderUpdate(send);
+        send.done({ index: pathIndex });
+    };
+
+    // move the stock to path index from the nearest snapshot at or
+    // before it, or from the start
+    dispatch.animate_seek2 = function (data, send) {
+        if (!native || animating) {
+            return send.done({ index: pathIndex });
+        }
+        const index = Math.max(0, Math.min(data.index, path.length));
+        let from;
+        for (let at of snapshots.keys()) {
+            if (at <= index && (from === undefined || at > from)) from = at;
+        }
+        if (from !== undefined && (index < pathIndex || from > pathIndex)) {
+            restore(from, send);
+        } else if (index < pathIndex) {
+            const { x, y, z } = stock;
+            const { width, height } = nativeAt;
+            native.exports.dexel_init(native.base, 0, width, height, TILE_RAYS, x, y, z);
+            pathIndex = 0;
+            last = null;
+        }
+        fastForward(index, send);
+        send.data({ lines_clear: true });
+        send.data({ lines: pathLines(0, pathIndex) });
+        renderUpdate(send);
+        send.done({ index: pathIndex });
+    };
 }
 
 function renderPath(send) {
@@ -158,6 +241,10 @@ function renderPath(send) {
             return renderPath(send);
         }
 
+        if (native) {
+            return renderNative(lp, np, next.speed, send);
+        }
+
         let dx = np.x - lp.x,
             dy = np.y - lp.y,
             dz = np.z - lp.z,
@@ -227,9 +314,141 @@ function renderMoves(id, moves, send, seed = 0) {
     renderPath(send);
 }
 
+// remove the whole move from the dexel stock in one native call
+function renderNative(lp, np, sp, send) {
+    const view = new Float32Array(native.memory.buffer, native.base + nativeAt.move, 8);
+    view.set([
+        lp.x, lp.y, lp.z - stockZ / 2, lp.a ?? 0,
+        np.x, np.y, np.z - stockZ / 2, np.a ?? 0
+    ]);
+    native.exports.dexel_move(native.base, nativeAt.move);
+    toolMove(np);
+    if (renderSpeed) {
+        const md = Math.hypot(np.x - lp.x, np.y - lp.y, np.z - lp.z);
+        const time = sp ? (md / sp) * 60000 : 10;
+        renderUpdate(send);
+        setTimeout(() => {
+            renderPath(send);
+        }, time / renderSpeed);
+    } else {
+        renderPath(send);
+    }
+}
+
+// apply path moves up to index `to` in large native batches without
+// pacing or rendering, stopping to copy the stock at wanted snapshots.
+// batches use the mesh scratch which is free until the next update
+function fastForward(to, send) {
+    const { exports, base } = native;
+    let count = 0, view;
+
+    function add(p) {
+        view.set([ p.x, p.y, p.z - stockZ / 2, p.a ?? 0 ], count++ * 4);
+    }
+
+    // apply queued moves. the last point starts the next batch
+    function flush() {
+        if (count > 1) {
+            exports.dexel_moves(base, nativeAt.mesh, count);
+        }
+        count = 0;
+        if (last?.point) {
+            add(last.point);
+        }
+    }
+
+    meshReserve(FAST_MAX * 16);
+    view = new Float32Array(native.memory.buffer, base + nativeAt.mesh, FAST_MAX * 4);
+    flush();
+    while (pathIndex < to) {
+        if (snapWant.has(pathIndex)) {
+            flush();
+            snapshot();
+        }
+        const next = path[pathIndex++];
+        if (next.type === 'laser') {
+            last = next;
+            continue;
+        }
+        if (next.tool && (!tool || tool.getID() !== next.tool.getID())) {
+            flush();
+            // on real tool change, go to safe Z first
+            if (tool && last?.point) {
+                last.point = { x: last.point.x, y: last.point.y, z: stock.z };
+            }
+            // the profile is staged in the mesh scratch
+            toolUpdate(next.tool.getID(), send);
+            view = new Float32Array(native.memory.buffer, base + nativeAt.mesh, FAST_MAX * 4);
+            count = 0;
+            if (last?.point) {
+                add(last.point);
+            }
+        }
+        const lp = last?.point, np = next.point;
+        last = next;
+        // dwell ops have no point. the chain restarts after them
+        if (np && !lp) {
+            flush();
+            count = 0;
+        }
+        if (np) {
+            add(np);
+        }
+        if (count >= FAST_MAX) {
+            flush();
+        }
+    }
+    flush();
+    if (snapWant.has(pathIndex)) {
+        snapshot();
+    }
+    if (last?.point && tool) {
+        toolMove(last.point);
+    }
+}
+
+// path lines from index to index as [ x, y, z, a ] pairs
+function pathLines(from, to) {
+    const lines = [];
+    for (let i = Math.max(from, 1); i < to; i++) {
+        const lp = path[i - 1].point, np = path[i].point;
+        if (lp && np) {
+            lines.push(lp.x, lp.y, lp.z, lp.a ?? 0, np.x, np.y, np.z, np.a ?? 0);
+        }
+    }
+    return new Float32Array(lines);
+}
+
+// keep a copy of the stock and walk state at the current path index
+function snapshot() {
+    ANI.keep(snapshots, pathIndex, {
+        data: new Uint8Array(native.memory.buffer, native.base, nativeAt.size).slice(),
+        last,
+        tool
+    });
+}
+
+function restore(at, send) {
+    const snap = snapshots.get(at);
+    new Uint8Array(native.memory.buffer, native.base, nativeAt.size).set(snap.data);
+    native.exports.dexel_touch();
+    pathIndex = at;
+    last = snap.last;
+    if (snap.tool && snap.tool.getID() !== tool?.getID()) {
+        toolUpdate(snap.tool.getID(), send);
+    }
+}
+
+// grow native scratch to hold at least bytes of mesh output
+function meshReserve(bytes) {
+    ANI.reserve(nativeAt.mesh + bytes);
+    nativeAt.meshMax = Math.floor((native.memory.buffer.byteLength - native.base - nativeAt.mesh) / 48);
+}
+
 // send latest tool position and progress bar
 function renderUpdate(send) {
     const updated = []
+    dexelTiles?.update(send);
     for (let slice of stockSlices) {
         slice.updateMesh(updated);
     }
@@ -244,6 +463,9 @@ function renderUpdate(send) {
         for (let slice of stockSlices) {
             send.data({ mesh_index: { id: slice.id, index: -stockIndex } });
         }
+        if (dexelTiles) {
+            send.data({ mesh_index: { ids: dexelTiles.ids, index: -stockIndex } });
+        }
         stockIndexMsg = false;
     }
     send.data({ progress: pathIndex / path.length });
@@ -310,11 +532,30 @@ function toolUpdate(toolid, send) {
     const vertex = raw.vertProperties;
     const index = raw.triVerts;
     toolMesh = { root: mesh, index, vertex, bounds: CSG.toBox3(mesh) };
+    if (native) {
+        // register the cutter profile using the mesh scratch area
+        const rez = Math.min(nativeAt.cell, tool.fluteDiameter() / 16);
+        tool.generateProfile(rez);
+        const prof = tool.profile;
+        const { size, pix } = tool.profileDim;
+        const mid = Math.floor(pix / 2);
+        const count = prof.length / 3;
+        meshReserve(count * 8);
+        const view = new DataView(native.memory.buffer, native.base);
+        for (let i = 0, o = nativeAt.mesh; i < prof.length; o += 8) {
+            view.setInt16(o, mid + prof[i++], true);
+            view.setInt16(o + 2, mid + prof[i++], true);
+            view.setFloat32(o + 4, prof[i++], true);
+        }
+        native.exports.tool_init(native.base, nativeAt.mesh, count, size, mid, rez);
+        native.exports.dexel_tool(tlen);
+    }
     send.data({ mesh_add: { id: --toolID, ind: index, pos: vertex } });
 }
 
-class Stock {
-    constructor(x, y, z) {
+// shared buffers and client messaging for a stock mesh
+class StockMesh {
+    constructor() {
         this.id = nextMeshID++;
         this.vbuf = undefined;
         this.ibuf = undefined;
@@ -322,7 +563,6 @@ class Stock {
         this.sends = 0;
         this.newbuf = true;
         this.subtracts = 0;
-        this.mesh = CSG.Instance().Manifold.cube([x, y, z], true);
     }
 
     send(send) {
@@ -342,6 +582,41 @@ class Stock {
         // console.log({ send: this.id, newbuf, action });
     }
 
+    sharedVertexBuffer(size) {
+        const old = this.vbuf;
+        this.plen = size;
+        if (old && old.length >= size) {
+            // console.log({svb: this.id, reuse: size, old: old.length});
+            return old;
+        }
+        // let buf = new Float32Array(new SharedArrayBuffer(size * 4));
+        let buf = new Float32Array(new SharedArrayBuffer(size * 4 + 1024 * 1024));
+        // console.log({new_svb: this.id, size, buf});
+        this.newbuf = true;
+        return this.vbuf = buf;
+    }
+
+    sharedIndexBuffer(size) {
+        const old = this.ibuf;
+        this.ilen = size;
+        if (old && old.length >= size) {
+            // console.log({sib: this.id, reuse: size, old: old.length});
+            return old;
+        }
+        // let buf = new Uint32Array(new SharedArrayBuffer(size * 4));
+        let buf = new Uint32Array(new SharedArrayBuffer(size * 4 + 1024 * 1024));
+        // console.log({new_sib: this.id, size, buf});
+        this.newbuf = true;
+        return this.ibuf = buf;
+    }
+}
+
+class Stock extends StockMesh {
+    constructor(x, y, z) {
+        super();
+        this.mesh = CSG.Instance().Manifold.cube([x, y, z], true);
+    }
+
     translate(x, y, z) {
         // console.log({ translate: this.id, x, y, z });
         const oldmesh = this.mesh;
@@ -379,32 +654,62 @@ class Stock {
         oldmesh.delete();
         this.subtracts++;
     }
+}
 
-    sharedVertexBuffer(size) {
-        const old = this.vbuf;
-        this.plen = size;
-        if (old && old.length >= size) {
-            // console.log({svb: this.id, reuse: size, old: old.length});
-            return old;
+// native dexel stock meshed in fixed size tiles. only tiles cut since
+// the last update are re-meshed. their vertices are packed into the next
+// shared buffer of a small ring and the client patches its tile meshes
+// in place from there. each buffer starts with an Int32 busy flag set
+// here when sent and cleared by the client once copied. a slot still
+// busy gets a fresh buffer and the old one is left to the client
+class DexelTiles {
+    constructor(count) {
+        this.ids = [];
+        for (let i = 0; i < count; i++) {
+            this.ids.push(nextMeshID++);
         }
-        // let buf = new Float32Array(new SharedArrayBuffer(size * 4));
-        let buf = new Float32Array(new SharedArrayBuffer(size * 4 + 1024 * 1024));
-        // console.log({new_svb: this.id, size, buf});
-        this.newbuf = true;
-        return this.vbuf = buf;
+        this.ring = [];
+        this.next = 0;
     }
 
-    sharedIndexBuffer(size) {
-        const old = this.ibuf;
-        this.ilen = size;
-        if (old && old.length >= size) {
-            // console.log({sib: this.id, reuse: size, old: old.length});
-            return old;
+    // current ring slot grown to hold at least size floats, keeping
+    // the first used floats already written
+    slot(size, used) {
+        let buf = this.ring[this.next];
+        if (!buf || buf.length < size || (!used && Atomics.load(buf.busy, 0))) {
+            const sab = new SharedArrayBuffer(16 + size * 4 + 1024 * 1024);
+            const grown = new Float32Array(sab, 16);
+            grown.busy = new Int32Array(sab, 0, 1);
+            if (used) grown.set(buf.subarray(0, used));
+            buf = this.ring[this.next] = grown;
         }
-        // let buf = new Uint32Array(new SharedArrayBuffer(size * 4));
-        let buf = new Uint32Array(new SharedArrayBuffer(size * 4 + 1024 * 1024));
-        // console.log({new_sib: this.id, size, buf});
-        this.newbuf = true;
-        return this.ibuf = buf;
+        return buf;
+    }
+
+    update(send) {
+        const { exports, base } = native;
+        const count = exports.dexel_dirty(base, nativeAt.list);
+        if (!count) {
+            return;
+        }
+        const dirty = new Uint32Array(native.memory.buffer, base + nativeAt.list, count).slice();
+        // tiles = [ mesh id, float offset, quad count, ... ]
+        const tiles = [];
+        let pos = this.slot(0, 0);
+        let off = 0;
+        for (let k of dirty) {
+            let quads = exports.dexel_mesh(base, k, nativeAt.mesh, nativeAt.meshMax);
+            if (quads > nativeAt.meshMax) {
+                meshReserve(quads * 48);
+                quads = exports.dexel_mesh(base, k, nativeAt.mesh, nativeAt.meshMax);
+            }
+            pos = this.slot(off + quads * 12, off);
+            pos.set(new Float32Array(native.memory.buffer, base + nativeAt.mesh, quads * 12), off);
+            tiles.push(this.ids[k], off, quads);
+            off += quads * 12;
+        }
+        this.next = (this.next + 1) % TILE_RING;
+        Atomics.store(pos.busy, 0, 1);
+        send.data({ tile_update: { pos, busy: pos.busy, tiles } });
     }
 }
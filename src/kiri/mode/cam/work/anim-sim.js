@@ -0,0 +1,273 @@
+/** Copyright Stewart Allen <sa@grid.space> -- All Rights Reserved */
+
+// WORKER headless stock simulation. runs a whole program through a
+// private native simulator with no pacing and no rendering
+
+import { Tool } from '../core/tool.js';
+import { ANI } from './anim-wasm.js';
+
+// moves applied per native call (16 byte records)
+const batchMax = 65536;
+// body cylinders registered per tool (shank, holder)
+const bodyMax = 8;
+
+export function init(worker) {
+    const { dispatch } = worker;
+
+    // check the shank and holder of every tool against the stock left
+    // by earlier moves. holder is an optional { diameter, length } that
+    // sits on top of the shank
+    dispatch.cam_collide = async function(data, send) {
+        const { settings, holder } = data;
+        const { print } = worker.current;
+        try {
+            const { collisions, time } = print.simulated?.key === simKey(settings, holder) ?
+                print.simulated :
+                await simulate(print, settings, { holder });
+            send.done({ collisions, time });
+        } catch (error) {
+            console.log({ cam_collide: error });
+            send.done({ error: error.toString() });
+        }
+    };
+
+    // simulate only: run the whole program at full speed and record the
+    // material removed by every move. the removal stats stay on the
+    // print for the export pass which reports them per op. the result is
+    // kept on the print so exporting the same program again reuses it
+    dispatch.cam_simulate = async function(data, send) {
+        const { settings, holder } = data;
+        const { print } = worker.current;
+        try {
+            const key = simKey(settings, holder);
+            const cached = print.simulated?.key === key;
+            if (!cached) {
+                print.simulated = { key, ...await simulate(print, settings, { holder, stats: true }) };
+            }
+            const { collisions, removal, time } = print.simulated;
+            print.removal = removal;
+            send.done({ collisions, time, cached });
+        } catch (error) {
+            console.log({ cam_simulate: error });
+            send.done({ error: error.toString() });
+        }
+    };
+}
+
+// the settings a simulation of a given print depends on
+function simKey(settings, holder) {
+    const { stock, tools, controller, process } = settings;
+    return JSON.stringify([ stock, tools, controller.animesh, process.camStockIndexed, holder ]);
+}
+
+/**
+ * simulate a program against fresh stock. indexed programs use the dexel
+ * stock, others the heightfield. collisions are { index, depth } with
+ * index into the flattened print.output. with opts.stats, removal holds
+ * [ volume mm^3, max engagement degrees, max depth mm ] per output record
+ */
+export async function simulate(print, settings, opts = {}) {
+    const wasm = await ANI.instance();
+    const start = Date.now();
+    const indexed = settings.process.camStockIndexed;
+    const sim = indexed ? new DexelSim(wasm, settings) : new HeightSim(wasm, settings);
+    const path = print.output.flat();
+    if (opts.stats) {
+        sim.removal = new Float32Array(path.length * 3);
+    }
+    let tool, last;
+
+    for (let index = 0; index < path.length; index++) {
+        const next = path[index];
+        if (next.type === 'laser') {
+            continue;
+        }
+        if (next.tool && (!tool || tool.getID() !== next.tool.getID())) {
+            sim.flush();
+            tool = new Tool(settings, next.tool.getID());
+            sim.tool(tool, opts.holder);
+            // tool changes happen at safe Z
+            if (last) {
+                sim.add({ x: last.x, y: last.y, z: settings.stock.z, a: last.a }, false, index);
+            }
+        }
+        const np = next.point;
+        // dwell ops have no point
+        if (!np || !tool) {
+            last = np || last;
+            continue;
+        }
+        for (let point of next.arcPoints || []) {
+            sim.add(point, last, index);
+        }
+        sim.add(np, last, index);
+        last = np;
+    }
+    sim.flush();
+
+    return {
+        collisions: sim.hits,
+        removal: sim.removal,
+        time: Date.now() - start
+    };
+}
+
+// shared batching of moves and collision reports
+class Sim {
+    constructor(wasm, settings) {
+        this.wasm = wasm;
+        this.stock = settings.stock;
+        this.density = parseInt(settings.controller.animesh || 2000);
+        this.count = 0;
+        this.index = [];
+        this.hits = [];
+        this.at = {};
+    }
+
+    // register the profile and body of a tool with the simulator
+    tool(tool, holder, rez, tool_at) {
+        const { wasm } = this;
+        const { exports, base } = wasm;
+        tool.generateProfile(rez);
+        const prof = tool.profile;
+        const { size, pix } = tool.profileDim;
+        const mid = Math.floor(pix / 2);
+        const count = prof.length / 3;
+        const flen = tool.fluteLength() || 15;
+        const slen = tool.shaftLength() || 15;
+        const srad = (tool.shaftDiameter() || tool.fluteDiameter()) / 2;
+        // profile, then body cylinders, then the move batch, hits and stats
+        const at = this.at;
+        at.body = Math.ceil((tool_at + count * 8) / 16) * 16;
+        at.moves = at.body + bodyMax * 12;
+        at.hits = at.moves + batchMax * 16;
+        at.stats = at.hits + batchMax * 8;
+        const { view } = ANI.reserve(at.stats + batchMax * 12, wasm);
+        for (let i = 0, o = tool_at; i < prof.length; o += 8) {
+            view.setInt16(o, mid + prof[i++], true);
+            view.setInt16(o + 2, mid + prof[i++], true);
+            view.setFloat32(o + 4, prof[i++], true);
+        }
+        const body = [ [ flen, flen + slen, srad ] ];
+        if (holder?.diameter && holder?.length) {
+            body.push([ flen + slen, flen + slen + holder.length, holder.diameter / 2 ]);
+        }
+        body.flat().forEach((v, i) => view.setFloat32(at.body + i * 4, v, true));
+        exports.tool_init(base, tool_at, count, size, mid, rez);
+        exports.body_init(base, at.body, body.length);
+        this.tlen = flen + slen;
+        // moves restart at the new location
+        this.count = 0;
+    }
+
+    // queue a move to point. cut is falsy for a position only move
+    add(point, cut, index) {
+        if (this.count >= batchMax) {
+            this.flush();
+        }
+        this.write(this.count, point, cut);
+        this.index[this.count++] = index;
+    }
+
+    // apply queued moves. the last move starts the next batch
+    flush() {
+        const { at, count } = this;
+        if (count < 2) {
+            return;
+        }
+        const { base, memory, heap } = this.wasm;
+        const { removal, index } = this;
+        const found = this.collide(count, removal ? at.stats : 0);
+        const hits = new DataView(memory.buffer, base + at.hits, found * 8);
+        for (let i = 0; i < found; i++) {
+            this.hits.push({
+                index: index[hits.getUint32(i * 8, true)],
+                depth: hits.getFloat32(i * 8 + 4, true)
+            });
+        }
+        if (removal) {
+            // arc chords fold into the record they came from
+            const stats = new Float32Array(memory.buffer, base + at.stats, count * 3);
+            for (let k = 1, j = 3; k < count; k++) {
+                const r = index[k] * 3;
+                removal[r] += stats[j++];
+                removal[r + 1] = Math.max(removal[r + 1], stats[j++]);
+                removal[r + 2] = Math.max(removal[r + 2], stats[j++]);
+            }
+        }
+        heap.copyWithin(at.moves, at.moves + (count - 1) * 16, at.moves + count * 16);
+        this.index[0] = this.index[count - 1];
+        this.count = 1;
+    }
+}
+
+// heightfield stock matching the 2D animation
+class HeightSim extends Sim {
+    constructor(wasm, settings) {
+        super(wasm, settings);
+        const { stock } = this;
+        const rez = this.rez = 1 / Math.sqrt(this.density * 1000 / (stock.x * stock.y));
+        const stepsX = Math.floor(stock.x / rez);
+        const stepsY = Math.floor(stock.y / rez);
+        const center = stock.center || { x: 0, y: 0 };
+        this.ox = stock.x / 2 - center.x;
+        this.oy = stock.y / 2 - center.y;
+        this.tool_at = stepsX * stepsY * 4;
+        ANI.reserve(this.tool_at, wasm);
+        wasm.exports.stock_init(wasm.base, 0, stepsX, stepsY, rez, stock.z);
+    }
+
+    tool(tool, holder) {
+        super.tool(tool, holder, this.rez, this.tool_at);
+    }
+
+    write(i, p, cut) {
+        const { view } = this.wasm;
+        const o = this.at.moves + i * 16;
+        view.setFloat32(o, p.x + this.ox, true);
+        view.setFloat32(o + 4, p.y + this.oy, true);
+        view.setFloat32(o + 8, p.z, true);
+        view.setUint32(o + 12, cut ? 1 : 0, true);
+    }
+
+    collide(count, stats) {
+        const { exports, base } = this.wasm;
+        return exports.stock_collide(base, this.at.moves, count, this.at.hits, count, stats);
+    }
+}
+
+// dexel stock matching the 3D and indexed animation
+class DexelSim extends Sim {
+    constructor(wasm, settings) {
+        super(wasm, settings);
+        const { x, y, z } = this.stock;
+        const cell = this.cell = Math.sqrt((x * y) / (this.density * 250));
+        const width = Math.max(1, Math.round(x / cell));
+        const height = Math.max(1, Math.round(y / cell));
+        const size = wasm.exports.dexel_size(width, height, 32);
+        this.tool_at = Math.ceil(size / 16) * 16;
+        ANI.reserve(this.tool_at, wasm);
+        wasm.exports.dexel_init(wasm.base, 0, width, height, 32, x, y, z);
+    }
+
+    tool(tool, holder) {
+        super.tool(tool, holder, Math.min(this.cell, tool.fluteDiameter() / 16), this.tool_at);
+        this.wasm.exports.dexel_tool(this.tlen);
+    }
+
+    // only indexed programs get here. their stock is centered on the
+    // rotation axis like the dexel block so z needs no offset
+    write(i, p, cut) {
+        const { view } = this.wasm;
+        const o = this.at.moves + i * 16;
+        view.setFloat32(o, p.x, true);
+        view.setFloat32(o + 4, p.y, true);
+        view.setFloat32(o + 8, p.z, true);
+        view.setFloat32(o + 12, p.a ?? 0, true);
+    }
+
+    collide(count, stats) {
+        const { exports, base } = this.wasm;
+        return exports.dexel_collide(base, this.at.moves, count, this.at.hits, count, stats);
+    }
+}
@@ -0,0 +1,117 @@
+/** Copyright Stewart Allen <sa@grid.space> -- All Rights Reserved */
+
+// WORKER native stock simulation module shared by 2D and 3D animation
+
+export const ANI = {
+    load,
+    instance,
+    reserve,
+    keep,
+    wasm: undefined
+};
+
+let compiled, loading;
+
+// bytes of stock copies kept for seeking per animation
+const keepBudget = 256 * 1024 * 1024;
+
+// exports used by the 2D, 3D and headless simulators. tool_init is
+// checked by arity: tool_init(base, at, count, size, mid, step)
+const required = [
+    'heap_base', 'stock_init', 'stock_touch', 'stock_moves', 'stock_collide',
+    'tool_init', 'body_init', 'dexel_size', 'dexel_init', 'dexel_tool',
+    'dexel_move', 'dexel_moves', 'dexel_touch', 'dexel_collide',
+    'dexel_dirty', 'dexel_mesh'
+];
+
+// fetch and compile the simulator once
+function compile() {
+    if (compiled) {
+        return compiled;
+    }
+    return compiled = fetch('/wasm/kiri-ani.wasm')
+        .then(response => {
+            if (!response.ok) throw `kiri-ani.wasm ${response.status}`;
+            return response.arrayBuffer();
+        })
+        .then(bytes => WebAssembly.compile(bytes))
+        .catch(error => {
+            // allow a later retry
+            compiled = undefined;
+            throw error;
+        });
+}
+
+// a new simulator with its own memory and stock. used by headless
+// passes so they never disturb a running animation
+function instance() {
+    return compile()
+        .then(module => WebAssembly.instantiate(module, {
+            env: {
+                reportf: (a,b) => { console.log('[f]',a,b) },
+                reporti: (a,b) => { console.log('[i]',a,b) }
+            }
+        }))
+        .then(instance => {
+            let { exports } = instance;
+            // an older or partial build rejects here so callers take
+            // their JS paths instead of failing mid animation
+            let missing = required.filter(name => typeof exports[name] !== 'function');
+            if (missing.length || exports.tool_init.length !== 6) {
+                throw `kiri-ani.wasm out of date (${missing.join(',') || 'tool_init'})`;
+            }
+            let base = exports.heap_base();
+            return {
+                base,
+                exports,
+                memory: exports.memory,
+                heap: new Uint8Array(exports.memory.buffer, base),
+                view: new DataView(exports.memory.buffer, base)
+            };
+        });
+}
+
+// load the shared animation simulator once. resolves with ANI.wasm
+function load() {
+    if (loading) {
+        return loading;
+    }
+    return loading = instance()
+        .then(wasm => ANI.wasm = wasm)
+        .catch(error => {
+            // allow a later retry
+            loading = undefined;
+            throw error;
+        });
+}
+
+// add a stock snapshot (stock copy in snap.data) at path index `at`.
+// past the budget the oldest snapshots are dropped. the newest is kept
+// so a single copy larger than the budget still seeks
+function keep(snapshots, at, snap) {
+    snapshots.delete(at);
+    snapshots.set(at, snap);
+    let bytes = 0;
+    for (let s of snapshots.values()) {
+        bytes += s.data.byteLength;
+    }
+    for (let [old, s] of snapshots) {
+        if (bytes <= keepBudget || old === at) {
+            break;
+        }
+        snapshots.delete(old);
+        bytes -= s.data.byteLength;
+    }
+}
+
+// grow memory to hold at least bytes past base. views are
+// re-created because growing detaches the previous buffer
+function reserve(bytes, wasm = ANI.wasm) {
+    let have = wasm.memory.buffer.byteLength - wasm.base;
+    if (bytes > have) {
+        wasm.memory.grow(Math.ceil((bytes - have) / 65536));
+        wasm.heap = new Uint8Array(wasm.memory.buffer, wasm.base);
+        wasm.view = new DataView(wasm.memory.buffer, wasm.base);
+    }
+    return wasm;
+}
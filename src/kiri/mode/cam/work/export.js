@@ -50,6 +50,9 @@ export function cam_export(print, online) {
         compact_output = false,
         lasering = false,
         laserOp,
+        removal = print.removal,
+        removalAt = 0,
+        opRemoval,
         stock = settings.stock || {},
         zmax = stock.z,
         runbox = {
@@ -453,6 +456,44 @@ export function cam_export(print, online) {
         });
     });
 
+    // per move removal from a headless simulation (cam_simulate). ignored
+    // unless it covers exactly this output
+    if (removal?.length !== print.output.reduce((n, layer) => n + layer.length, 0) * 3) {
+        removal = undefined;
+    }
+
+    /**
+     * Fold the simulated removal of output record k, a move that took dt
+     * seconds, into the op summary. Chip thickness per spindle revolution
+     * thins with engagement below 90 degrees: feed / rpm * sin(engagement)
+     */
+    function addRemoval(k, dt) {
+        const [ volume, engage ] = removal.subarray(k * 3, k * 3 + 2);
+        if (!(volume > 0)) {
+            return;
+        }
+        const sum = opRemoval = opRemoval || { volume: 0, rate: 0, engage: 0, chip: 0 };
+        sum.volume += volume;
+        sum.engage = Math.max(sum.engage, engage);
+        if (dt > 0) {
+            sum.rate = Math.max(sum.rate, volume / dt * 60);
+        }
+        if (spindle && pos.f) {
+            const thin = Math.sin(Math.min(engage, 90) * Math.PI / 180);
+            sum.chip = Math.max(sum.chip, pos.f / Math.abs(spindle) * thin);
+        }
+    }
+
+    // emit and reset the removal summary of the op just ended
+    function endRemoval() {
+        const sum = opRemoval;
+        opRemoval = undefined;
+        if (sum && !stripComments) {
+            append(`; removed ${Math.round(sum.volume)} mm3 peak rate ${Math.round(sum.rate)} mm3/min` +
+                ` engagement ${Math.round(sum.engage)} deg chip ${sum.chip.toFixed(4)} mm/rev`);
+        }
+    }
+
     if (!stripComments) {
         // emit tools used in comments
         append("; --- tools ---");
@@ -479,6 +520,7 @@ export function cam_export(print, online) {
         const firstOut = layerout[0];
         const newOp = newmode && !newmode.silent && mode !== newmode;
         if (newOp) {
+            endRemoval();
             if (mode && !stripComments) {
                 append("; ending " + mode.type + " op after " + Math.round(time) + " seconds");
             }
@@ -493,6 +535,7 @@ export function cam_export(print, online) {
         newSpindle = layerout.spindle;
         // iterate over layer output records
         layerout.forEach((out, ind) => {
+            const rec = removalAt++;
             if (out.type === 'lerp') {
                 // suppress display only lerp points
                 return;
@@ -500,7 +543,11 @@ export function cam_export(print, online) {
             if (out.gcode && Array.isArray(out.gcode)) {
                 filterEmit(out.gcode, consts);
             } else {
+                const start = time;
                 moveTo(out, { newOp: ind === 0 ? newOp : false });
+                if (removal) {
+                    addRemoval(rec, time - start);
+                }
             }
         });
         if (lasering && laserOp) {
@@ -510,6 +557,7 @@ export function cam_export(print, online) {
         }
     }
 
+    endRemoval();
     if (mode && !stripComments) {
         append("; ending " + mode.type + " op after " + Math.round(time) + " seconds");
     }
@@ -9,6 +9,7 @@ import { cylinder_poly_find } from './slice.js';
 
 import { init as init_2d } from './anim-2d.js';
 import { init as init_3d } from './anim-3d.js';
+import { init as init_sim } from './anim-sim.js';
 
 function surface_prep(widget, index) {
     if (!widget.tool) {
@@ -29,6 +30,7 @@ function init(worker) {
 
     init_2d(worker);
     init_3d(worker);
+    init_sim(worker);
 
     dispatch.cam_surfaces = function(data, send) {
         const { settings, index } = data;
@@ -0,0 +1,78 @@
+/** Copyright Stewart Allen <sa@grid.space> -- All Rights Reserved */
+
+// WORKER and MINION native topo module (heightmap raster) for 3D contouring
+
+export const TOPO = {
+    load,
+    reserve,
+    wasm: undefined
+};
+
+let loading;
+
+// exports used by topo3.js and the minions
+const required = [ 'heap_base', 'topo_raster', 'dilate_size', 'topo_dilate', 'topo_trace' ];
+
+// load the module once per worker. the simd build is used wherever the
+// runtime validates simd128. resolves with TOPO.wasm
+function load() {
+    if (loading) {
+        return loading;
+    }
+    let simd = WebAssembly.validate(new Uint8Array([
+        0,97,115,109,1,0,0,0,1,5,1,96,0,1,123,3,2,1,0,10,10,1,8,0,65,0,253,15,253,98,11
+    ]));
+    let fetchwasm = file => fetch(file)
+        .then(response => {
+            if (!response.ok) throw `${file} ${response.status}`;
+            return response.arrayBuffer();
+        })
+        .then(bytes => WebAssembly.instantiate(bytes, {
+            env: {
+                reportf: (a,b) => { console.log('[f]',a,b) },
+                reporti: (a,b) => { console.log('[i]',a,b) }
+            }
+        }))
+        .then(results => {
+            // a stale or partial build rejects so callers take their JS
+            // paths instead of failing on a missing export
+            let { exports } = results.instance;
+            let missing = required.filter(name => typeof exports[name] !== 'function');
+            if (missing.length) throw `${file} out of date (${missing.join(',')})`;
+            return results;
+        });
+    // fall back to the scalar build when no usable simd build is deployed
+    return loading = (simd ? fetchwasm('/wasm/kiri-topo-simd.wasm').catch(() => {
+        simd = false;
+        return fetchwasm('/wasm/kiri-topo.wasm');
+    }) : fetchwasm('/wasm/kiri-topo.wasm'))
+        .then(results => {
+            let { exports } = results.instance;
+            let base = exports.heap_base();
+            return TOPO.wasm = {
+                base,
+                simd,
+                exports,
+                memory: exports.memory,
+                heap: new Uint8Array(exports.memory.buffer, base),
+                view: new DataView(exports.memory.buffer, base)
+            };
+        })
+        .catch(error => {
+            // allow a later retry
+            loading = undefined;
+            throw error;
+        });
+}
+
+// grow memory to hold at least bytes past base. views are
+// re-created because growing detaches the previous buffer
+function reserve(bytes, wasm = TOPO.wasm) {
+    let have = wasm.memory.buffer.byteLength - wasm.base;
+    if (bytes > have) {
+        wasm.memory.grow(Math.ceil((bytes - have) / 65536));
+        wasm.heap = new Uint8Array(wasm.memory.buffer, wasm.base);
+        wasm.view = new DataView(wasm.memory.buffer, wasm.base);
+    }
+    return wasm;
+}
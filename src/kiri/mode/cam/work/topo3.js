@@ -1,5 +1,6 @@
 /** Copyright Stewart Allen <sa@grid.space> -- All Rights Reserved */
 
+import { config as base_config } from '../../../../geo/base.js';
 import { codec } from '../../../core/codec.js';
 import { newPoint } from '../../../../geo/point.js';
 import { newPolygon } from '../../../../geo/polygon.js';
@@ -7,6 +8,7 @@ import { newSlice } from '../../../core/slice.js';
 import { Slicer as topo_slicer } from './slicer-topo.js';
 import { polygons as POLY } from '../../../../geo/polygons.js';
 import { Tool } from '../core/tool.js';
+import { TOPO } from './topo-wasm.js';
 
 const RAD2DEG = 180 / Math.PI;
 const DEG2RAD = Math.PI / 180;
@@ -109,6 +111,9 @@ export class Topo {
         }
 
         if (webGPU && !contour.nogpu) {
+            // the gpu path rasterizes, dilates and traces on its own and
+            // never uses kiri-topo. its paths match the cpu paths only to
+            // within its raster sampling
             // invert tool Z offset for gpu code
             let toolBounds = new THREE.Box3()
                 .expandByPoint({ x: -toolDiameter/2, y: -toolDiameter/2, z: 0 })
@@ -363,7 +368,9 @@ export class Topo {
                 resolution,
                 curvesOnly,
                 flatness,
+                stepsX,
                 stepsY,
+                minX,
                 minY,
                 maxY,
                 zMin,
@@ -378,6 +385,11 @@ export class Topo {
             topo.raster = false;
         }
 
+        // tool probes become grid lookups when the native module is present
+        if (TOPO.wasm) {
+            Object.assign(probe.params, dilate_native(TOPO.wasm, probe.params));
+        }
+
         await this.contour({
             box: topo.box,
             minX,
@@ -415,6 +427,19 @@ export class Topo {
         const { box } = params;
         const { dispatch, minions } = self.kiri_worker;
 
+        // prefer the native z-buffer raster. the slicing raster below
+        // remains for runtimes where the module will not load
+        const native = await TOPO.load().catch(error => {
+            console.log({ topo_wasm: error });
+        });
+        if (native) {
+            try {
+                return await this.raster_native(widget, params, onupdate);
+            } catch (error) {
+                console.log({ topo_raster_native: error });
+            }
+        }
+
         const vertices = widget.getGeoVertices({ unroll: true, translate: true }).toShared();
         const range = { min: Infinity, max: -Infinity };
 
@@ -521,7 +546,146 @@ export class Topo {
         }
     }
 
+    // split the grid into column tiles and rasterize them on minions
+    // (or in place) with the native module
+    async raster_native(widget, params, onupdate) {
+        const { box, stepsX } = params;
+        const { dispatch, minions } = self.kiri_worker;
+
+        const vertices = widget.getGeoVertices({ unroll: true, translate: true }).toShared();
+        const running = minions.running;
+        const cols = Math.ceil(stepsX / Math.max(1, running * 4));
+        const tiles = [];
+        for (let x0 = 0; x0 < stepsX; x0 += cols) {
+            tiles.push({ x0, x1: Math.min(stepsX, x0 + cols) });
+        }
+
+        let complete = 0;
+        let boxes;
+        if (running > 1) {
+            await new Promise(resolve => {
+                dispatch.putCache({ key: widget.id, data: vertices }, { done: resolve });
+            });
+            try {
+                boxes = await Promise.all(tiles.map(tile => new Promise((resolve, reject) => {
+                    minions.queue({
+                        cmd: "topo_raster",
+                        id: widget.id,
+                        params,
+                        tile
+                    }, data => {
+                        if (data.error) {
+                            reject(data.error);
+                        } else {
+                            resolve(data.box);
+                            onupdate(++complete, tiles.length, "raster");
+                        }
+                    });
+                })));
+            } finally {
+                dispatch.clearCache({}, { done() { } });
+            }
+        } else {
+            boxes = tiles.map(tile => {
+                const rec = raster_native(TOPO.wasm, vertices, params, tile.x0, tile.x1);
+                onupdate(++complete, tiles.length, "raster");
+                return rec;
+            });
+        }
+
+        // merge boxes for all tiles for contouring clipping
+        for (let rec of boxes) {
+            if (rec.min.x <= rec.max.x) {
+                box.union(new THREE.Box2(
+                    new THREE.Vector2(rec.min.x, rec.min.y),
+                    new THREE.Vector2(rec.max.x, rec.max.y)
+                ));
+            }
+        }
+    }
+
+    // trace all scan lines of each axis natively. returns false when the
+    // output or clip limits of the module are exceeded
+    contour_native(params, onupdate) {
+        const { minX, maxX, minY, maxY, boundsX, boundsY, stepsX, stepsY } = params;
+        const { gridDelta, resolution, density, partOff, toolStep, contourX, contourY } = params;
+        const { clipTo, clipTab, tabHeight, newslices, leave } = params;
+        const { curvesOnly, maxangle, flatness } = this.trace.params;
+
+        const box = params.box.clone().expandByVector(new THREE.Vector3(
+            partOff, partOff, 0
+        ));
+        const shared = {
+            density,
+            curvesOnly,
+            maxangle,
+            flatness,
+            leave,
+            tabHeight,
+            step: resolution * density,
+            grid: -gridDelta
+        };
+
+        const output = [];
+        if (contourY) {
+            // emit slice per X
+            const scans = [];
+            for (let x = minX - partOff; x <= maxX + partOff; x += toolStep) {
+                if (x < box.min.x || x > box.max.x) continue;
+                scans.push({ at: x, grid: Math.round(((x - minX) / boundsX) * stepsX) });
+            }
+            const lines = trace_native(TOPO.wasm, this.probe.params, {
+                ...shared,
+                axis: 1,
+                from: minY - partOff,
+                to: maxY + partOff,
+                boxMin: box.min.y,
+                boxMax: box.max.y
+            }, scans, clipTo, clipTab);
+            if (!lines) {
+                return false;
+            }
+            output.push(lines);
+            onupdate(0.5, 1, "contour y");
+        }
+        if (contourX) {
+            // emit slice per Y
+            const scans = [];
+            for (let y = minY - partOff; y <= maxY + partOff; y += toolStep) {
+                if (y < box.min.y || y > box.max.y) continue;
+                scans.push({ at: y, grid: Math.round(((y - minY) / boundsY) * stepsY) });
+            }
+            const lines = trace_native(TOPO.wasm, this.probe.params, {
+                ...shared,
+                axis: 0,
+                from: minX - partOff,
+                to: maxX + partOff,
+                boxMin: box.min.x,
+                boxMax: box.max.x
+            }, scans, clipTo, clipTab);
+            if (!lines) {
+                return false;
+            }
+            output.push(lines);
+            onupdate(1, 1, "contour x");
+        }
+
+        for (let lines of output) {
+            for (let { at, polys } of lines) {
+                const slice = newSlice(at);
+                slice.camLines = polys;
+                newslices.push(slice);
+            }
+        }
+        return true;
+    }
+
     async contour(params, onupdate) {
+        // one native pass per axis over the dilated grid when present
+        if (this.probe.params.dilated && this.contour_native(params, onupdate)) {
+            return;
+        }
+
         const trace = this.trace;
         const concurrent = self.kiri_worker.minions.running;
 
@@ -658,6 +822,17 @@ export class Probe {
                 xl = sx - 1,
                 yl = sy - 1;
 
+            // grid pre-dilated by the tool profile (see dilate_native)
+            // with a margin of reach cells. past that the tool sits on zMin
+            const { dilated, reach } = params;
+            if (dilated) {
+                const dx = x + reach, dy = y + reach, dh = sy + reach * 2;
+                if (dx < 0 || dy < 0 || dx >= sx + reach * 2 || dy >= dh) {
+                    return zMin;
+                }
+                return dilated[dx * dh + dy];
+            }
+
             let gv, i = 0, mz = -Infinity;
 
             while (i < profile.length) {
@@ -1030,6 +1205,196 @@ export function raster_slice(inputs) {
     return points;
 };
 
+/**
+ * rasterize grid columns x0 to x1 - 1 of params.data with the native
+ * module. vertices are the unrolled widget triangles (not XZ swapped).
+ * the module keeps the last vertex array so repeated tiles skip the
+ * copy. returns the xy bounds of triangles that raised a cell
+ */
+export function raster_native(wasm, vertices, params, x0, x1) {
+    const { data, stepsX, stepsY, minX, minY, resolution, zMin } = params;
+    const vbytes = vertices.length * 4;
+    const g = Math.ceil(vbytes / 16) * 16;
+    const b = g + 32;
+    const o = b + 16;
+    const tile = (x1 - x0) * stepsY;
+    TOPO.reserve(o + tile * 4, wasm);
+    const { base, memory, view } = wasm;
+    if (wasm.vertices !== vertices) {
+        new Float32Array(memory.buffer, base, vertices.length).set(vertices);
+        wasm.vertices = vertices;
+    }
+    view.setUint32(g, stepsX, true);
+    view.setUint32(g + 4, stepsY, true);
+    view.setFloat32(g + 8, minX, true);
+    view.setFloat32(g + 12, minY, true);
+    view.setFloat32(g + 16, resolution, true);
+    view.setFloat32(g + 20, zMin, true);
+    // raise the existing grid columns in place
+    const grid = new Float32Array(memory.buffer, base + o, tile);
+    grid.set(data.subarray(x0 * stepsY, x1 * stepsY));
+    wasm.exports.topo_raster(base, 0, vertices.length / 9, g, o, x0, x1, b);
+    data.set(grid, x0 * stepsY);
+    return {
+        min: { x: view.getFloat32(b, true), y: view.getFloat32(b + 4, true) },
+        max: { x: view.getFloat32(b + 8, true), y: view.getFloat32(b + 12, true) }
+    };
+}
+
+/**
+ * dilate the topo grid by the tool profile so the grid holds the tool
+ * tip z at every cell (toolAtZ for every cell in one pass). returns
+ * { dilated, reach } where dilated is a new shared grid with a margin
+ * of reach cells on every side
+ */
+export function dilate_native(wasm, params) {
+    const { data, profile, stepsX, stepsY, zMin } = params;
+    const count = profile.length / 3;
+    const cells = stepsX * stepsY;
+    let reach = 0;
+    for (let i = 0; i < profile.length; i += 3) {
+        reach = Math.max(reach, Math.abs(profile[i]), Math.abs(profile[i + 1]));
+    }
+    const outs = (stepsX + reach * 2) * (stepsY + reach * 2);
+    const g = 0;
+    const i = 32;
+    const o = i + cells * 4;
+    const p = o + outs * 4;
+    const s = Math.ceil((p + count * 8) / 16) * 16;
+    TOPO.reserve(s + wasm.exports.dilate_size(stepsX, stepsY, reach, count), wasm);
+    const { base, memory, view } = wasm;
+    // the raster vertex copy is overwritten
+    wasm.vertices = undefined;
+    view.setUint32(g, stepsX, true);
+    view.setUint32(g + 4, stepsY, true);
+    view.setFloat32(g + 20, zMin, true);
+    new Float32Array(memory.buffer, base + i, cells).set(data);
+    for (let k = 0, at = p; k < profile.length; at += 8) {
+        view.setInt16(at, profile[k++], true);
+        view.setInt16(at + 2, profile[k++], true);
+        view.setFloat32(at + 4, profile[k++], true);
+    }
+    wasm.exports.topo_dilate(base, g, i, o, p, count, reach, s);
+    const dilated = new Float32Array(new SharedArrayBuffer(outs * 4));
+    dilated.set(new Float32Array(memory.buffer, base + o, outs));
+    return { dilated, reach };
+}
+
+// clip polygons as Uint32 groups, then per group float z, Uint32 rings
+// and per ring Uint32 points followed by x,y floats
+function write_clips(view, at, polys) {
+    view.setUint32(at, polys.length, true);
+    at += 4;
+    for (let poly of polys) {
+        const rings = [ poly, ...(poly.inner || []) ];
+        view.setFloat32(at, poly.z || 0, true);
+        view.setUint32(at + 4, rings.length, true);
+        at += 8;
+        for (let ring of rings) {
+            view.setUint32(at, ring.points.length, true);
+            at += 4;
+            for (let point of ring.points) {
+                view.setFloat32(at, point.x, true);
+                view.setFloat32(at + 4, point.y, true);
+                at += 8;
+            }
+        }
+    }
+    return at;
+}
+
+function clips_size(polys) {
+    let size = 4;
+    for (let poly of polys || []) {
+        size += 8;
+        for (let ring of [ poly, ...(poly.inner || []) ]) {
+            size += 4 + ring.points.length * 8;
+        }
+    }
+    return size;
+}
+
+/**
+ * trace every scan line along one axis over a grid dilated by
+ * dilate_native (Trace crossX/crossY for all lines in one pass).
+ * scans are { at, grid } with the fixed coordinate and grid index
+ * across the axis. returns [{ at, polys }] for scans with output or
+ * undefined when module limits are exceeded
+ */
+export function trace_native(wasm, probe, opts, scans, clipTo, clipTab) {
+    const { dilated, reach, stepsX, stepsY, zMin } = probe;
+    const steps = Math.ceil((opts.to - opts.from) / opts.step) + 1;
+    // bound the point output by splitting scans into chunks
+    const chunk = Math.max(1, Math.floor((1 << 20) / steps));
+    const pmax = Math.min(scans.length, chunk) * (steps + 1);
+    const lmax = Math.ceil(pmax / 2) + chunk;
+    const g = 0;
+    const t = 32;
+    const d = 128;
+    const s = d + dilated.length * 4;
+    const c = s + scans.length * 8;
+    const b = c + Math.ceil(clips_size(clipTo) / 16) * 16;
+    const l = b + Math.ceil(clips_size(clipTab) / 16) * 16;
+    const p = l + lmax * 8;
+    TOPO.reserve(p + pmax * 12, wasm);
+    const { base, memory, view } = wasm;
+    wasm.vertices = undefined;
+
+    view.setUint32(g, stepsX, true);
+    view.setUint32(g + 4, stepsY, true);
+    view.setFloat32(g + 20, zMin, true);
+    view.setFloat64(t, opts.from, true);
+    view.setFloat64(t + 8, opts.to, true);
+    view.setFloat64(t + 16, opts.step, true);
+    view.setFloat64(t + 24, opts.boxMin, true);
+    view.setFloat64(t + 32, opts.boxMax, true);
+    view.setUint32(t + 40, opts.axis, true);
+    view.setUint32(t + 44, opts.density, true);
+    view.setUint32(t + 48, opts.curvesOnly ? 1 : 0, true);
+    view.setUint32(t + 52, reach, true);
+    view.setInt32(t + 56, opts.grid, true);
+    view.setFloat32(t + 60, opts.leave, true);
+    view.setFloat32(t + 64, opts.flatness, true);
+    view.setFloat32(t + 68, opts.maxangle, true);
+    view.setFloat32(t + 72, opts.tabHeight, true);
+    view.setFloat32(t + 76, base_config.precision_merge, true);
+    new Float32Array(memory.buffer, base + d, dilated.length).set(dilated);
+    scans.forEach((scan, i) => {
+        view.setFloat32(s + i * 8, scan.at, true);
+        view.setInt32(s + i * 8 + 4, scan.grid, true);
+    });
+    if (clipTo) write_clips(view, c, clipTo);
+    if (clipTab?.length) write_clips(view, b, clipTab);
+
+    const out = [];
+    for (let i = 0; i < scans.length; i += chunk) {
+        const count = Math.min(chunk, scans.length - i);
+        const lines = wasm.exports.topo_trace(
+            base, g, d, t, s + i * 8, count,
+            clipTo ? c : 0, clipTab?.length ? b : 0,
+            l, lmax, p, pmax
+        );
+        if (lines === 0xffffffff) {
+            return;
+        }
+        const points = new Float32Array(memory.buffer, base + p, pmax * 3);
+        let rec, pi = 0;
+        for (let k = 0; k < lines; k++) {
+            const scan = view.getUint32(l + k * 8, true) + i;
+            const n = view.getUint32(l + k * 8 + 4, true);
+            if (!rec || rec.scan !== scan) {
+                out.push(rec = { scan, at: scans[scan].at, polys: [] });
+            }
+            const poly = newPolygon().setOpen();
+            for (let e = pi + n * 3; pi < e; pi += 3) {
+                poly.push(newPoint(points[pi], points[pi + 1], points[pi + 2]));
+            }
+            rec.polys.push(poly);
+        }
+    }
+    return out;
+}
+
 export async function generate(opt) {
     return new Topo().generate(opt);
 }
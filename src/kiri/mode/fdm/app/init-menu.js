@@ -82,6 +82,7 @@ export function menu() {
     _____:               newGroup(LANG.sl_menu, $('fdm-layers'), { modes:FDM, driven, hideable, separator, group:"fdm-layers" }),
     sliceHeight:         newInput(LANG.sl_lahi_s, { title:LANG.sl_lahi_l, convert:toFloat }),
     sliceMinHeight:      newInput(LANG.ad_minl_s, { title:LANG.ad_minl_l, convert:toFloat, bound:bound(0,3.0), show:() => ui.sliceAdaptive.checked }),
+    sliceAdaptiveCusp:   newInput(LANG.ad_cusp_s, { title:LANG.ad_cusp_l, convert:toFloat, bound:bound(0,1.0), show:() => ui.sliceAdaptive.checked }),
     sliceTopLayers:      newInput(LANG.sl_ltop_s, { title:LANG.sl_ltop_l, convert:toInt }),
     sliceBottomLayers:   newInput(LANG.sl_lbot_s, { title:LANG.sl_lbot_l, convert:toInt }),
     separator:           newBlank({ class:"set-sep", driven }),
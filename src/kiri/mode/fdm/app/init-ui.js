@@ -16,6 +16,8 @@ let lastView,
     removingSupports = false,
     isFdmMode = false,
     alert = [],
+    planKey,
+    planAlert,
     down;
 
 export function init() {
@@ -167,8 +169,38 @@ export function init() {
 
     api.event.on("settings.saved", (settings) => {
         updateRanges(settings.process.ranges);
+        if (isFdmMode) replanLayers(settings);
     });
 
+    // re-plan adaptive layers as their settings are edited and report
+    // the schedule. the worker keeps each mesh's slope histogram so
+    // only the planner runs again
+    function replanLayers(settings) {
+        const { process } = settings;
+        const widgets = api.widgets.all();
+        const key = process.sliceAdaptive && process.sliceMinHeight > 0 && widgets.length ? [
+            process.sliceHeight,
+            process.sliceMinHeight,
+            process.sliceAdaptiveCusp,
+            process.firstSliceHeight,
+            ...widgets.map(w => w.id)
+        ].join(',') : undefined;
+        if (key === planKey) return;
+        planKey = key;
+        if (!key) return;
+        api.client.sync();
+        api.client.send("fdm_layers", { settings }, plans => {
+            if (key !== planKey) return;
+            const heights = plans.map(plan => plan.heights || []).flat();
+            if (!heights.length) return;
+            const layers = Math.max(...plans.map(plan => plan.tops?.length || 0));
+            const min = Math.min(...heights).round(3);
+            const max = Math.max(...heights).round(3);
+            api.hide.alert(planAlert);
+            planAlert = api.show.alert(`adaptive ${layers} layers (${min} - ${max} mm)`, 3);
+        });
+    }
+
     api.event.on("button.click", target => {
         switch (target) {
             case api.ui.ssmAdd: return supportStart({ remove: false });
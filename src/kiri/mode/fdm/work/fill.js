@@ -1,7 +1,9 @@
 /** Copyright Stewart Allen <sa@grid.space> -- All Rights Reserved */
 
 import { newPolygon } from '../../../../geo/polygon.js';
-import { slice as gyroid_slice } from '../../../../geo/gyroid.js';
+import { slice as tpms_slice, sliceAll as tpms_slice_all } from '../../../../geo/gyroid.js';
+import { fillSparse } from '../../../../geo/wasm.js';
+import { base } from '../../../../geo/base.js';
 
 export const fill_fixed = {
     hex: fillHexFull,
@@ -13,11 +15,84 @@ export const fill = {
     hex: fillHexFull,
     grid: fillGrid,
     gyroid: fillGyroid,
+    schwarz: fillSchwarz,
+    diamond: fillDiamond,
     triangle: fillTriangle,
     linear: fillLinear,
     cubic: fillCubic
 };
 
+// periodic surface patterns contoured per layer
+const fill_tpms = {
+    gyroid: true,
+    schwarz: true,
+    diamond: true
+};
+
+/**
+ * contour every layer of a periodic surface pattern in one batch
+ * ahead of the per layer fill calls. other patterns are ignored
+ *
+ * @param {string} type fill type
+ * @param {number} density 0.0 - 1.0
+ * @param {number[]} zs layer z values
+ */
+export function fill_batch(type, density, zs) {
+    if (fill_tpms[type]) {
+        let { tile_z, rez } = tpmsTile(density);
+        tpms_slice_all(zs.map(z => z * tile_z), rez, 0, type);
+    }
+}
+
+// kiri-geo fill_sparse pattern ids
+const fill_native_ids = {
+    hex: 0,
+    grid: 1,
+    triangle: 2,
+    linear: 3,
+    cubic: 4,
+    gyroid: 5,
+    schwarz: 6,
+    diamond: 7
+};
+
+/**
+ * @param {string} type fill type
+ * @returns {boolean} true when the pattern can be generated and clipped natively
+ */
+export function fill_native_ok(type) {
+    return base.wasm?.fn.fill && fill_native_ids[type] !== undefined ? true : false;
+}
+
+/**
+ * generate and clip a fill pattern for many layers in one native call.
+ * produces the same lines as fill[type] clipped to each layer's polys.
+ * with minions the layers are split into one call per minion
+ *
+ * @param {string} type fill type
+ * @param {Object} options { bounds, lineWidth, spacing, density, repeat }
+ * @param {Object[]} layers { z, index, polys } with polys the fill regions
+ * @param {Object} [minions] worker minion pool
+ * @returns {Polygon[][]|Promise<Polygon[][]>} open polylines for each layer
+ */
+export function fill_native(type, options, layers, minions) {
+    let { tile, rez } = tpmsTile(options.density);
+    let opt = {
+        ...options,
+        tile,
+        rez: parseInt(rez || 200)
+    };
+    return minions ?
+        minions.fillSparse(fill_native_ids[type], layers, opt) :
+        fillSparse(fill_native_ids[type], layers, opt);
+}
+
+// tile size in mm and contour resolution for a fill density
+function tpmsTile(density) {
+    let tile = 1 + (1 - density) * 15;
+    return { tile, tile_z: 1 / tile, rez: (1 - density) * 500 };
+}
+
 const DEG2RAD = Math.PI / 180;
 
 function fillHexFull(target) {
@@ -95,16 +170,25 @@ function fillHex(target, full) {
 }
 
 function fillGyroid(target) {
+    fillTPMS(target, 'gyroid');
+}
+
+function fillSchwarz(target) {
+    fillTPMS(target, 'schwarz');
+}
+
+function fillDiamond(target) {
+    fillTPMS(target, 'diamond');
+}
+
+function fillTPMS(target, type) {
     let bounds = target.bounds();
-    let height = target.zHeight();
     let span_x = bounds.max.x - bounds.min.x;
     let span_y = bounds.max.y - bounds.min.y;
-    let density = target.density();
-    let tile = 1 + (1 - density) * 15;
+    let { tile, tile_z, rez } = tpmsTile(target.density());
     let tile_x = span_x / tile;
     let tile_y = span_y / tile;
-    let tile_z = 1 / tile;
-    let gen = gyroid_slice(target.zValue() * tile_z, (1 - density) * 500);
+    let gen = tpms_slice(target.zValue() * tile_z, rez, 0, type);
 
     let polys = [];
     if (gen.dir == 'lr') {
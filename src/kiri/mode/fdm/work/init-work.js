@@ -1,7 +1,7 @@
 /** Copyright Stewart Allen <sa@grid.space> -- All Rights Reserved */
 
 import { util } from '../../../../geo/base.js';
-import { sliceOne, slicePost } from './slice.js';
+import { sliceOne, slicePost, planLayers } from './slice.js';
 import { fdm_prepare } from './prepare.js';
 import { fdm_export } from './export.js';
 
@@ -28,6 +28,15 @@ function extrudeMM(dist, perMM, factor) {
 
 // defer loading until client and worker exist
 function init(worker) {
+    // adaptive layer schedule per widget while its settings are edited
+    worker.dispatch.fdm_layers = function(data, send) {
+        const { settings } = data;
+        const widgets = Object.values(worker.cache);
+        send.done(widgets.map(widget => {
+            return { id: widget.id, ...planLayers(settings, widget) };
+        }));
+    };
+
     // worker.dispatch.fdm_support_generate = function(data, send) {
     //     const { settings } = data;
     //     const widgets = Object.values(worker.cache);
@@ -1,7 +1,7 @@
 /** Copyright Stewart Allen <sa@grid.space> -- All Rights Reserved */
 
 import { layerProcessTop } from './post.js';
-import { fill, fill_fixed } from './fill.js';
+import { fill, fill_batch, fill_fixed, fill_native, fill_native_ok } from './fill.js';
 import { generateBeltAnchor, embossBeltPooch, finalizeBeltBounds } from './belt.js';
 import { getRangeParameters } from '../core/params.js';
 import { newPoint } from '../../../../geo/point.js';
@@ -9,7 +9,9 @@ import { newPolygon } from '../../../../geo/polygon.js';
 import { newSlice } from '../../../core/slice.js';
 import { polygons as POLY } from '../../../../geo/polygons.js';
 import { slice, sliceZ } from '../../../../geo/slicer.js';
-import { util } from '../../../../geo/base.js';
+import { sliceCacheFor } from '../../../core/slice-cache.js';
+import { base, util } from '../../../../geo/base.js';
+import { meshFlats, meshLayers, meshZHist, solidProject } from '../../../../geo/wasm.js';
 
 const CONSTANTS = {
     // Support fill
@@ -71,6 +73,7 @@ const CONSTANTS = {
  * @property {number} sliceSupportOffset - Support clip offset in mm
  * @property {number} sliceAdaptive - Enable adaptive layer heights
  * @property {number} sliceMinHeight - Minimum adaptive layer height in mm
+ * @property {number} sliceAdaptiveCusp - Max adaptive cusp error in mm
  * @property {number} firstSliceHeight - First layer height in mm
  * @property {number} firstLayerBrim - Brim width in mm
  * @property {number} beltAnchor - Belt anchor length in mm
@@ -173,6 +176,94 @@ function vopt(opt, ctx) {
     return opt;
 }
 
+/**
+ * apply the widget z cut (floor method) and belt base flattening to its
+ * points once. the original z is kept in _z so repeat calls are no-ops
+ *
+ * @returns {number} z cut distance
+ */
+function cutPoints(widget, points, process, isBelt) {
+    let zPress = isBelt ? process.firstLayerFlatten || 0 : 0;
+    let zCut = widget.track.zcut || 0;
+    let { belt } = widget;
+    if (zCut || zPress) {
+        for (let p of points) {
+            if (!p._z) {
+                p._z = p.z;
+                if (zPress) {
+                    if (isBelt) {
+                        let zd = (belt.slope * p.z) - p.y;
+                        if (zd > 0 && zd <= zPress) {
+                            p.y += zd * belt.cosf;
+                            p.z -= zd * belt.sinf;
+                        }
+                    } else {
+                        if (p.z <= zPress) p.z = 0;
+                    }
+                }
+                if (zCut && !isBelt) {
+                    p.z -= zCut;
+                }
+            }
+        }
+    }
+    return zCut;
+}
+
+/**
+ * native adaptive layer plan { tops, heights } for a widget. the facet
+ * slope histogram is kept with the widget when keep is set so planning
+ * again for another cusp or max height skips the pass over the mesh.
+ * points may be a function called only when the mesh is needed
+ */
+function adaptiveLayers(widget, points, opt, keep) {
+    let { zMin, zMax, hmin } = opt;
+    let key = [ zMin, zMax, hmin ].join(',');
+    let cached = widget.cache.zhist;
+    if (cached?.key !== key) {
+        cached = { key, hist: meshZHist(typeof points === 'function' ? points() : points, opt) };
+        if (keep) {
+            widget.cache.zhist = cached;
+        }
+    }
+    return meshLayers(undefined, { ...opt, hist: cached.hist });
+}
+
+/**
+ * plan adaptive layers for a widget without slicing it so the layer
+ * schedule can follow edits to the adaptive settings. belt beds and
+ * runs without the native planner return undefined
+ *
+ * @param {Object} settings
+ * @param {Widget} widget
+ * @returns {Object|undefined} { tops, heights }
+ */
+export function planLayers(settings, widget) {
+    let { process, device } = settings,
+        sliceHeight = process.sliceHeight,
+        sliceHeightBase = process.firstSliceHeight || sliceHeight,
+        hm = process.sliceAdaptive && process.sliceMinHeight > 0 ?
+            Math.min(process.sliceMinHeight, sliceHeight) : 0;
+    if (!(hm && sliceHeight > 0 && base.wasm?.fn.layers) || device.bedBelt) {
+        return;
+    }
+    let bounds = widget.getBoundingBox(),
+        zMin = bounds.min.z,
+        zMax = bounds.max.z - (widget.track.zcut || 0);
+    // the points are released again like after a slice
+    let points = () => {
+        let points = widget.getPoints();
+        cutPoints(widget, points, process, false);
+        widget.points = undefined;
+        return points;
+    };
+    return adaptiveLayers(widget, points, {
+        zMin, zMax, hmin: hm, hmax: sliceHeight,
+        h0: Math.abs(zMin) < 0.0001 ? (sliceHeightBase > 0 ? sliceHeightBase : hm) : sliceHeight,
+        cusp: process.sliceAdaptiveCusp || hm / 2
+    }, true);
+}
+
 /**
  * DRIVER SLICE CONTRACT
  *
@@ -270,30 +361,7 @@ export function sliceOne(settings, widget, onupdate, ondone) {
     let slices; // set by decodeSlices()
 
     // handle z cutting (floor method) and base flattening
-    let zPress = isBelt ? process.firstLayerFlatten || 0 : 0;
-    let zCut = widget.track.zcut || 0;
-    let { belt } = widget;
-    if (zCut || zPress) {
-        for (let p of points) {
-            if (!p._z) {
-                p._z = p.z;
-                if (zPress) {
-                    if (isBelt) {
-                        let zd = (belt.slope * p.z) - p.y;
-                        if (zd > 0 && zd <= zPress) {
-                            p.y += zd * belt.cosf;
-                            p.z -= zd * belt.sinf;
-                        }
-                    } else {
-                        if (p.z <= zPress) p.z = 0;
-                    }
-                }
-                if (zCut && !isBelt) {
-                    p.z -= zCut;
-                }
-            }
-        }
-    }
+    let zCut = cutPoints(widget, points, process, isBelt);
 
     // create Slice objects for specified list of Z heights
     // zGen() produces the list (or empty for slicer auto-detected)
@@ -306,6 +374,11 @@ export function sliceOne(settings, widget, onupdate, ondone) {
         union: controller.healMesh,
         indices: process.indices || process.xray,
         useAssembly,
+        // raw contours are reused while the mesh and layers are unchanged
+        cache: process.xray ? undefined : sliceCacheFor(points, {
+            union: controller.healMesh,
+            useAssembly
+        }),
         post: 'FDM',
         post_args: {
             compInner: sliceCompInner,
@@ -318,6 +391,8 @@ export function sliceOne(settings, widget, onupdate, ondone) {
             process,
         },
         zGen,
+        // both slicers end in sliceZ() which sweeps the mesh in z itself
+        bucket: false,
         // slicer function (worker local or minion distributed)
         slicer(z, points, opts) {
             return (isConcurrent ? minions.sliceZ : sliceZ)(z, points, opts);
@@ -343,7 +418,16 @@ export function sliceOne(settings, widget, onupdate, ondone) {
         let z = h0;
         let zi = indices; // indices
         let zh = heights; // heights
-        if (hm) {
+        if (hm && base.wasm?.fn.layers && zopt.points) {
+            // native cusp error planner over the facet slopes. slices
+            // sit on layer tops like the legacy adaptive path below
+            let { tops, heights } = adaptiveLayers(widget, zopt.points, {
+                zMin, zMax, hmin: hm, hmax: h1, h0,
+                cusp: process.sliceAdaptiveCusp || hm / 2
+            }, !isBelt);
+            zh.push(...heights);
+            zi.push(...tops);
+        } else if (hm) {
             // adaptive increments based on z indices (var map to legacy code)
             let zIncFirst = h0;
             let zInc = h1;
@@ -607,16 +691,27 @@ export function sliceOne(settings, widget, onupdate, ondone) {
     async function processLayerDiffs() {
         // boolean diff layers to detect bridges and flats
         profileStart("delta");
+        let changes = layerChanges();
         forSlices(0.2, 0.33, slice => {
             let params = slice.params || process;
             let solidMinArea = params.sliceSolidMinArea;
             let sliceMinThick = params.sliceSolidMinThick;
             let sliceFillGrow = params.sliceFillGrow;
+            if (changes && !changes(slice, sliceMinThick)) {
+                slice.bridges = [];
+                slice.down.flats = [];
+                return;
+            }
             layerDiff(slice, { area: solidMinArea, grow: sliceFillGrow, thick: sliceMinThick });
         }, "layer deltas");
         profileEnd();
         // project bridges and flats up and down into part
         profileStart("delta-project");
+        if (base.wasm?.fn.solids) {
+            projectSolids();
+            profileEnd();
+            return;
+        }
         forSlices(0.33, 0.34, slice => {
             let params = slice.params || process;
             topLayers = params.sliceTopLayers || 0;
@@ -636,6 +731,96 @@ export function sliceOne(settings, widget, onupdate, ondone) {
         profileEnd();
     }
 
+    /**
+     * Native equivalent of projectFlats / projectBridges followed by the
+     * solid union and the fill region trim in layerFillSolids, done for
+     * all layers in one pass. Trimmed layers are marked so the trim is
+     * not repeated
+     */
+    function projectSolids() {
+        let layers = slices.map((slice, i) => {
+            let params = slice.params || process;
+            topLayers = params.sliceTopLayers || 0;
+            bottomLayers = params.sliceBottomLayers || 0;
+            let flats = topLayers && slice.down && slice.flats?.length ? slice.flats : [];
+            let bridges = bottomLayers && slice.up && slice.bridges?.length ? slice.bridges : [];
+            // these flats and bridges are marked for finishing print speed
+            if (flats.length) {
+                slice.finishSolids = true;
+                slice.isFlatsLayer = true;
+                let last = slices[i - topLayers + 1];
+                if (last) last.isBridgeLayer = true;
+            }
+            if (bridges.length) {
+                slice.finishSolids = true;
+                slice.isBridgeLayer = true;
+            }
+            if (slice.flats) POLY.setZ(slice.flats, slice.z);
+            let trim = slice.tops && !(slice.isSolidLayer || slice.xray);
+            return {
+                z: slice.z,
+                down: flats.length ? topLayers : 0,
+                up: bridges.length ? bottomLayers : 0,
+                flats,
+                bridges,
+                inner: trim ? slice.topFillOff() : undefined
+            };
+        });
+        let solids = solidProject(layers);
+        slices.forEach((slice, i) => {
+            let { flats, bridges, inner } = layers[i];
+            slice.solids = solids[i];
+            slice._solids_trimmed = inner ? true : false;
+            // each solid takes the fill angle hint of the largest of this
+            // layer's own flats and bridges it overlaps
+            let own = [ ...flats, ...bridges ]
+                .map(poly => ({ poly, area: poly.areaDeep() }))
+                .sort((a, b) => b.area - a.area);
+            for (let solid of own.length ? solids[i] : []) {
+                let src = own.find(rec => solid.overlaps(rec.poly));
+                if (src) {
+                    src.hint ??= src.poly.clone(true).hintFillAngle() || null;
+                    if (src.hint) solid.fillang = src.hint;
+                }
+            }
+            doupdate(slice.index, 0.33, 0.35, "layer deltas");
+        });
+    }
+
+    /**
+     * Native mesh flats and facet slopes mark the layer pairs whose outlines
+     * can differ. Others hold only vertical walls or slopes too steep to
+     * leave a diff thicker than the solid minimum, so their diff is skipped.
+     * Returns undefined when every pair must be diffed
+     */
+    function layerChanges() {
+        if (!base.wasm?.fn.flats || process.xray || process.ranges?.length || slices.length < 3) {
+            return;
+        }
+        // the empty slice injected on top is above everything
+        let last = slices.length - 1;
+        let zs = slices.map((slice, i) => i < last ? slice.z : Infinity);
+        let at = new Map(slices.map((slice, i) => [ slice, i ]));
+        let { flats, gaps } = meshFlats(points, zs);
+        let marks = new Uint8Array(zs.length);
+        for (let { z } of flats) {
+            // first layer at or above the flat (zs ascends to Infinity)
+            let lo = 0, hi = zs.length;
+            while (lo < hi) {
+                let mid = (lo + hi) >> 1;
+                if (zs[mid] < z) lo = mid + 1; else hi = mid;
+            }
+            // a flat on a layer plane may land on either side of it
+            let i = lo < zs.length ? lo : -1;
+            if (i >= 0) marks[i] = 1;
+            if (i >= 0 && zs[i] === z && i + 1 < zs.length) marks[i + 1] = 1;
+        }
+        return (slice, thick) => {
+            let i = at.get(slice);
+            return !(slice.up && slice.down) || marks[i] || gaps[i] > thick / 2;
+        };
+    }
+
     /**
      * Process solid fill patterns
      */
@@ -666,24 +851,46 @@ export function sliceOne(settings, widget, onupdate, ondone) {
     async function processSparseInfill() {
         let lastType;
         let promises = isConcurrent ? [] : undefined;
+        // patterns with a native generator are collected per type and
+        // density then generated and clipped together after the walk
+        let native = {};
+        // periodic surface patterns contour all their layers in one batch.
+        // concurrent fills run in minions which never see this cache
+        let batches = {};
+        for (let slice of isConcurrent ? [] : slices) {
+            let { sliceFillSparse, sliceFillType } = slice.params || process;
+            if (sliceFillSparse && !slice.isSolidLayer && slice.tops.length && !fill_native_ok(sliceFillType)) {
+                let key = `${sliceFillType}/${sliceFillSparse}`;
+                let batch = batches[key] ??= { type: sliceFillType, density: sliceFillSparse, zs: [] };
+                batch.zs.push(slice.z);
+            }
+        }
+        for (let { type, density, zs } of Object.values(batches)) {
+            fill_batch(type, density, zs);
+        }
         forSlices(0.5, promises ? 0.55 : 0.7, slice => {
             let params = slice.params || process;
             if (!params.sliceFillSparse) {
                 return;
             }
             let newType = params.sliceFillType;
+            let density = params.sliceFillSparse;
+            let batch = fill_native_ok(newType) ?
+                (native[`${newType}/${density}`] ??= { type: newType, density, layers: [] }).layers :
+                undefined;
             layerSparseFill(slice, {
                 settings,
                 process,
                 device,
                 lineWidth,
                 spacing: fillOffset,
-                density: params.sliceFillSparse,
+                density,
                 bounds: widget.getBoundingBox(),
                 height: sliceHeight,
                 type: newType,
                 cache: params._range !== true && lastType === newType,
-                promises
+                promises,
+                batch
             });
             lastType = newType;
         }, "infill");
@@ -692,6 +899,28 @@ export function sliceOne(settings, widget, onupdate, ondone) {
                 trackupdate(i / t, 0.55, 0.7);
             });
         }
+        let bounds = widget.getBoundingBox();
+        for (let { type, density, layers } of Object.values(native)) {
+            let lines = await fill_native(type, {
+                bounds,
+                lineWidth,
+                spacing: fillOffset,
+                density,
+                repeat: process.sliceFillRepeat
+            }, layers.map(({ slice, polys }) => ({ z: slice.z, index: slice.index, polys })),
+                isConcurrent ? minions : undefined);
+            layers.forEach(({ slice }, i) => {
+                for (let poly of lines[i]) {
+                    slice.isSparseFill = true;
+                    for (let top of slice.tops) {
+                        // use only polygons inside this top
+                        if (poly.isInside(top.poly)) {
+                            top.fill_sparse.push(poly);
+                        }
+                    }
+                }
+            });
+        }
         // filter out tiny fill points less than nozzle diameter
         // if (false)
         for (let slice of slices) {
@@ -1236,8 +1465,10 @@ function layerSparseFill(slice, options = {}) {
             }
         };
 
-    // use specified fill type
-    if (type && fill[type]) {
+    // use specified fill type. batched types are generated natively later
+    if (options.batch) {
+        slice.isSparseFill = false;
+    } else if (type && fill[type]) {
         fill[type](target);
     } else {
         console.log({missing_infill: type});
@@ -1278,6 +1509,11 @@ function layerSparseFill(slice, options = {}) {
         }
     }
 
+    if (options.batch) {
+        options.batch.push({ slice, polys });
+        return;
+    }
+
     let sparse_clip = slice.isSparseFill;
 
     // solid fill areas
@@ -1418,17 +1654,18 @@ function layerFillSolids({ slice, spacing, angle, minArea, promises: fillQ }) {
         return;
     }
 
-    let unioned = POLY.union(solids, undefined, true, { wasm: true }).flat(),
+    let trimmed = slice._solids_trimmed,
+        unioned = trimmed ? solids : POLY.union(solids, undefined, true, { wasm: true }).flat(),
         isSLA = (spacing === undefined && angle === undefined);
 
     if (solids.length === 0) return false;
     if (unioned.length === 0) return false;
 
-    let trims = [],
+    let trims = trimmed ? solids : [],
         inner = isSLA ? slice.topPolys() : slice.topFillOff();
 
-    // trim each solid to the inner bounds
-    for (let p of unioned) {
+    // trim each solid to the inner bounds unless done by projectSolids
+    for (let p of trimmed ? [] : unioned) {
         p.setZ(slice.z);
         for (let i of inner) {
             let masks = p.mask(i);
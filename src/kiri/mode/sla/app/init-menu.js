@@ -48,10 +48,15 @@ export function menu() {
     slaSupportDensity:   newInput(LANG.sa_sldn_s, {title:LANG.sa_sldn_l, convert:toFloat, bound:bound(0.01,0.9)}),
     slaSupportSize:      newInput(LANG.sa_slsz_s, {title:LANG.sa_slsz_l, convert:toFloat, bound:bound(0.1,1)}),
     slaSupportPoints:    newInput(LANG.sa_slpt_s, {title:LANG.sa_slpt_l, convert:toInt,   bound:bound(3,10)}),
+    slaSupportNative:    newBoolean(LANG.sa_slnt_s, onBooleanClick, {title:LANG.sa_slnt_l}),
     slaSupportEnable:    newBoolean(LANG.enable, onBooleanClick, {title:LANG.sl_slen_l}),
     slaOutput:           newGroup(LANG.sa_outp_m, $('sla-output'), { modes:SLA, driven, separator, group:"sla-output" }),
     slaFirstOffset:      newInput(LANG.sa_opzo_s, {title:LANG.sa_opzo_l, convert:toFloat, bound:bound(0,1)}),
     slaAntiAlias:        newSelect(LANG.sa_opaa_s, {title:LANG.sa_opaa_l}, "antialias"),
+    slaCompBase:         newInput(LANG.sa_cpbl_s, {title:LANG.sa_cpbl_l, convert:toInt,   bound:bound(0,100)}),
+    slaCompBaseErode:    newInput(LANG.sa_cpbe_s, {title:LANG.sa_cpbe_l, convert:toFloat, bound:bound(0,2)}),
+    slaCompErode:        newInput(LANG.sa_cper_s, {title:LANG.sa_cper_l, convert:toFloat, bound:bound(-2,2)}),
+    slaCompBlur:         newInput(LANG.sa_cpbr_s, {title:LANG.sa_cpbr_l, convert:toFloat, bound:bound(0,2)}),
 
     };
 
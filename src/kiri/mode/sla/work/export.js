@@ -3,6 +3,7 @@
 import { CXDLP } from './x_cxdlp.js';
 import { photon } from './x_photon.js';
 import { SLA } from './init-work.js';
+import { layerFilters } from './filter.js';
 
 /**
  * DRIVER CONTRACT - runs in worker
@@ -43,7 +44,9 @@ export function sla_export(print, online, ondone) {
     }
 
     if (isPhoton) {
-        let legacyMode = SLA.legacy || alias > 1,
+        // anti-aliased output comes from the canvas rasterizer unless an
+        // edge blur gives the native raster its own gray levels
+        let legacyMode = SLA.legacy || (alias > 1 && !(process.slaCompBlur > 0)),
             part1 = legacyMode ? 0.25 : 0.85,
             part2 = (1 - part1),
             images = [],
@@ -58,10 +61,12 @@ export function sla_export(print, online, ondone) {
         }
 
         let render = legacyMode ? photon.renderLayer : photon.renderLayerWasm;
+        let prev;
 
         for (let index=0; index < layermax; index++) {
-            let param = { index, width, height, widgets, scaleX, scaleY, masks };
-            let { image, layers, end, area } = render(param);
+            let filters = legacyMode ? [] : layerFilters(process, index, scaleX, scaleY, alias > 1);
+            let param = { index, width, height, widgets, scaleX, scaleY, masks, prev, filters };
+            let { image, layers, end, area } = prev = render(param);
             volume += (area * layerZ);
             images.push(image);
             slices.push(layers);
@@ -92,10 +97,12 @@ export function sla_export(print, online, ondone) {
         let part1 = 0.95;
         let part2 = 1 - part1;
         let slices = [];
+        let prev;
 
         for (let index=0; index < layermax; index++) {
-            let param = { index, width, height, widgets, scaleX, scaleY };
-            let { lines, area } = CXDLP.render(param);
+            let filters = layerFilters(process, index, scaleX, scaleY, true);
+            let param = { index, width, height, widgets, scaleX, scaleY, prev, filters };
+            let { lines, count, area } = prev = CXDLP.render(param);
             volume += (area * layerZ);
             slices.push(lines);
             online({
@@ -103,7 +110,7 @@ export function sla_export(print, online, ondone) {
                 message: "image_gen"
             });
             // bail on an empty layer
-            if (lines.length === 0) {
+            if (count === 0) {
                 break;
             }
         }
@@ -0,0 +1,150 @@
+/** Copyright Stewart Allen <sa@grid.space> -- All Rights Reserved */
+
+import { SLA } from './init-work.js';
+
+/**
+ * raster compensation for a layer as a list of { op, rx, ry } with radii
+ * in pixels. bottom layers (slaCompBase) use the base (elephant foot)
+ * erosion. all other layers use the light bleed erosion where negative
+ * values grow the image instead. edge blur applies to every layer but
+ * only when the output carries gray levels. a single bit per pixel can't
+ * hold the gradient and thresholding it again is just another erosion.
+ */
+export function layerFilters(process, index, scaleX, scaleY, gray) {
+    let filters = [];
+    let wasm = SLA.wasm;
+    if (!(wasm && wasm.raster_erode)) {
+        return filters;
+    }
+    let erode = index < (process.slaCompBase || 0) ?
+        process.slaCompBaseErode :
+        process.slaCompErode;
+    let blur = process.slaCompBlur;
+    if (erode) {
+        let op = erode > 0 ? 'erode' : 'dilate';
+        erode = Math.abs(erode);
+        filters.push({ op, rx: Math.round(erode * scaleX), ry: Math.round(erode * scaleY) });
+    }
+    if (blur > 0 && gray) {
+        filters.push({ op: 'blur', rx: Math.round(blur * scaleX), ry: Math.round(blur * scaleY) });
+    }
+    return filters.filter(f => f.rx || f.ry);
+}
+
+/**
+ * apply filters in place to the raster rendered at offset 0 between
+ * render() and encoding. `at` is the first free offset past the polygon
+ * records used for scratch memory. filters whose scratch does not fit
+ * in the wasm heap run in JS on the same raster.
+ */
+export function filterLayer(filters, width, height, at) {
+    let wasm = SLA.wasm;
+    let base = wasm.base;
+    let imagelen = width * height;
+    let avail = wasm.heap.byteLength - at;
+    for (let filter of filters) {
+        let { op, rx, ry } = filter;
+        let need = Math.max((width + rx * 2) * height, width * (height + ry * 2));
+        if (op === 'blur') {
+            need += imagelen;
+        }
+        if (need > avail) {
+            filterJS(wasm.heap.subarray(0, imagelen), width, height, filter);
+            continue;
+        }
+        switch (op) {
+            case 'erode':
+                wasm.raster_erode(base, 0, width, height, rx, ry, at);
+                break;
+            case 'dilate':
+                wasm.raster_dilate(base, 0, width, height, rx, ry, at);
+                break;
+            case 'blur':
+                // blurred image is masked by the original so only pixels
+                // inside the part are dimmed, creating an edge gradient
+                wasm.heap.copyWithin(at, 0, imagelen);
+                wasm.raster_blur(base, 0, width, height, rx, ry, at + imagelen);
+                wasm.raster_mask(base, 0, at, imagelen);
+                break;
+        }
+    }
+}
+
+// JS equivalent of the wasm kernels for rasters too large for its heap
+function filterJS(img, width, height, filter) {
+    let { op, rx, ry } = filter;
+    let orig = op === 'blur' ? img.slice() : undefined;
+    let pass = op === 'blur' ? blurLine : morphLine;
+    let arg = op === 'blur' ? undefined : op === 'dilate';
+    if (rx) {
+        let line = new Uint8Array(width);
+        let w = op === 'blur' ? blurKernel(rx) : rx;
+        for (let y=0; y<height; y++) {
+            for (let x=0; x<width; x++) line[x] = img[x * height + y];
+            let out = pass(line, w, arg);
+            for (let x=0; x<width; x++) img[x * height + y] = out[x];
+        }
+    }
+    if (ry) {
+        let w = op === 'blur' ? blurKernel(ry) : ry;
+        for (let x=0; x<width; x++) {
+            let col = img.subarray(x * height, (x + 1) * height);
+            col.set(pass(col, w, arg));
+        }
+    }
+    if (orig) {
+        for (let i=0; i<img.length; i++) {
+            let t = img[i] * orig[i] + 128;
+            img[i] = (t + (t >> 8)) >> 8;
+        }
+    }
+}
+
+// min (or max when grow) over a window of radius r. van Herk/Gil-Werman
+// block prefix and suffix runs make it O(n) for any radius
+function morphLine(src, r, grow) {
+    let n = src.length, len = r * 2 + 1, pn = n + r * 2;
+    let pad = grow ? 0 : 255;
+    let op = grow ? Math.max : Math.min;
+    let g = new Uint8Array(pn), h = new Uint8Array(pn), out = new Uint8Array(n);
+    let at = i => i < r || i >= r + n ? pad : src[i - r];
+    for (let i=0; i<pn; i++) {
+        g[i] = i % len === 0 ? at(i) : op(g[i - 1], at(i));
+    }
+    for (let i=pn-1; i>=0; i--) {
+        h[i] = i === pn - 1 || (i + 1) % len === 0 ? at(i) : op(h[i + 1], at(i));
+    }
+    for (let i=0; i<n; i++) {
+        out[i] = op(h[i], g[i + len - 1]);
+    }
+    return out;
+}
+
+// same weights as blur_kernel() in kiri-sla.c
+function blurKernel(r) {
+    let taps = r * 2 + 1;
+    let sigma = r > 1 ? r / 2 : 0.5;
+    let f = [], sum = 0;
+    for (let k=0; k<taps; k++) {
+        let d = k - r;
+        f.push(Math.exp(-(d * d) / (2 * sigma * sigma)));
+        sum += f[k];
+    }
+    let w = f.map(v => Math.floor(v * 256 / sum + 0.5));
+    w[r] += 256 - w.reduce((a, v) => a + v, 0);
+    return w;
+}
+
+// gaussian with unlit pixels past either end
+function blurLine(src, w) {
+    let n = src.length, r = (w.length - 1) / 2, out = new Uint8Array(n);
+    for (let i=0; i<n; i++) {
+        let acc = 128;
+        for (let k=0; k<w.length; k++) {
+            let j = i + k - r;
+            if (j >= 0 && j < n) acc += w[k] * src[j];
+        }
+        out[i] = acc >> 8;
+    }
+    return out;
+}
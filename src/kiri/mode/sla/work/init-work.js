@@ -18,6 +18,67 @@ if (SLA.legacy) {
 
 function init(worker) {
     // console.log({ INIT_SLA: worker });
+    // support generation during slicing uses the module when present
+    wasm_load().catch(error => console.log({ sla_wasm: error }));
+}
+
+// load the rasterizer once. resolves with SLA.wasm
+export function wasm_load() {
+    if (SLA.loading) {
+        return SLA.loading;
+    }
+    // the simd build is used wherever the runtime validates simd128
+    let simd = WebAssembly.validate(new Uint8Array([
+        0,97,115,109,1,0,0,0,1,5,1,96,0,1,123,3,2,1,0,10,10,1,8,0,65,0,253,15,253,98,11
+    ]));
+    let load = file => fetch(file)
+        .then(response => {
+            if (!response.ok) throw `${file} ${response.status}`;
+            return response.arrayBuffer();
+        })
+        .then(bytes => WebAssembly.instantiate(bytes, {
+            env: {
+                reportf: (a,b) => { console.log('[f]',a,b) },
+                reporti: (a,b) => { console.log('[i]',a,b) }
+            }
+        }));
+    // fall back to the scalar build when no simd build is deployed
+    return SLA.loading = (simd ? load('/wasm/kiri-sla-simd.wasm').catch(() => {
+        simd = false;
+        return load('/wasm/kiri-sla.wasm');
+    }) : load('/wasm/kiri-sla.wasm'))
+        .then(results => {
+            let {module, instance} = results;
+            let {exports} = instance;
+            // older builds have no heap_base and render from address 0
+            let base = exports.heap_base ? exports.heap_base() : 0;
+            let heap = new Uint8Array(exports.memory.buffer, base);
+            return SLA.wasm = {
+                base,
+                heap,
+                simd,
+                view: new DataView(exports.memory.buffer, base),
+                memory: exports.memory,
+                render: exports.render,
+                render_delta: exports.render_delta,
+                scratch_base: exports.scratch_base,
+                rle_encode: exports.rle_encode,
+                rle_encode_all: exports.rle_encode_all,
+                raster_stats: exports.raster_stats,
+                raster_lines: exports.raster_lines,
+                raster_erode: exports.raster_erode,
+                raster_dilate: exports.raster_dilate,
+                raster_blur: exports.raster_blur,
+                raster_mask: exports.raster_mask,
+                support_layer: exports.support_layer,
+                support_plan: exports.support_plan
+            };
+        })
+        .catch(error => {
+            // allow a later retry
+            SLA.loading = undefined;
+            throw error;
+        });
 }
 
 // runs in worker. would usually be in src/mode/sla/prepare.js
@@ -25,25 +86,7 @@ function init(worker) {
 async function sla_prepare(widgets, settings, update) {
     self.kiri_worker.current.print = newPrint(settings, widgets);
     if (!SLA.wasm) {
-        fetch('/wasm/kiri-sla.wasm')
-            .then(response => response.arrayBuffer())
-            .then(bytes => WebAssembly.instantiate(bytes, {
-                env: {
-                    reportf: (a,b) => { console.log('[f]',a,b) },
-                    reporti: (a,b) => { console.log('[i]',a,b) }
-                }
-            }))
-            .then(results => {
-                let {module, instance} = results;
-                let {exports} = instance;
-                let heap = new Uint8Array(exports.memory.buffer);
-                SLA.wasm = {
-                    heap,
-                    memory: exports.memory,
-                    render: exports.render,
-                    rle_encode: exports.rle_encode
-                };
-            });
+        wasm_load().catch(error => console.log({ sla_wasm: error }));
     }
     update(1);
 }
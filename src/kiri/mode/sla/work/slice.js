@@ -2,12 +2,13 @@
 
 import { util } from '../../../../geo/base.js';
 import { slicer } from '../../../../geo/slicer.js';
+import { newPoint } from '../../../../geo/point.js';
 import { newPolygon } from '../../../../geo/polygon.js';
 import { polygons as POLY } from '../../../../geo/polygons.js';
 import { newSlice, newTop } from '../../../core/slice.js';
 import { layerProcessTops, layerDiff, projectFlats, projectBridges } from '../../fdm/work/slice.js';
 import { PNG } from '../../../../ext/pngjs.esm.js';
-import { SLA } from './init-work.js';
+import { SLA, wasm_load } from './init-work.js';
 
 const tracker = util.pwait;
 
@@ -197,9 +198,15 @@ export function sla_slice(settings, widget, onupdate, ondone) {
             }, "infill");
         }
         if (process.slaSupportEnable && process.slaSupportLayers && process.slaSupportDensity) {
-            computeSupports(widget, process, progress => {
+            let onprogress = progress => {
                 doupdate(100 * progress, "support");
-            });
+            };
+            // raster planner when chosen (slaSupportNative) with the polygon
+            // planner as fallback when the module or grid is unusable
+            let wasm = process.slaSupportNative ? await wasm_load().catch(() => undefined) : undefined;
+            if (!(wasm && wasm.support_plan && computeSupportsWasm(widget, process, wasm, onprogress))) {
+                computeSupports(widget, process, onprogress);
+            }
         }
         doRender(widget);
     }
@@ -379,6 +386,149 @@ function computeSupports(widget, process, progress) {
     });
 }
 
+/**
+ * plan support pillars on occupancy rasters in wasm. each layer above the
+ * raft is rasterized into a packed bitmap then overhangs, islands, pillar
+ * placement and downward tracing all run natively. returns false when the
+ * part is too large to plan at a useful resolution in wasm memory
+ */
+export function computeSupportsWasm(widget, process, wasm, progress) {
+    let slices = widget.slices,
+        lastraft = widget.lastraft,
+        first = lastraft.index + 1,
+        layers = slices.length - first,
+        spacing = (1 - process.slaSupportDensity) * 10,
+        size = Math.bound(process.slaSupportSize / 2, 0.25, 1),
+        max = process.slaSupportSize,
+        inc = process.slaSlice / 2,
+        points = process.slaSupportPoints,
+        bounds = { minx: Infinity, maxx: -Infinity, miny: Infinity, maxy: -Infinity };
+
+    for (let i=first; i<slices.length; i++) {
+        for (let top of slices[i].tops) {
+            let b = top.poly.bounds;
+            bounds.minx = Math.min(bounds.minx, b.minx);
+            bounds.maxx = Math.max(bounds.maxx, b.maxx);
+            bounds.miny = Math.min(bounds.miny, b.miny);
+            bounds.maxy = Math.max(bounds.maxy, b.maxy);
+        }
+    }
+    if (layers < 2 || bounds.minx === Infinity) {
+        return false;
+    }
+
+    // coarsen the grid until stack, work area and output fit in memory
+    let avail = wasm.memory.buffer.byteLength - wasm.base,
+        res = size / 4,
+        width, height, radius, reach, margin, stack, work, need;
+    for (;;) {
+        radius = Math.ceil(size / 2 / res);
+        reach = Math.max(1, Math.round(process.slaSlice / res));
+        margin = radius + 2;
+        width = Math.ceil((bounds.maxx - bounds.minx) / res) + margin * 2;
+        height = Math.ceil((bounds.maxy - bounds.miny) / res) + margin * 2;
+        stack = Math.ceil(width * height / 8) * layers;
+        work = width * height * 9 + (width + reach * 2) * (height + reach * 2);
+        need = stack + work + (avail >> 3);
+        if (need <= avail && width < 65536 && height < 65536) {
+            break;
+        }
+        if ((res *= 1.25) > size) {
+            return false;
+        }
+    }
+
+    let ox = bounds.minx - margin * res,
+        oy = bounds.miny - margin * res,
+        at = stack + work,
+        view = wasm.view;
+
+    // serialize grid scaled polygons into wasm heap memory
+    function writePoly(writer, poly) {
+        let pos = writer.skip(2);
+        let inner = poly.inner;
+        let points = poly.points;
+        let bounds = poly.bounds;
+        writer.writeU16(inner ? inner.length : 0, true);
+        writer.writeU16(points.length, true);
+        writer.writeU16(Math.floor((bounds.minx - ox) / res), true);
+        writer.writeU16(Math.ceil((bounds.maxx - ox) / res), true);
+        writer.writeU16(Math.floor((bounds.miny - oy) / res), true);
+        writer.writeU16(Math.ceil((bounds.maxy - oy) / res), true);
+        for (let j=0, jl=points.length; j<jl; j++) {
+            let point = points[j];
+            writer.writeF32((point.x - ox) / res, true);
+            writer.writeF32((point.y - oy) / res, true);
+        }
+        if (inner && inner.length) {
+            for (let i=0, il=inner.length; i<il; i++) {
+                writePoly(writer, inner[i]);
+            }
+        }
+        writer.view.setUint16(pos, writer.pos - pos, true);
+    }
+
+    for (let l=0; l<layers; l++) {
+        let tops = slices[first + l].tops;
+        let writer = new self.DataWriter(view, at);
+        writer.writeU16(width, true);
+        writer.writeU16(height, true);
+        writer.writeU16(tops.length, true);
+        for (let top of tops) {
+            writePoly(writer, top.poly);
+        }
+        wasm.support_layer(wasm.base, at, stack, 0, l);
+        progress(0.5 / layers);
+    }
+
+    let count = wasm.support_plan(
+        wasm.base, 0, stack, layers, width, height,
+        Math.max(1, Math.round(Math.max(size, spacing) / res)),
+        reach, radius,
+        Math.max(1, Math.round(spacing / process.slaSlice)),
+        1, at, avail - at
+    );
+
+    // convert pillar columns into tapering support circles per slice
+    let pos = at;
+    for (let p=0; p<count; p++) {
+        let top = view.getUint16(pos, true),
+            bottom = view.getUint16(pos + 2, true),
+            flags = view.getUint16(pos + 4, true),
+            psize = size,
+            point;
+        pos += 8;
+        for (let l=top; l>=bottom; l--) {
+            point = newPoint(ox + view.getUint16(pos, true) * res, oy + view.getUint16(pos + 2, true) * res, 0);
+            addPillar(slices[first + l], point, psize);
+            psize = Math.min(max, psize + inc);
+            pos += 4;
+        }
+        // pillars reaching the floor are anchored in the top raft layer
+        if (flags & 1) {
+            addPillar(lastraft, point, psize);
+        }
+    }
+
+    function addPillar(slice, point, size) {
+        let pillar = newPolygon()
+            .centerCircle(point, size/2, points, true)
+            .setZ(slice.z);
+        (slice.supports = slice.supports || []).push(pillar);
+        (slice.pillars = slice.pillars || []).push({ point, pillar, size });
+    }
+
+    // union support pillars
+    slices.forEach(slice => {
+        if (slice.supports) {
+            slice.supports = POLY.union(slice.supports, 0, true);
+        }
+    });
+    progress(0.5);
+
+    return true;
+}
+
 function projectSupport(process, slice, poly, size, spacing) {
     let flat = poly.circularityDeep() > 0.1,
         arr = [ poly ];
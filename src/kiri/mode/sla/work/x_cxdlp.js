@@ -1,5 +1,7 @@
 /** Copyright Stewart Allen <sa@grid.space> -- All Rights Reserved */
 
+import { filterLayer } from './filter.js';
+
 const default_values = {
     magic1: 'CXSW3DV2',
     magic2: 'CXSW3DV2',
@@ -245,8 +247,18 @@ export class CXDLP {
             layer.l2 = output.pos;
             // placeholder to be written post
             output.writeU32(0);
+            let start;
+            if (layer.lines.buffer) {
+                // pre-encoded 6 byte line records from raster_lines()
+                output.writeU32(layer.lines.length / 6);
+                start = output.pos;
+                output.writeBytes(layer.lines);
+                layer.length = output.pos - start;
+                output.writeU16(data_term);
+                continue;
+            }
             output.writeU32(layer.lines.length);
-            let start = output.pos;
+            start = output.pos;
             for (let line of layer.lines) {
                 let b1 = (line.y_start >> 5);
                 let b2 = ((line.y_start << 3) | (line.y_end >> 10)) & 0xff;
@@ -331,7 +343,7 @@ CXDLP.export = function(params) {
 };
 
 CXDLP.render = function(params) {
-    let { width, height, index, widgets, scaleX, scaleY  } = params;
+    let { width, height, index, widgets, scaleX, scaleY, prev, filters } = params;
     let width2 = width / 2, height2 = height / 2;
     let array = [];
     let count = 0;
@@ -394,7 +406,7 @@ CXDLP.render = function(params) {
 
     let wasm = kiri.driver.SLA.wasm;
     let imagelen = width * height;
-    let writer = new self.DataWriter(new DataView(wasm.memory.buffer), imagelen);
+    let writer = new self.DataWriter(wasm.view, imagelen);
     writer.writeU16(width, true);
     writer.writeU16(height, true);
     writer.writeU16(array.length, true);
@@ -406,8 +418,79 @@ CXDLP.render = function(params) {
         scaleMovePoly(poly);
         writePoly(writer, poly);
     }
-    wasm.render(0, imagelen, 0);
     let image = wasm.heap;//.slice(0, imagelen);
+    // line records must stay below the render_delta() scratch block
+    let limit = () => wasm.scratch_base ? wasm.scratch_base() - wasm.base : image.byteLength;
+
+    // when the previous layer was encoded natively, redraw only the region
+    // that changed and reuse its line records for all untouched columns
+    // filtered rasters no longer match their polygons and can't be reused
+    let filtered = filters && filters.length > 0;
+    if (wasm.render_delta && prev && prev.lines.buffer && !prev.filtered && !filtered) {
+        let region = writer.pos;
+        let polyend = wasm.render_delta(wasm.base, imagelen, 0, region) + 8;
+        let dirty = new DataView(wasm.memory.buffer, wasm.base + region, 8);
+        let minx = dirty.getUint16(0, true);
+        let maxx = dirty.getUint16(2, true);
+        if (minx === maxx) {
+            return { lines: prev.lines, count: prev.count, area };
+        }
+        let max = Math.max(0, ((limit() - polyend) / 6) | 0);
+        let count = wasm.raster_lines(wasm.base, 0, height, minx, maxx - 1, polyend, max);
+        if (count <= max) {
+            let lo = lineIndex(prev.lines, minx);
+            let hi = lineIndex(prev.lines, maxx);
+            let lines = new Uint8Array((lo + count + prev.count - hi) * 6);
+            lines.set(prev.lines.subarray(0, lo * 6));
+            lines.set(image.subarray(polyend, polyend + count * 6), lo * 6);
+            lines.set(prev.lines.subarray(hi * 6), (lo + count) * 6);
+            return { lines, count: lines.length / 6, area };
+        }
+        return scanLines(image, width, height, area);
+    }
+
+    let polyend = wasm.render(wasm.base, imagelen, 0);
+    if (filtered) {
+        filterLayer(filters, width, height, polyend);
+    }
+
+    // native line extraction writes encoded records after the poly data
+    if (wasm.raster_lines) {
+        // CXDLP layers carry no pixel count or bounds, so the stats are
+        // only used to limit the scan to lit columns. read them before
+        // raster_lines() overwrites the stats record with line data
+        let pixels = wasm.raster_stats(wasm.base, 0, width, height, polyend);
+        let stats = new DataView(wasm.memory.buffer, wasm.base + polyend, 12);
+        let minx = stats.getUint16(4, true);
+        let maxx = stats.getUint16(6, true);
+        let max = Math.max(0, ((limit() - polyend) / 6) | 0);
+        let count = pixels ? wasm.raster_lines(wasm.base, 0, height, minx, maxx, polyend, max) : 0;
+        if (count <= max) {
+            let lines = image.slice(polyend, polyend + count * 6);
+            return { lines, count, area, filtered };
+        }
+    }
+
+    return scanLines(image, width, height, area);
+}
+
+// index of the first encoded line record in column x or greater
+function lineIndex(lines, x) {
+    let lo = 0, hi = lines.length / 6;
+    while (lo < hi) {
+        let mid = (lo + hi) >> 1;
+        let p = mid * 6;
+        if ((((lines[p + 3] & 0x3f) << 8) | lines[p + 4]) < x) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// JS fallback line extraction from the rendered raster
+function scanLines(image, width, height, area) {
     let lines = [];
     for (let x=0; x<width; x++) {
         let y_start = 0;
@@ -426,6 +509,10 @@ CXDLP.render = function(params) {
             }
             lastv = v;
         }
+        // close any sequence reaching the end of the column
+        if (lastv) {
+            lines.push({y_start, y_end: height, x_end: x, color: lastv});
+        }
     }
-    return { lines, area };
+    return { lines, count: lines.length, area };
 }
@@ -1,6 +1,7 @@
 /** Copyright Stewart Allen <sa@grid.space> -- All Rights Reserved */
 
 import { SLA } from './init-work.js';
+import { filterLayer } from './filter.js';
 
 function generatePhoton(print, conf, progress) {
     let printset = print.settings,
@@ -384,7 +385,7 @@ function writePhotonImage(preview, writer) {
 
 // new WebAssembly rasterizer
 function renderLayerWasm(params) {
-    let { width, height, index, widgets, scaleX, scaleY, masks } = params;
+    let { width, height, index, widgets, scaleX, scaleY, masks, prev, filters } = params;
     let width2 = width / 2, height2 = height / 2;
     let array = [];
     let count = 0;
@@ -447,7 +448,7 @@ function renderLayerWasm(params) {
 
     let wasm = SLA.wasm;
     let imagelen = width * height;
-    let writer = new self.DataWriter(new DataView(wasm.memory.buffer), imagelen);
+    let writer = new self.DataWriter(wasm.view, imagelen);
     writer.writeU16(width, true);
     writer.writeU16(height, true);
     writer.writeU16(array.length, true);
@@ -459,16 +460,47 @@ function renderLayerWasm(params) {
         scaleMovePoly(poly);
         writePoly(writer, poly);
     }
-    wasm.render(0, imagelen, 0);
+    // identical consecutive layers reuse the previous image and encoding
+    // filtered rasters no longer match their polygons and can't be reused
+    let filtered = filters && filters.length > 0;
+    if (wasm.render_delta && prev && prev.layers && !prev.filtered && !prev.stale && !filtered) {
+        let region = writer.pos;
+        wasm.render_delta(wasm.base, imagelen, 0, region);
+        if (wasm.view.getUint16(region, true) === wasm.view.getUint16(region + 2, true)) {
+            return { image: prev.image, layers: prev.layers, end: count === 0, area };
+        }
+    } else {
+        let polyend = wasm.render(wasm.base, imagelen, 0);
+        if (filtered) {
+            filterLayer(filters, width, height, polyend);
+        }
+    }
     let image = wasm.heap.slice(0, imagelen), layers = [];
+    // rle streams that may reach the render_delta() scratch block leave
+    // no baseline for the next layer, which then renders in full
+    let limit = wasm.scratch_base ? wasm.scratch_base() - wasm.base : wasm.heap.byteLength;
+    let stale = imagelen * (masks.length + 1) + masks.length * 4 > limit;
     // one rle encoded bitstream for each mash (anti-alias sublayer)
-    for (let l=0; l<masks.length; l++) {
-        // while the image is still in wasm heap memory, rle encode it
-        let rlelen = wasm.rle_encode(0, 0, imagelen, masks[l], imagelen, 0);
-        layers.push(wasm.heap.slice(imagelen, imagelen + rlelen));
+    if (wasm.rle_encode_all && masks.length <= 4) {
+        // all masks encoded in one pass. streams follow the image, one
+        // image length apart, with their lengths stored after the last
+        let packed = masks.reduce((p, mask, i) => p | (mask << (i * 8)), 0) >>> 0;
+        let lens = imagelen * (masks.length + 1);
+        wasm.rle_encode_all(wasm.base, 0, imagelen, packed, imagelen, lens, 0);
+        for (let l=0; l<masks.length; l++) {
+            let start = imagelen * (l + 1);
+            let rlelen = wasm.view.getUint32(lens + l * 4, true);
+            layers.push(wasm.heap.slice(start, start + rlelen));
+        }
+    } else {
+        for (let l=0; l<masks.length; l++) {
+            // while the image is still in wasm heap memory, rle encode it
+            let rlelen = wasm.rle_encode(wasm.base, 0, imagelen, masks[l], imagelen, 0);
+            layers.push(wasm.heap.slice(imagelen, imagelen + rlelen));
+        }
     }
 
-    return { image, layers, end: count === 0, area };
+    return { image, layers, end: count === 0, area, filtered, stale };
 }
 
 // legacy JS-only rasterizer uses OffscreenCanvas
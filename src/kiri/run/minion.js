@@ -9,15 +9,15 @@ import '../../add/three.js';
 import { base } from '../../geo/base.js';
 import { codec, encode, encodePointArray } from '../core/codec.js';
 import { layerProcessTop } from '../mode/fdm/work/post.js';
-import { newPoint } from '../../geo/point.js';
 import { newWidget } from '../core/widget.js';
 import { polygons as POLY } from '../../geo/polygons.js';
 import { sliceZ, sliceConnect } from '../../geo/slicer.js';
 import { Slicer as cam_slicer } from '../mode/cam/work/slicer-cam.js';
 import { Slicer as topo_slicer } from '../mode/cam/work/slicer-topo.js';
-import { Probe, Trace, raster_slice } from '../mode/cam/work/topo3.js';
+import { Probe, Trace, raster_slice, raster_native } from '../mode/cam/work/topo3.js';
+import { TOPO } from '../mode/cam/work/topo-wasm.js';
 import { Topo as Topo4, rotatePoints } from '../mode/cam/work/topo4.js';
-import { wasm_ctrl } from '../../geo/wasm.js';
+import { fillSparse, wasm_ctrl } from '../../geo/wasm.js';
 
 const clib = self.ClipperLib;
 const ctyp = clib.ClipType;
@@ -141,13 +141,10 @@ const funcs = self.minion = {
     sliceZ(data, seq) {
         debug('minion.sliceZ', { data, seq });
         let { z, points, options } = data;
-        let i = 0, p = 0, realp = new Array(points.length / 3);
-        while (i < points.length) {
-            realp[p++] = newPoint(points[i++], points[i++], points[i++]).round(3);
-        }
         let state = { zero: [] };
         let output = [];
-        sliceZ(z, realp, {
+        // flat points go straight to the native slicer when enabled
+        sliceZ(z, points, {
             ...options,
             each(out) { output.push(out) }
         }).then(() => {
@@ -159,6 +156,17 @@ const funcs = self.minion = {
         });
     },
 
+    fillSparse(data, seq) {
+        if (!base.wasm?.fn.fill) {
+            reply({ seq, lines: null });
+            return;
+        }
+        let { type, opt, layers } = data;
+        let lines = fillSparse(type, layers.map(layer => ({ ...layer, polys: codec.decode(layer.polys) })), opt);
+        let state = { zeros: [] };
+        reply({ seq, lines: codec.encode(lines, state) }, state.zeros);
+    },
+
     putCache(msg) {
         const { key, data } = msg;
         // log({ minion_putCache: key, data });
@@ -212,7 +220,19 @@ const funcs = self.minion = {
     // CAM Topo3 support
 
     topo_raster(data, seq) {
-        const { id, slice, params } = data;
+        const { id, slice, tile, params } = data;
+        // native raster of a column tile
+        if (tile) {
+            TOPO.load()
+                .then(wasm => {
+                    const box = raster_native(wasm, cache[id], params, tile.x0, tile.x1);
+                    reply({ seq, box });
+                })
+                .catch(error => {
+                    reply({ seq, error: error.toString() });
+                });
+            return;
+        }
         const { resolution } = params;
         const vertices = cache[id];
         const box = new THREE.Box2();
@@ -13,9 +13,10 @@ import { newPrint } from '../core/print.js';
 import { polygons as POLY } from '../../geo/polygons.js';
 import { RasterPath } from '../../gpu/raster.js';
 import { render } from '../core/render.js';
+import { sliceCacheClear, sliceCacheMetrics } from '../core/slice-cache.js';
 import { util } from '../../geo/base.js';
 import { version } from '../../moto/license.js';
-import { wasm_ctrl } from '../../geo/wasm.js';
+import { fillSparse, wasm_ctrl } from '../../geo/wasm.js';
 import { Widget, newWidget } from '../core/widget.js';
 
 import { CAM } from '../mode/cam/work/init-work.js';
@@ -48,6 +49,7 @@ let drivers = {
     wgroup = {},
     wcache = {},
     pcache = {},
+    vcache = new WeakMap(),
     minions = [],
     minionq = [],
     minifns = {},
@@ -219,30 +221,90 @@ const minwork = {
     sliceZ(z, points, options) {
         return new Promise((resolve, reject) => {
             if (concurrent < 2) {
-                reject("concurrent slice unavaiable");
+                return reject("concurrent slice unavaiable");
             }
             let { each } = options;
-            // todo use shared array buffer?
-            let i = 0, floatP = new Float32Array(points.length * 3);
-            for (let p of points) {
-                floatP[i++] = p.x;
-                floatP[i++] = p.y;
-                floatP[i++] = p.z;
+            let zs = Array.isArray(z) ? z : [ z ];
+            if (zs.length === 0) {
+                return resolve([]);
             }
-            minwork.queue({
-                cmd: "sliceZ",
-                z,
-                points: floatP,
-                options: codec.toCodable(options)
-            }, data => {
-                let recs = codec.decode(data.output);
-                if (each) {
-                    for (let rec of recs) {
-                        each(rec);
-                    }
+            // cached slices need no vertices. otherwise they are written
+            // once per mesh to shared memory when available and read in
+            // place by every minion on every slice of that mesh
+            let floatP = options.cached ? new Float32Array(0) : vcache.get(points);
+            if (!floatP) {
+                let count = points.length * 3;
+                floatP = self.SharedArrayBuffer ?
+                    new Float32Array(new SharedArrayBuffer(count * 4)) :
+                    new Float32Array(count);
+                let i = 0;
+                for (let p of points) {
+                    floatP[i++] = p.x;
+                    floatP[i++] = p.y;
+                    floatP[i++] = p.z;
                 }
-                resolve(recs);
-            }, [ floatP.buffer ]);
+                vcache.set(points, floatP);
+            }
+            // one disjoint run of layers per minion
+            let size = Math.ceil(zs.length / concurrent);
+            let runs = Math.ceil(zs.length / size);
+            let done = new Array(runs);
+            let opts = codec.toCodable(options);
+            let output = [];
+            let next = 0;
+            for (let run = 0; run < runs; run++) {
+                minwork.queue({
+                    cmd: "sliceZ",
+                    z: zs.slice(run * size, (run + 1) * size),
+                    points: floatP,
+                    options: opts
+                }, data => {
+                    done[run] = codec.decode(data.output);
+                    // stream results back in layer order
+                    while (next < runs && done[next]) {
+                        for (let rec of done[next]) {
+                            output.push(rec);
+                            if (each) each(rec);
+                        }
+                        done[next++] = true;
+                    }
+                    if (next === runs) {
+                        resolve(output);
+                    }
+                });
+            }
+        });
+    },
+
+    // native sparse fill with one run of layers per minion. a minion
+    // without the wasm module loaded hands its run back to this worker
+    fillSparse(type, layers, opt) {
+        return new Promise((resolve, reject) => {
+            if (concurrent < 2) {
+                return reject("concurrent fill unavailable");
+            }
+            if (layers.length === 0) {
+                return resolve([]);
+            }
+            let size = Math.ceil(layers.length / concurrent);
+            let runs = Math.ceil(layers.length / size);
+            let output = new Array(layers.length);
+            for (let at = 0; at < layers.length; at += size) {
+                let run = layers.slice(at, at + size);
+                let state = { zeros: [] };
+                minwork.queue({
+                    cmd: "fillSparse",
+                    type,
+                    opt,
+                    layers: run.map(({ z, index, polys }) => ({ z, index, polys: codec.encode(polys, state) }))
+                }, data => {
+                    let lines = data.lines ? codec.decode(data.lines) : fillSparse(type, run, opt);
+                    lines.forEach((polys, i) => output[at + i] = polys);
+                    if (--runs === 0) {
+                        resolve(output);
+                    }
+                }, state.zeros);
+            }
         });
     },
 
@@ -713,6 +775,14 @@ const dispatch = {
         pcache = {};
         minwork.broadcast("clearCache", msg);
         send.done({ ok: true });
+    },
+
+    // binary slice cache metrics. clear drops every cached mesh
+    sliceCache(msg, send) {
+        if (msg?.clear) {
+            sliceCacheClear();
+        }
+        send.done(sliceCacheMetrics());
     }
 };
 
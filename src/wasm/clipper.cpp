@@ -1086,8 +1086,10 @@ bool ClipperBase::AddPath(const Path &pg, PolyType PolyTyp, bool Closed)
   TEdge *E = eStart, *eLoopStop = eStart;
   for (;;)
   {
-    //nb: allows matching start and end points when not Closed ...
-    if (E->Curr == E->Next->Curr && (Closed || E->Next != eStart))
+    //open paths keep repeated points like the javascript port, whose
+    //check compares point references, so zero length edges split the
+    //result the same way there
+    if (Closed && E->Curr == E->Next->Curr)
     {
       if (E == E->Next) break;
       if (E == eStart) eStart = E->Next;
@@ -1248,7 +1250,11 @@ void ClipperBase::Reset()
 {
   m_CurrentLM = m_MinimaList.begin();
   if (m_CurrentLM == m_MinimaList.end()) return; //ie nothing to process
-  std::sort(m_MinimaList.begin(), m_MinimaList.end(), LocMinSorter());
+  //minima at the same Y keep the reverse of the order they were added in,
+  //as the javascript port's sorted insert leaves them, so that coincident
+  //edges meet in the same order and degenerate cases resolve the same way
+  std::reverse(m_MinimaList.begin(), m_MinimaList.end());
+  std::stable_sort(m_MinimaList.begin(), m_MinimaList.end(), LocMinSorter());
 
   m_Scanbeam = ScanbeamList(); //clears/resets priority_queue
   //reset all edges ...
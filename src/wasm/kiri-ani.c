@@ -1,24 +1,1370 @@
 #include <emscripten.h>
 #include <string.h>
+#include <math.h>
 
 typedef unsigned char Uint8;
 typedef unsigned short Uint16;
 typedef unsigned int Uint32;
+typedef short Int16;
+typedef int Sint32;
 
 extern void reportf(float a, float b);
 extern void reporti(int a, int b);
+extern unsigned char __heap_base;
+
+// one tool profile cell: grid offset from the profile corner and the
+// z offset of the tool surface from the tool tip at that cell as made
+// by Tool.generateProfile() (zero at the tip, negative above it)
+struct tcell {
+    Int16 dx;
+    Int16 dy;
+    float dz;
+};
+
+// a move in stock coordinates (mm from the stock min corner)
+struct move {
+    float x;
+    float y;
+    float z;
+    Uint32 flags; // 1 = cut from the previous move, 0 = position only
+};
+
+// changed grid cells. columns minx to maxx - 1, rows miny to maxy - 1
+struct region {
+    Uint32 minx;
+    Uint32 maxx;
+    Uint32 miny;
+    Uint32 maxy;
+};
+
+#define MOVE_CUT 1
+
+// heightfield stock grid registered by stock_init()
+float *grid;
+Uint32 grid_width;  // columns (x)
+Uint32 grid_height; // cells per column (y)
+float grid_step;    // cell size in mm
+
+// tool profile registered by tool_init()
+struct tcell *tool;
+Uint32 tool_count;
+float tool_size;    // profile width in mm
+Uint32 tool_mid;    // profile cell under the tool tip
+float tool_step;    // profile cell size in mm
+
+// radially symmetric tool surface height by distance from the tip axis
+// in quarter cells. used to sweep the profile along moves
+#define RADIAL_BINS 4
+#define RADIAL_MAX 16384
+float radial[RADIAL_MAX + 1];
+float bin_r[RADIAL_MAX + 1];  // radius of each bin's lowest cell (-1 empty)
+float hull_r[RADIAL_MAX + 1];
+float hull_z[RADIAL_MAX + 1];
+Uint32 radial_len;  // bins in use
+float tool_reach;   // profile radius in cells
+float tool_floor;   // lowest tool surface height above the tip
+Uint8 tool_convex;  // profile is convex. moves sweep instead of stepping
+
+// cells more than this fraction of a profile cell above the convex hull
+// mark a non-convex profile
+#define CONVEX_TOL 0.01f
+
+// dirty bounds accumulated while applying moves
+struct region dirty;
+
+// highest cell of each square block of the grid. heights only fall so
+// a block top stays an upper bound until it is recomputed. lowering a
+// cell marks its block stale. lets sweeps and collision checks skip
+// blocks entirely below the tool
+#define BLOCK_MAX 65536
+float block_top[BLOCK_MAX];
+Uint8 block_stale[BLOCK_MAX];
+Uint32 block_shift;  // log2 of block size in cells
+Uint32 blocks_y;     // blocks per grid column
+
+// non-cutting part of the tool (shank, holder) as stacked cylinders
+// above the tool tip, registered by body_init()
+#define BODY_MAX 8
+struct body {
+    float z0;   // cylinder bottom above the tip
+    float z1;   // cylinder top above the tip
+    float r;    // cylinder radius
+};
+struct body body[BODY_MAX];
+Uint32 body_count;
+
+// a body collision reported by stock_collide() and dexel_collide()
+struct hit {
+    Uint32 move;  // index of the move ending the colliding segment
+    float depth;  // deepest penetration into the stock in mm
+};
+
+// ignore contact shallower than this (mm)
+#define HIT_MIN 1e-3f
+
+// material removed by one move, written by stock_collide() and
+// dexel_collide() when a stats location is given
+struct stat {
+    float volume;  // removed volume in mm^3
+    float engage;  // widest engagement of the cutter in degrees
+    float depth;   // deepest axial cut in mm
+};
+
+// removal of the move in progress. lateral offsets are the signed
+// distances of cut cells from the path, used for the engagement angle
+Uint8 stat_on;
+float stat_volume;
+float stat_depth;
+float stat_hmin;
+float stat_hmax;
+
+/**
+ * returns the first memory location past static data and stack.
+ * callers pass this as the memory base pointer so the grid and
+ * buffers never overwrite module data
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 heap_base() {
+    return (Uint32)&__heap_base;
+}
+
+/**
+ * initialize a heightfield stock grid. cells are column major
+ * (cell x,y at x * height + y). border cells are zero so the
+ * stock renders with walls
+ *
+ * m      = memory base pointer
+ * o      = grid memory location (width * height floats)
+ * width  = grid columns
+ * height = grid cells per column
+ * step   = cell size in mm
+ * z      = stock top
+ */
+EMSCRIPTEN_KEEPALIVE
+void stock_init(unsigned char *m, Uint32 o, Uint32 width, Uint32 height, float step, float z) {
+    grid = (float *)(m + o);
+    grid_width = width;
+    grid_height = height;
+    grid_step = step;
+    for (Uint32 x=0; x<width; x++) {
+        float *col = grid + x * height;
+        Uint8 edge = x == 0 || x == width - 1;
+        for (Uint32 y=0; y<height; y++) {
+            col[y] = edge || y == 0 || y == height - 1 ? 0 : z;
+        }
+    }
+    block_shift = 3;
+    while (((width >> block_shift) + 1) * ((height >> block_shift) + 1) > BLOCK_MAX) {
+        block_shift++;
+    }
+    blocks_y = (height >> block_shift) + 1;
+    for (Uint32 b=0; b<((width >> block_shift) + 1) * blocks_y; b++) {
+        block_top[b] = z;
+        block_stale[b] = 0;
+    }
+}
+
+/**
+ * call after the grid heights were replaced from outside (restoring
+ * a snapshot) so every block bound is rebuilt on next use
+ */
+EMSCRIPTEN_KEEPALIVE
+void stock_touch() {
+    memset(block_stale, 1, ((grid_width >> block_shift) + 1) * blocks_y);
+}
+
+// upper bound of the cells in block bx,by. stale blocks are rescanned
+static float block_height(Uint32 bx, Uint32 by) {
+    Uint32 b = bx * blocks_y + by;
+    if (block_stale[b]) {
+        Uint32 x0 = bx << block_shift, y0 = by << block_shift;
+        Uint32 x1 = x0 + (1 << block_shift), y1 = y0 + (1 << block_shift);
+        float top = -1e30f;
+        if (x1 > grid_width) x1 = grid_width;
+        if (y1 > grid_height) y1 = grid_height;
+        for (Uint32 x=x0; x<x1; x++) {
+            float *col = grid + x * grid_height;
+            for (Uint32 y=y0; y<y1; y++) {
+                if (col[y] > top) top = col[y];
+            }
+        }
+        block_top[b] = top;
+        block_stale[b] = 0;
+    }
+    return block_top[b];
+}
 
 /**
+ * register the active tool profile
+ *
+ * m     = memory base pointer
+ * p     = profile memory location (count tcell records)
+ * count = number of profile cells
+ * size  = profile width in mm
+ * mid   = profile cell offset of the tool tip
+ * step  = profile cell size in mm
+ */
+EMSCRIPTEN_KEEPALIVE
+void tool_init(unsigned char *m, Uint32 p, Uint32 count, float size, Uint32 mid, float step) {
+    tool = (struct tcell *)(m + p);
+    tool_count = count;
+    tool_size = size;
+    tool_mid = mid;
+    tool_step = step;
+
+    // fold the profile cells into a radial table of the tool surface
+    // height above the tip by distance from the axis. bins hold the
+    // lowest cell and bin_r its radius (-1 when empty)
+    radial_len = 0;
+    for (Uint32 i=0; i<count; i++) {
+        float dx = (float)tool[i].dx - tool_mid, dy = (float)tool[i].dy - tool_mid;
+        float r = sqrtf(dx * dx + dy * dy), h = -tool[i].dz;
+        Uint32 bin = (Uint32)(r * RADIAL_BINS + 0.5f);
+        if (bin > RADIAL_MAX) continue;
+        while (radial_len <= bin) {
+            bin_r[radial_len] = -1;
+            radial[radial_len++] = 0;
+        }
+        if (bin_r[bin] < 0 || h < radial[bin]) {
+            bin_r[bin] = r;
+            radial[bin] = h;
+        }
+    }
+    Uint32 bins = radial_len;
+
+    // lower convex hull of (radius, height). end mill profiles are convex
+    // so the hull only smooths binning which would otherwise trap the
+    // sweep search in false minima
+    Uint32 hn = 0;
+    for (Uint32 b=0; b<bins; b++) {
+        if (bin_r[b] < 0) continue;
+        float r = bin_r[b], z = radial[b];
+        while (hn >= 2) {
+            float ax = hull_r[hn - 2], az = hull_z[hn - 2];
+            float bx = hull_r[hn - 1], bz = hull_z[hn - 1];
+            if ((bx - ax) * (z - az) - (bz - az) * (r - ax) > 0) break;
+            hn--;
+        }
+        hull_r[hn] = r;
+        hull_z[hn++] = z;
+    }
+
+    // any cell standing above the hull makes the profile non-convex.
+    // the sweep would cut under it so moves fall back to stepping
+    tool_convex = 1;
+    for (Uint32 i=0; i<count && hn >= 2; i++) {
+        float dx = (float)tool[i].dx - tool_mid, dy = (float)tool[i].dy - tool_mid;
+        float r = sqrtf(dx * dx + dy * dy);
+        Uint32 lo = 0, hi = hn - 1;
+        if (r >= hull_r[hi]) continue;
+        while (hi - lo > 1) {
+            Uint32 k = (lo + hi) >> 1;
+            if (hull_r[k] <= r) lo = k; else hi = k;
+        }
+        float f = (r - hull_r[lo]) / (hull_r[hi] - hull_r[lo]);
+        float z = hull_z[lo] + (hull_z[hi] - hull_z[lo]) * (f < 0 ? 0 : f);
+        if (-tool[i].dz - z > CONVEX_TOL * step) {
+            tool_convex = 0;
+            break;
+        }
+    }
+
+    if (!tool_convex) {
+        // keep the binned profile. fill empty bins between their neighbors
+        Uint32 last = 0;
+        for (Uint32 b=1; b<bins; b++) {
+            if (bin_r[b] < 0) continue;
+            for (Uint32 e=last+1; e<b; e++) {
+                radial[e] = radial[last] + (radial[b] - radial[last]) * (e - last) / (b - last);
+            }
+            last = b;
+        }
+        radial_len = bins;
+        tool_reach = (float)(bins - 1) / RADIAL_BINS;
+        tool_floor = radial[0];
+        for (Uint32 b=0; b<bins; b++) {
+            if (radial[b] < tool_floor) tool_floor = radial[b];
+        }
+        return;
+    }
+
+    for (Uint32 b=0, k=0; b<bins; b++) {
+        float r = (float)b / RADIAL_BINS;
+        while (k + 2 < hn && hull_r[k + 1] <= r) k++;
+        if (hn < 2 || r <= hull_r[0]) {
+            radial[b] = hull_z[0];
+        } else {
+            float f = (r - hull_r[k]) / (hull_r[k + 1] - hull_r[k]);
+            radial[b] = hull_z[k] + (hull_z[k + 1] - hull_z[k]) * (f > 1 ? 1 : f);
+        }
+    }
+    radial_len = hn ? (Uint32)(hull_r[hn - 1] * RADIAL_BINS) + 1 : 0;
+    tool_reach = hn ? hull_r[hn - 1] : 0;
+    tool_floor = 0;
+    for (Uint32 k=0; k<hn; k++) {
+        if (k == 0 || hull_z[k] < tool_floor) tool_floor = hull_z[k];
+    }
+}
+
+// tool surface height at a distance of r cells from the tip axis
+static inline float radial_at(float r) {
+    float f = r * RADIAL_BINS;
+    Uint32 b = (Uint32)f;
+    if (b + 1 >= radial_len) {
+        return radial[radial_len - 1];
+    }
+    return radial[b] + (radial[b + 1] - radial[b]) * (f - b);
+}
+
+// cell coordinate of the tool tip. the profile corner cell is
+// floor((v - size / 2) / step) and the tip is tool_mid cells in
+static inline float cell_of(float v) {
+    return (v - tool_size / 2) / grid_step + tool_mid;
+}
+
+// minimum over t in [lo, hi] of dz * t + radial(distance to the tip axis)
+// where the squared distance at t is (t - t0)^2 * ll + hh. scale converts
+// distance units to profile cells. the function is convex in t so level
+// moves use the closest approach and ramps a golden section search
+static float envelope(float dz, float t0, float ll, float hh, float lo, float hi, float scale) {
+    if (dz == 0) {
+        float t = fminf(hi, fmaxf(lo, t0)) - t0;
+        return radial_at(sqrtf(t * t * ll + hh) * scale);
+    }
+    const float g = 0.618034f;
+    float p = hi - (hi - lo) * g, q = lo + (hi - lo) * g;
+    float sp = p - t0, sq = q - t0;
+    float fp = dz * p + radial_at(sqrtf(sp * sp * ll + hh) * scale);
+    float fq = dz * q + radial_at(sqrtf(sq * sq * ll + hh) * scale);
+    for (Uint32 k=0; k<20; k++) {
+        if (fp < fq) {
+            hi = q; q = p; fq = fp;
+            p = hi - (hi - lo) * g;
+            sp = p - t0;
+            fp = dz * p + radial_at(sqrtf(sp * sp * ll + hh) * scale);
+        } else {
+            lo = p; p = q; fp = fq;
+            q = lo + (hi - lo) * g;
+            sq = q - t0;
+            fq = dz * q + radial_at(sqrtf(sq * sq * ll + hh) * scale);
+        }
+    }
+    return fminf(fp, fq);
+}
+
+static void stat_begin() {
+    stat_volume = 0;
+    stat_depth = 0;
+    stat_hmin = 1e30f;
+    stat_hmax = -1e30f;
+}
+
+// a cell lowered by cut at lateral offset h (mm) from the path
+static inline void stat_cell(float cut, float area, float h) {
+    stat_volume += cut * area;
+    if (cut > stat_depth) stat_depth = cut;
+    if (h < stat_hmin) stat_hmin = h;
+    if (h > stat_hmax) stat_hmax = h;
+}
+
+// finish a move. the engaged arc of the leading half of a cutter of
+// radius r spanning lateral offsets h0 to h1 is acos(h0/r) - acos(h1/r).
+// offsets are cell centers so they widen by half a cell (pad). moves
+// without lateral travel engage the whole cutter
+static void stat_end(struct stat *out, float r, float pad, Uint8 lateral) {
+    out->volume = stat_volume;
+    out->depth = stat_depth;
+    out->engage = 0;
+    if (stat_volume <= 0 || r <= 0) {
+        return;
+    }
+    if (!lateral) {
+        out->engage = 360;
+        return;
+    }
+    float h0 = fmaxf(-1, fminf(1, (stat_hmin - pad) / r));
+    float h1 = fmaxf(-1, fminf(1, (stat_hmax + pad) / r));
+    out->engage = (acosf(h0) - acosf(h1)) * 180 / 3.14159265f;
+}
+
+/**
+ * lower the grid to the lower envelope of the tool swept from a to b.
+ * for each cell in reach of the segment the height is the minimum over
+ * the move of z(t) + radial(distance to the tip axis at t)
+ */
+void sweep(struct move *a, struct move *b) {
+    float ax = cell_of(a->x), ay = cell_of(a->y);
+    float dx = cell_of(b->x) - ax, dy = cell_of(b->y) - ay, dz = b->z - a->z;
+    float ll = dx * dx + dy * dy;
+    float rr = tool_reach * tool_reach;
+    int x0 = (int)floorf(fminf(ax, ax + dx) - tool_reach);
+    int x1 = (int)ceilf(fmaxf(ax, ax + dx) + tool_reach);
+    int y0 = (int)floorf(fminf(ay, ay + dy) - tool_reach);
+    int y1 = (int)ceilf(fmaxf(ay, ay + dy) + tool_reach);
+
+    if (!radial_len) return;
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= (int)grid_width) x1 = grid_width - 1;
+    if (y1 >= (int)grid_height) y1 = grid_height - 1;
+
+    // nothing under the lowest point of the tool can change
+    float floor = fminf(a->z, b->z) + tool_floor;
+    Uint32 bs = block_shift;
+    for (int bx=x0>>bs; bx<=x1>>bs; bx++)
+    for (int by=y0>>bs; by<=y1>>bs; by++) {
+        if (block_height(bx, by) <= floor) continue;
+        int xe = ((bx + 1) << bs) - 1, ye = ((by + 1) << bs) - 1;
+        Uint8 cut = 0;
+        for (int gx=bx<<bs > x0 ? bx<<bs : x0; gx<=(xe < x1 ? xe : x1); gx++) {
+            float vx = gx - ax;
+            float *col = grid + gx * grid_height;
+            for (int gy=by<<bs > y0 ? by<<bs : y0; gy<=(ye < y1 ? ye : y1); gy++) {
+                if (col[gy] <= floor) continue;
+                float vy = gy - ay;
+                float vv = vx * vx + vy * vy;
+                // t0 = closest approach along the move, hh = its distance squared
+                float t0 = ll > 0 ? (vx * dx + vy * dy) / ll : 0;
+                float hh = ll > 0 ? vv - t0 * t0 * ll : vv;
+                if (hh < 0) hh = 0;
+                if (hh > rr) continue;
+                // range of t where the cell is under the tool
+                float w = ll > 0 ? sqrtf((rr - hh) / ll) : 1;
+                float lo = fmaxf(0, t0 - w), hi = fminf(1, t0 + w);
+                if (lo > hi) continue;
+                float z = a->z + envelope(dz, t0, ll, hh, lo, hi, 1);
+                if (z < col[gy]) {
+                    if (stat_on) {
+                        float h = ll > 0 ? (vx * dy - vy * dx) / sqrtf(ll) : 0;
+                        stat_cell(col[gy] - z, grid_step * grid_step, h * grid_step);
+                    }
+                    col[gy] = z;
+                    cut = 1;
+                    if ((Uint32)gx < dirty.minx) dirty.minx = gx;
+                    if ((Uint32)gx >= dirty.maxx) dirty.maxx = gx + 1;
+                    if ((Uint32)gy < dirty.miny) dirty.miny = gy;
+                    if ((Uint32)gy >= dirty.maxy) dirty.maxy = gy + 1;
+                }
+            }
+        }
+        if (cut) block_stale[bx * blocks_y + by] = 1;
+    }
+}
+
+// lower the grid to the tool surface with the tool tip at x,y,z. the
+// path from (px,py) along (ux,uy) gives lateral offsets for stats
+static void stamp(float x, float y, float z, float px, float py, float ux, float uy) {
+    int rx = (int)floorf((x - tool_size / 2) / grid_step);
+    int ry = (int)floorf((y - tool_size / 2) / grid_step);
+    for (Uint32 i=0; i<tool_count; i++) {
+        struct tcell *t = &tool[i];
+        int gx = rx + t->dx;
+        int gy = ry + t->dy;
+        if (gx < 0 || gy < 0 || gx >= (int)grid_width || gy >= (int)grid_height) {
+            continue;
+        }
+        float *cell = grid + gx * grid_height + gy;
+        float tz = z - t->dz;
+        if (tz < *cell) {
+            if (stat_on) {
+                float h = ((gx - px) * uy - (gy - py) * ux) * grid_step;
+                stat_cell(*cell - tz, grid_step * grid_step, h);
+            }
+            *cell = tz;
+            block_stale[(gx >> block_shift) * blocks_y + (gy >> block_shift)] = 1;
+            if ((Uint32)gx < dirty.minx) dirty.minx = gx;
+            if ((Uint32)gx >= dirty.maxx) dirty.maxx = gx + 1;
+            if ((Uint32)gy < dirty.miny) dirty.miny = gy;
+            if ((Uint32)gy >= dirty.maxy) dirty.maxy = gy + 1;
+        }
+    }
+}
+
+// stamp the profile cells at grid steps from a to b. used in place of
+// sweep() for non-convex profiles where the envelope search can't be
+// trusted
+void step_move(struct move *a, struct move *b) {
+    float dx = b->x - a->x, dy = b->y - a->y, dz = b->z - a->z;
+    float md = fmaxf(fabsf(dx), fmaxf(fabsf(dy), fabsf(dz)));
+    float ll = sqrtf(dx * dx + dy * dy);
+    float ux = ll > 0 ? dx / ll : 0, uy = ll > 0 ? dy / ll : 0;
+    float px = cell_of(a->x), py = cell_of(a->y);
+    Uint32 steps = (Uint32)ceilf(md / grid_step);
+    for (Uint32 s=0; s<steps; s++) {
+        float f = (float)s / steps;
+        stamp(a->x + dx * f, a->y + dy * f, a->z + dz * f, px, py, ux, uy);
+    }
+    stamp(b->x, b->y, b->z, px, py, ux, uy);
+}
+
+/**
+ * apply a batch of moves to the stock grid with the active tool.
+ * cutting moves sweep the tool profile from the previous move. arcs
+ * arrive as their chord points and sweep chord by chord
+ *
+ * m     = memory base pointer
+ * i     = input memory location (count move records)
+ * count = number of moves
+ * o     = output memory location (changed region)
+ * returns 1 if any cell was lowered
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 stock_moves(unsigned char *m, Uint32 i, Uint32 count, Uint32 o) {
+    struct move *mv = (struct move *)(m + i);
+    struct region *out = (struct region *)(m + o);
+
+    dirty.minx = grid_width;
+    dirty.maxx = 0;
+    dirty.miny = grid_height;
+    dirty.maxy = 0;
+
+    for (Uint32 k=0; k<count; k++) {
+        if (!(mv[k].flags & MOVE_CUT) || k == 0) {
+            continue;
+        }
+        if (tool_convex) {
+            sweep(&mv[k - 1], &mv[k]);
+        } else {
+            step_move(&mv[k - 1], &mv[k]);
+        }
+    }
+
+    if (dirty.minx >= dirty.maxx) {
+        memset(out, 0, sizeof(struct region));
+        return 0;
+    }
+    *out = dirty;
+    return 1;
+}
+
+/**
+ * register the non-cutting tool body checked by stock_collide() and
+ * dexel_collide(). a count of zero disables collision checks
+ *
+ * m     = memory base pointer
+ * p     = body memory location (count body records)
+ * count = number of body cylinders (at most BODY_MAX)
+ */
+EMSCRIPTEN_KEEPALIVE
+void body_init(unsigned char *m, Uint32 p, Uint32 count) {
+    if (count > BODY_MAX) count = BODY_MAX;
+    memcpy(body, m + p, count * sizeof(struct body));
+    body_count = count;
+}
+
+// deepest stock height above the bottom of any body cylinder while
+// it moves from a to b. the bottom is linear along the move so the
+// lowest point over a cell is at one end of the time it is overhead
+static float body_depth(struct move *a, struct move *b) {
+    float ax = cell_of(a->x), ay = cell_of(a->y);
+    float dx = cell_of(b->x) - ax, dy = cell_of(b->y) - ay, dz = b->z - a->z;
+    float ll = dx * dx + dy * dy;
+    float depth = 0;
+
+    for (Uint32 s=0; s<body_count; s++) {
+        float reach = body[s].r / grid_step, rr = reach * reach;
+        int x0 = (int)floorf(fminf(ax, ax + dx) - reach);
+        int x1 = (int)ceilf(fmaxf(ax, ax + dx) + reach);
+        int y0 = (int)floorf(fminf(ay, ay + dy) - reach);
+        int y1 = (int)ceilf(fmaxf(ay, ay + dy) + reach);
+        if (x0 < 0) x0 = 0;
+        if (y0 < 0) y0 = 0;
+        if (x1 >= (int)grid_width) x1 = grid_width - 1;
+        if (y1 >= (int)grid_height) y1 = grid_height - 1;
+
+        // only blocks reaching above the lowest body bottom can touch
+        float floor = fminf(a->z, b->z) + body[s].z0 + depth;
+        Uint32 bs = block_shift;
+        for (int bx=x0>>bs; bx<=x1>>bs; bx++)
+        for (int by=y0>>bs; by<=y1>>bs; by++) {
+            if (block_height(bx, by) <= floor) continue;
+            int xe = ((bx + 1) << bs) - 1, ye = ((by + 1) << bs) - 1;
+            for (int gx=bx<<bs > x0 ? bx<<bs : x0; gx<=(xe < x1 ? xe : x1); gx++) {
+                float vx = gx - ax;
+                float *col = grid + gx * grid_height;
+                for (int gy=by<<bs > y0 ? by<<bs : y0; gy<=(ye < y1 ? ye : y1); gy++) {
+                    if (col[gy] <= floor) continue;
+                    float vy = gy - ay;
+                    float vv = vx * vx + vy * vy;
+                    float t0 = ll > 0 ? (vx * dx + vy * dy) / ll : 0;
+                    float hh = ll > 0 ? vv - t0 * t0 * ll : vv;
+                    if (hh < 0) hh = 0;
+                    if (hh > rr) continue;
+                    float w = ll > 0 ? sqrtf((rr - hh) / ll) : 1;
+                    float lo = fmaxf(0, t0 - w), hi = fminf(1, t0 + w);
+                    if (lo > hi) continue;
+                    float bottom = a->z + body[s].z0 + dz * (dz > 0 ? lo : hi);
+                    if (col[gy] - bottom > depth) depth = col[gy] - bottom;
+                }
+            }
+        }
+    }
+    return depth;
+}
+
+/**
+ * apply a batch of moves like stock_moves() while checking the tool
+ * body against the stock left before each move. collisions are found
+ * before the move cuts so material the flutes would remove on the same
+ * move still counts against the shank and holder
+ *
+ * m     = memory base pointer
+ * i     = input memory location (count move records)
+ * count = number of moves
+ * o     = output memory location (up to max hit records)
+ * max   = output capacity. count is always enough (one hit per move)
+ * s     = stats memory location (count stat records) or 0 for none
+ * returns number of colliding moves written
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 stock_collide(unsigned char *m, Uint32 i, Uint32 count, Uint32 o, Uint32 max, Uint32 s) {
+    struct move *mv = (struct move *)(m + i);
+    struct hit *out = (struct hit *)(m + o);
+    struct stat *st = s ? (struct stat *)(m + s) : 0;
+    Uint32 hits = 0;
+
+    if (st) {
+        memset(st, 0, count * sizeof(struct stat));
+    }
+    for (Uint32 k=1; k<count; k++) {
+        struct move *a = &mv[k - 1], *b = &mv[k];
+        if (!(b->flags & MOVE_CUT)) {
+            continue;
+        }
+        float depth = body_count ? body_depth(a, b) : 0;
+        if (depth > HIT_MIN && hits < max) {
+            out[hits].move = k;
+            out[hits].depth = depth;
+            hits++;
+        }
+        stat_on = st != 0;
+        stat_begin();
+        if (tool_convex) {
+            sweep(a, b);
+        } else {
+            step_move(a, b);
+        }
+        stat_on = 0;
+        if (st) {
+            stat_end(&st[k], tool_reach * tool_step, grid_step / 2, a->x != b->x || a->y != b->y);
+        }
+    }
+    return hits;
+}
+
+// dexel stock for 3D and indexed simulation. the stock is a grid of rays
+// along z, each holding up to DEXEL_SPANS sorted material spans, so holes
+// and undercuts survive. rays are grouped into fixed size square tiles
+// with dirty flags so only tiles touched by a cut are re-meshed.
+// rays cut into more spans move to a block of DEXEL_MORE spans from a
+// shared pool and keep the block index in their first inline slot
+
+#define DEXEL_SPANS 4
+#define DEXEL_MORE 32
+
+// a tool pose in machine coordinates. a = rotation about x in degrees
+struct amove {
+    float x;
+    float y;
+    float z;
+    float a;
+};
+
+struct dexels {
+    Uint32 width;   // columns (x)
+    Uint32 height;  // rays per column (y)
+    Uint32 tile;    // rays per tile side
+    Uint32 tilesx;  // tiles along x
+    Uint32 tilesy;  // tiles along y
+    float x0;       // stock min corner
+    float y0;
+    float csx;      // ray spacing
+    float csy;
+    float *spans;   // DEXEL_SPANS (lo, hi) pairs per ray
+    float *more;    // overflow pool of DEXEL_MORE (lo, hi) pair blocks
+    Uint32 *free;   // first free pool block. free blocks link through
+                    // their first slot. in stock memory so snapshots
+                    // restore it with the spans
+    Uint32 blocks;  // pool blocks
+    Uint8 *count;   // spans per ray
+    Uint8 *dirty;   // tile needs a new mesh (tile x * tilesy + tile y)
+} dex;
+
+float tool_length;  // cutting body length above the tip in mm
+
+// overflow pool blocks for n rays. one ray in 64 may hold more than
+// DEXEL_SPANS spans at once
+static Uint32 dexel_blocks(Uint32 n) {
+    return n / 64 + 64;
+}
+
+/**
+ * returns bytes of memory needed by dexel_init()
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 dexel_size(Uint32 width, Uint32 height, Uint32 tile) {
+    Uint32 n = width * height;
+    Uint32 tiles = ((width + tile - 1) / tile) * ((height + tile - 1) / tile);
+    return n * DEXEL_SPANS * 8 + 16 + dexel_blocks(n) * DEXEL_MORE * 8 + n + tiles;
+}
+
+/**
+ * initialize a dexel stock block centered on the origin
+ *
+ * m      = memory base pointer
+ * o      = stock memory location (dexel_size() bytes)
+ * width  = ray columns along x
+ * height = rays per column along y
+ * tile   = rays per mesh tile side
+ * sx, sy, sz = stock size in mm
+ */
+EMSCRIPTEN_KEEPALIVE
+void dexel_init(unsigned char *m, Uint32 o, Uint32 width, Uint32 height, Uint32 tile, float sx, float sy, float sz) {
+    Uint32 n = width * height;
+    dex.width = width;
+    dex.height = height;
+    dex.tile = tile;
+    dex.tilesx = (width + tile - 1) / tile;
+    dex.tilesy = (height + tile - 1) / tile;
+    dex.x0 = -sx / 2;
+    dex.y0 = -sy / 2;
+    dex.csx = sx / width;
+    dex.csy = sy / height;
+    dex.spans = (float *)(m + o);
+    dex.free = (Uint32 *)(m + o + n * DEXEL_SPANS * 8);
+    dex.more = (float *)(dex.free + 4);
+    dex.blocks = dexel_blocks(n);
+    dex.count = (Uint8 *)(dex.more + dex.blocks * DEXEL_MORE * 2);
+    dex.dirty = dex.count + n;
+    *dex.free = 0;
+    for (Uint32 b=0; b<dex.blocks; b++) {
+        Uint32 next = b + 1 < dex.blocks ? b + 1 : ~0u;
+        memcpy(dex.more + b * DEXEL_MORE * 2, &next, 4);
+    }
+    for (Uint32 r=0; r<n; r++) {
+        dex.spans[r * DEXEL_SPANS * 2] = -sz / 2;
+        dex.spans[r * DEXEL_SPANS * 2 + 1] = sz / 2;
+        dex.count[r] = 1;
+    }
+    memset(dex.dirty, 1, dex.tilesx * dex.tilesy);
+}
+
+/**
+ * set the length of the cutting body above the tip. the body follows
+ * the profile registered with tool_init() and keeps its outer radius
+ * above the profile
+ */
+EMSCRIPTEN_KEEPALIVE
+void dexel_tool(float length) {
+    tool_length = length;
+}
+
+// spans of ray r, inline or in its pool block
+static inline float *ray_spans(Uint32 r) {
+    float *sp = dex.spans + r * DEXEL_SPANS * 2;
+    if (dex.count[r] > DEXEL_SPANS) {
+        Uint32 b;
+        memcpy(&b, sp, 4);
+        return dex.more + b * DEXEL_MORE * 2;
+    }
+    return sp;
+}
+
+// remove [lo, hi] from a ray. returns 1 if material was removed
+Uint8 dexel_cut(Uint32 x, Uint32 y, float lo, float hi) {
+    Uint32 r = x * dex.height + y;
+    Uint32 n = dex.count[r];
+    float *sp = ray_spans(r);
+    float out[DEXEL_MORE * 2 + 2];
+    Uint32 k = 0;
+    Uint8 changed = 0;
+
+    for (Uint32 i=0; i<n; i++) {
+        float a = sp[i * 2], b = sp[i * 2 + 1];
+        if (hi <= a || lo >= b) {
+            out[k++] = a;
+            out[k++] = b;
+            continue;
+        }
+        changed = 1;
+        // keep slivers out of the mesh
+        if (lo - a > 1e-4f) {
+            out[k++] = a;
+            out[k++] = lo;
+        }
+        if (b - hi > 1e-4f) {
+            out[k++] = hi;
+            out[k++] = b;
+        }
+    }
+    if (!changed) {
+        return 0;
+    }
+    // past the inline slots the ray needs a pool block. with a full block
+    // or an empty pool drop the thinnest spans. that removes a sliver of
+    // stock the tool cut around but never fills a gap it cut
+    Uint32 limit = n > DEXEL_SPANS || *dex.free != ~0u ? DEXEL_MORE : DEXEL_SPANS;
+    while (k > limit * 2) {
+        Uint32 g = 0;
+        for (Uint32 i=1; i<k/2; i++) {
+            if (out[i * 2 + 1] - out[i * 2] < out[g * 2 + 1] - out[g * 2]) g = i;
+        }
+        for (Uint32 i=g*2; i+2<k; i++) out[i] = out[i + 2];
+        k -= 2;
+    }
+    if (stat_on) {
+        float cut = 0;
+        for (Uint32 i=0; i<n; i++) cut += sp[i * 2 + 1] - sp[i * 2];
+        for (Uint32 i=0; i<k; i+=2) cut -= out[i + 1] - out[i];
+        stat_volume += cut * dex.csx * dex.csy;
+        if (cut > stat_depth) stat_depth = cut;
+    }
+    float *inl = dex.spans + r * DEXEL_SPANS * 2;
+    if (k > DEXEL_SPANS * 2 && n <= DEXEL_SPANS) {
+        // take a block from the pool
+        Uint32 b = *dex.free;
+        memcpy(dex.free, dex.more + b * DEXEL_MORE * 2, 4);
+        memcpy(inl, &b, 4);
+    } else if (k <= DEXEL_SPANS * 2 && n > DEXEL_SPANS) {
+        // back inline, return the block
+        Uint32 b;
+        memcpy(&b, inl, 4);
+        memcpy(sp, dex.free, 4);
+        *dex.free = b;
+    }
+    dex.count[r] = k / 2;
+    memcpy(ray_spans(r), out, k * sizeof(float));
+    // walls of neighbor rays in other tiles change too
+    Uint32 tx = x / dex.tile, ty = y / dex.tile, ts = dex.tilesy;
+    dex.dirty[tx * ts + ty] = 1;
+    if (x > 0) dex.dirty[((x - 1) / dex.tile) * ts + ty] = 1;
+    if (x + 1 < dex.width) dex.dirty[((x + 1) / dex.tile) * ts + ty] = 1;
+    if (y > 0) dex.dirty[tx * ts + (y - 1) / dex.tile] = 1;
+    if (y + 1 < dex.height) dex.dirty[tx * ts + (y + 1) / dex.tile] = 1;
+    return 1;
+}
+
+// clamp a range of ray columns/rows to the grid. returns 0 if empty
+static Uint8 dexel_range(float min, float max, float origin, float cell, Uint32 len, int *from, int *to) {
+    *from = (int)ceilf((min - origin) / cell - 0.5f);
+    *to = (int)floorf((max - origin) / cell - 0.5f);
+    if (*from < 0) *from = 0;
+    if (*to >= (int)len) *to = len - 1;
+    return *from <= *to;
+}
+
+// sweep an upright tool (a = 0) along a linear move. each ray loses the
+// span from the lower envelope of the tool tip surface to the highest
+// top of the cutting body while the ray is under the tool
+Uint8 dexel_sweep(struct amove *a, struct amove *b) {
+    float reach = tool_reach * tool_step, rr = reach * reach;
+    float dx = b->x - a->x, dy = b->y - a->y, dz = b->z - a->z;
+    float ll = dx * dx + dy * dy;
+    int x0, x1, y0, y1;
+    Uint8 changed = 0;
+
+    if (!dexel_range(fminf(a->x, b->x) - reach, fmaxf(a->x, b->x) + reach, dex.x0, dex.csx, dex.width, &x0, &x1) ||
+        !dexel_range(fminf(a->y, b->y) - reach, fmaxf(a->y, b->y) + reach, dex.y0, dex.csy, dex.height, &y0, &y1)) {
+        return 0;
+    }
+
+    for (int gx=x0; gx<=x1; gx++) {
+        float vx = dex.x0 + (gx + 0.5f) * dex.csx - a->x;
+        for (int gy=y0; gy<=y1; gy++) {
+            float vy = dex.y0 + (gy + 0.5f) * dex.csy - a->y;
+            float vv = vx * vx + vy * vy;
+            float t0 = ll > 0 ? (vx * dx + vy * dy) / ll : 0;
+            float hh = ll > 0 ? vv - t0 * t0 * ll : vv;
+            if (hh < 0) hh = 0;
+            if (hh > rr) continue;
+            float w = ll > 0 ? sqrtf((rr - hh) / ll) : 1;
+            float lo = fmaxf(0, t0 - w), hi = fminf(1, t0 + w);
+            if (lo > hi) continue;
+            float bottom = a->z + envelope(dz, t0, ll, hh, lo, hi, 1 / tool_step);
+            float top = a->z + dz * (dz > 0 ? hi : lo) + tool_length;
+            if (dexel_cut(gx, gy, bottom, top)) {
+                changed = 1;
+                if (stat_on && ll > 0) {
+                    float h = (vx * dy - vy * dx) / sqrtf(ll);
+                    if (h < stat_hmin) stat_hmin = h;
+                    if (h > stat_hmax) stat_hmax = h;
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+// inside margin of a point at w along a ray for a posed tool: height
+// above the tool tip surface. concave along the ray for convex tools
+static inline float pose_margin(float w, float dx, float dy, float uy, float uz) {
+    float h = dy * uy + w * uz;
+    float q = dy * uz - uy * w;
+    return h - radial_at(sqrtf(dx * dx + q * q) / tool_step);
+}
+
+// remove a tool posed with its tip at t and axis (0, uy, uz)
+Uint8 dexel_pose(float tx, float ty, float tz, float uy, float uz) {
+    float reach = tool_reach * tool_step, L = tool_length;
+    float ex = ty + uy * L;
+    int x0, x1, y0, y1;
+    Uint8 changed = 0;
+
+    if (!dexel_range(tx - reach, tx + reach, dex.x0, dex.csx, dex.width, &x0, &x1) ||
+        !dexel_range(fminf(ty, ex) - reach, fmaxf(ty, ex) + reach, dex.y0, dex.csy, dex.height, &y0, &y1)) {
+        return 0;
+    }
+
+    for (int gx=x0; gx<=x1; gx++) {
+        float dx = dex.x0 + (gx + 0.5f) * dex.csx - tx;
+        if (dx * dx > reach * reach) continue;
+        float e = sqrtf(reach * reach - dx * dx);
+        for (int gy=y0; gy<=y1; gy++) {
+            float dy = dex.y0 + (gy + 0.5f) * dex.csy - ty;
+            float w0, w1;
+            // points along the ray are w = z - tz. the distance from the
+            // axis is |(dx, dy * uz - uy * w)| and the height is
+            // dy * uy + w * uz. bound w by the reach and the body length
+            if (fabsf(uy) < 1e-6f) {
+                if (fabsf(dy) > e) continue;
+                w0 = -1e9f;
+                w1 = 1e9f;
+            } else {
+                float a = (dy * uz - e) / uy, b = (dy * uz + e) / uy;
+                w0 = fminf(a, b);
+                w1 = fmaxf(a, b);
+            }
+            if (fabsf(uz) < 1e-6f) {
+                if (dy * uy < 0 || dy * uy > L) continue;
+            } else {
+                float a = -dy * uy / uz, b = (L - dy * uy) / uz;
+                w0 = fmaxf(w0, fminf(a, b));
+                w1 = fminf(w1, fmaxf(a, b));
+            }
+            if (w0 > w1) continue;
+            // find the deepest point then the boundaries either side
+            const float g = 0.618034f;
+            float lo = w0, hi = w1;
+            float p = hi - (hi - lo) * g, q = lo + (hi - lo) * g;
+            float fp = pose_margin(p, dx, dy, uy, uz), fq = pose_margin(q, dx, dy, uy, uz);
+            for (Uint32 k=0; k<24; k++) {
+                if (fp > fq) {
+                    hi = q; q = p; fq = fp;
+                    p = hi - (hi - lo) * g;
+                    fp = pose_margin(p, dx, dy, uy, uz);
+                } else {
+                    lo = p; p = q; fp = fq;
+                    q = lo + (hi - lo) * g;
+                    fq = pose_margin(q, dx, dy, uy, uz);
+                }
+            }
+            float wm = fp > fq ? p : q;
+            if (fmaxf(fp, fq) < 0) continue;
+            float in = wm, out = w0;
+            if (pose_margin(w0, dx, dy, uy, uz) < 0) {
+                for (Uint32 k=0; k<24; k++) {
+                    float mid = (in + out) / 2;
+                    if (pose_margin(mid, dx, dy, uy, uz) >= 0) in = mid; else out = mid;
+                }
+                w0 = in;
+            }
+            in = wm;
+            out = w1;
+            if (pose_margin(w1, dx, dy, uy, uz) < 0) {
+                for (Uint32 k=0; k<24; k++) {
+                    float mid = (in + out) / 2;
+                    if (pose_margin(mid, dx, dy, uy, uz) >= 0) in = mid; else out = mid;
+                }
+                w1 = in;
+            }
+            changed |= dexel_cut(gx, gy, tz + w0, tz + w1);
+        }
+    }
+    return changed;
+}
+
+// steps needed to walk a tilted or rotating move at the ray spacing,
+// measured at the tool tip and at the far end of the tool
+static Uint32 pose_steps(struct amove *a, struct amove *b) {
+    const float rad = 3.14159265f / 180;
+    float reach = fmaxf(sqrtf(a->y * a->y + a->z * a->z), sqrtf(b->y * b->y + b->z * b->z)) + tool_length;
+    float dist = fmaxf(fmaxf(fabsf(b->x - a->x), fabsf(b->y - a->y)), fabsf(b->z - a->z));
+    float step = fminf(dex.csx, dex.csy);
+    Uint32 steps = (Uint32)ceilf(fmaxf(dist, fabsf(b->a - a->a) * rad * reach) / step);
+    return steps < 1 ? 1 : steps;
+}
+
+// tool tip t and axis (0, u[0], u[1]) at fraction f of a move. the
+// stock rotates about x so the tool is posed in stock coordinates
+static void pose_at(struct amove *a, struct amove *b, float f, float *t, float *u) {
+    const float rad = 3.14159265f / 180;
+    float y = a->y + (b->y - a->y) * f;
+    float z = a->z + (b->z - a->z) * f;
+    float an = (a->a + (b->a - a->a) * f) * rad;
+    float c = cosf(an), sn = sinf(an);
+    t[0] = a->x + (b->x - a->x) * f;
+    t[1] = y * c - z * sn;
+    t[2] = y * sn + z * c;
+    u[0] = -sn;
+    u[1] = c;
+}
+
+// upright poses of a non-convex tool are stepped too. their margin is
+// monotonic along the ray so dexel_pose() stays exact for them
+static Uint8 dexel_apply(struct amove *a, struct amove *b) {
+    if (a->a == 0 && b->a == 0 && tool_convex) {
+        return dexel_sweep(a, b);
+    }
+    Uint32 steps = pose_steps(a, b);
+    Uint8 changed = 0;
+    for (Uint32 s=0; s<=steps; s++) {
+        float t[3], u[2];
+        pose_at(a, b, (float)s / steps, t, u);
+        changed |= dexel_pose(t[0], t[1], t[2], u[0], u[1]);
+    }
+    return changed;
+}
+
+/**
+ * remove the material swept by the tool moving between two poses.
+ * upright moves sweep exactly. tilted or rotating moves are stepped at
+ * the ray spacing, measured at the tool tip and at the far end of the
+ * cutting body
+ *
+ * m = memory base pointer
+ * i = input memory location (start and end amove records)
+ * returns 1 if any material was removed
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 dexel_move(unsigned char *m, Uint32 i) {
+    struct amove *a = (struct amove *)(m + i), *b = a + 1;
+    if (!radial_len) {
+        return 0;
+    }
+    return dexel_apply(a, b);
+}
+
+/**
+ * apply a chain of moves without checks or stats. used to fast forward
+ *
+ * m     = memory base pointer
+ * i     = input memory location (count amove records, each move runs
+ *         from the previous record)
+ * count = number of records
+ * returns 1 if any material was removed
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 dexel_moves(unsigned char *m, Uint32 i, Uint32 count) {
+    struct amove *mv = (struct amove *)(m + i);
+    Uint8 changed = 0;
+    if (!radial_len) {
+        return 0;
+    }
+    for (Uint32 k=1; k<count; k++) {
+        changed |= dexel_apply(&mv[k - 1], &mv[k]);
+    }
+    return changed;
+}
+
+/**
+ * mark every tile changed. call after the dexel memory was replaced
+ * from outside (restoring a snapshot)
+ */
+EMSCRIPTEN_KEEPALIVE
+void dexel_touch() {
+    memset(dex.dirty, 1, dex.tilesx * dex.tilesy);
+}
+
+// longest overlap of a ray's material with the range lo to hi
+static float ray_overlap(Uint32 x, Uint32 y, float lo, float hi) {
+    Uint32 r = x * dex.height + y;
+    float *sp = ray_spans(r);
+    float depth = 0;
+    for (Uint32 s=0; s<dex.count[r]; s++) {
+        float d = fminf(sp[s * 2 + 1], hi) - fmaxf(sp[s * 2], lo);
+        if (d > depth) depth = d;
+    }
+    return depth;
+}
+
+// deepest overlap of the upright body swept from a to b with the stock
+static float dexel_body_sweep(struct amove *a, struct amove *b) {
+    float dx = b->x - a->x, dy = b->y - a->y, dz = b->z - a->z;
+    float ll = dx * dx + dy * dy;
+    float depth = 0;
+
+    for (Uint32 s=0; s<body_count; s++) {
+        float reach = body[s].r, rr = reach * reach;
+        int x0, x1, y0, y1;
+        if (!dexel_range(fminf(a->x, b->x) - reach, fmaxf(a->x, b->x) + reach, dex.x0, dex.csx, dex.width, &x0, &x1) ||
+            !dexel_range(fminf(a->y, b->y) - reach, fmaxf(a->y, b->y) + reach, dex.y0, dex.csy, dex.height, &y0, &y1)) {
+            continue;
+        }
+        for (int gx=x0; gx<=x1; gx++) {
+            float vx = dex.x0 + (gx + 0.5f) * dex.csx - a->x;
+            for (int gy=y0; gy<=y1; gy++) {
+                float vy = dex.y0 + (gy + 0.5f) * dex.csy - a->y;
+                float vv = vx * vx + vy * vy;
+                float t0 = ll > 0 ? (vx * dx + vy * dy) / ll : 0;
+                float hh = ll > 0 ? vv - t0 * t0 * ll : vv;
+                if (hh < 0) hh = 0;
+                if (hh > rr) continue;
+                float w = ll > 0 ? sqrtf((rr - hh) / ll) : 1;
+                float lo = fmaxf(0, t0 - w), hi = fminf(1, t0 + w);
+                if (lo > hi) continue;
+                float bottom = a->z + body[s].z0 + dz * (dz > 0 ? lo : hi);
+                float top = a->z + body[s].z1 + dz * (dz > 0 ? hi : lo);
+                float d = ray_overlap(gx, gy, bottom, top);
+                if (d > depth) depth = d;
+            }
+        }
+    }
+    return depth;
+}
+
+// deepest overlap of the body posed with its tip at t and axis
+// (0, uy, uz) with the stock, measured along the rays
+static float dexel_body_pose(float tx, float ty, float tz, float uy, float uz) {
+    float depth = 0;
+
+    for (Uint32 s=0; s<body_count; s++) {
+        float r = body[s].r, z0 = body[s].z0, z1 = body[s].z1;
+        float ey0 = ty + uy * z0, ey1 = ty + uy * z1;
+        int x0, x1, y0, y1;
+        if (!dexel_range(tx - r, tx + r, dex.x0, dex.csx, dex.width, &x0, &x1) ||
+            !dexel_range(fminf(ey0, ey1) - r, fmaxf(ey0, ey1) + r, dex.y0, dex.csy, dex.height, &y0, &y1)) {
+            continue;
+        }
+        for (int gx=x0; gx<=x1; gx++) {
+            float dx = dex.x0 + (gx + 0.5f) * dex.csx - tx;
+            if (dx * dx > r * r) continue;
+            float e = sqrtf(r * r - dx * dx);
+            for (int gy=y0; gy<=y1; gy++) {
+                float dy = dex.y0 + (gy + 0.5f) * dex.csy - ty;
+                float w0, w1;
+                // inside the cylinder when |dy * uz - uy * w| <= e and
+                // the height dy * uy + w * uz lies between z0 and z1
+                if (fabsf(uy) < 1e-6f) {
+                    if (fabsf(dy * uz) > e) continue;
+                    w0 = -1e9f;
+                    w1 = 1e9f;
+                } else {
+                    float a = (dy * uz - e) / uy, b = (dy * uz + e) / uy;
+                    w0 = fminf(a, b);
+                    w1 = fmaxf(a, b);
+                }
+                if (fabsf(uz) < 1e-6f) {
+                    if (dy * uy < z0 || dy * uy > z1) continue;
+                } else {
+                    float a = (z0 - dy * uy) / uz, b = (z1 - dy * uy) / uz;
+                    w0 = fmaxf(w0, fminf(a, b));
+                    w1 = fminf(w1, fmaxf(a, b));
+                }
+                if (w0 > w1) continue;
+                float d = ray_overlap(gx, gy, tz + w0, tz + w1);
+                if (d > depth) depth = d;
+            }
+        }
+    }
+    return depth;
+}
+
+/**
+ * apply a chain of moves like dexel_move() while checking the tool
+ * body against the stock left before each move. tilted or rotating
+ * moves are checked at the same steps used to cut them. their stats
+ * carry volume and depth but no engagement
+ *
+ * m     = memory base pointer
+ * i     = input memory location (count amove records, each move runs
+ *         from the previous record)
+ * count = number of records
+ * o     = output memory location (up to max hit records)
+ * max   = output capacity. count is always enough (one hit per move)
+ * s     = stats memory location (count stat records) or 0 for none
+ * returns number of colliding moves written
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 dexel_collide(unsigned char *m, Uint32 i, Uint32 count, Uint32 o, Uint32 max, Uint32 s) {
+    struct amove *mv = (struct amove *)(m + i);
+    struct hit *out = (struct hit *)(m + o);
+    struct stat *st = s ? (struct stat *)(m + s) : 0;
+    Uint32 hits = 0;
+
+    if (st) {
+        memset(st, 0, count * sizeof(struct stat));
+    }
+    for (Uint32 k=1; k<count; k++) {
+        struct amove *a = &mv[k - 1], *b = &mv[k];
+        Uint8 upright = a->a == 0 && b->a == 0;
+        float depth = 0;
+        if (!body_count) {
+            // nothing to check
+        } else if (upright) {
+            depth = dexel_body_sweep(a, b);
+        } else {
+            Uint32 steps = pose_steps(a, b);
+            for (Uint32 s=0; s<=steps; s++) {
+                float t[3], u[2];
+                pose_at(a, b, (float)s / steps, t, u);
+                depth = fmaxf(depth, dexel_body_pose(t[0], t[1], t[2], u[0], u[1]));
+            }
+        }
+        if (depth > HIT_MIN && hits < max) {
+            out[hits].move = k;
+            out[hits].depth = depth;
+            hits++;
+        }
+        if (!radial_len) {
+            continue;
+        }
+        stat_on = st != 0;
+        stat_begin();
+        dexel_apply(a, b);
+        stat_on = 0;
+        if (st) {
+            stat_end(&st[k], upright ? tool_reach * tool_step : 0, fminf(dex.csx, dex.csy) / 2, a->x != b->x || a->y != b->y);
+        }
+    }
+    return hits;
+}
+
+/**
+ * returns the number of mesh tiles
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 dexel_tiles() {
+    return dex.tilesx * dex.tilesy;
+}
+
+/**
+ * list tiles changed since their last mesh
+ *
  * m = memory base pointer
- * im = input memory location (mesh)
- * it = input memory location (tool)
- * ol = output memory location (mesh-updates)
- * returns length of update at output memory location
+ * o = output memory location (one Uint32 tile index per dirty tile)
+ * returns number of dirty tiles
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 dexel_dirty(unsigned char *m, Uint32 o) {
+    Uint32 *out = (Uint32 *)(m + o);
+    Uint32 n = 0;
+    for (Uint32 k=0; k<dex.tilesx * dex.tilesy; k++) {
+        if (dex.dirty[k]) out[n++] = k;
+    }
+    return n;
+}
+
+// mesh output state for dexel_mesh()
+float *mesh_out;
+Uint32 mesh_quads;
+Uint32 mesh_max;
+
+static void mesh_quad(float *v) {
+    if (mesh_quads < mesh_max) {
+        memcpy(mesh_out + mesh_quads * 12, v, 12 * sizeof(float));
+    }
+    mesh_quads++;
+}
+
+// emit a horizontal face over columns [x0, x1] rows [y0, y1) at z
+static void mesh_flat(float x0, float x1, float y0, float y1, float z, Uint8 up) {
+    float v[12] = {
+        x0, up ? y0 : y1, z,
+        x1, up ? y0 : y1, z,
+        x1, up ? y1 : y0, z,
+        x0, up ? y1 : y0, z
+    };
+    mesh_quad(v);
+}
+
+// emit wall faces where this ray has material its neighbor lacks.
+// side 0..3 = +x, -x, +y, -y
+static void mesh_walls(Uint32 r, Sint32 nr, Uint8 side, float x0, float x1, float y0, float y1) {
+    float *sp = ray_spans(r);
+    float *np = nr >= 0 ? ray_spans(nr) : 0;
+    Uint32 nn = nr >= 0 ? dex.count[nr] : 0;
+    for (Uint32 i=0; i<dex.count[r]; i++) {
+        float a = sp[i * 2], b = sp[i * 2 + 1], cur = a;
+        for (Uint32 j=0; j<=nn && cur < b; j++) {
+            float c = j < nn ? np[j * 2] : b, d = j < nn ? np[j * 2 + 1] : b;
+            if (d <= cur) continue;
+            float top = fminf(c, b);
+            if (top > cur) {
+                float lo = cur, hi = top;
+                float v[12];
+                switch (side) {
+                    case 0: { float w[12] = { x1,y0,lo, x1,y1,lo, x1,y1,hi, x1,y0,hi }; memcpy(v, w, sizeof(w)); break; }
+                    case 1: { float w[12] = { x0,y1,lo, x0,y0,lo, x0,y0,hi, x0,y1,hi }; memcpy(v, w, sizeof(w)); break; }
+                    case 2: { float w[12] = { x1,y1,lo, x0,y1,lo, x0,y1,hi, x1,y1,hi }; memcpy(v, w, sizeof(w)); break; }
+                    default: { float w[12] = { x0,y0,lo, x1,y0,lo, x1,y0,hi, x0,y0,hi }; memcpy(v, w, sizeof(w)); break; }
+                }
+                mesh_quad(v);
+            }
+            cur = fmaxf(cur, d);
+        }
+    }
+}
+
+/**
+ * write the surface of one tile as quads (4 vertices of x,y,z floats,
+ * counter clockwise seen from outside). flat faces of equal height are
+ * merged along y. the tile is marked clean only when the mesh fit
+ *
+ * m   = memory base pointer
+ * k   = tile index
+ * o   = output memory location
+ * max = output capacity in quads
+ * returns number of quads in the tile mesh
  */
 EMSCRIPTEN_KEEPALIVE
-Uint32 updateMesh(unsigned char *m, Uint32 im, Uint32 it, Uint32 ol) {
-    int rv = m[0] + m[100] + m[200];
-    m[0] = 123;
-    reporti(m[100],m[200]);
-    return rv;
+Uint32 dexel_mesh(unsigned char *m, Uint32 k, Uint32 o, Uint32 max) {
+    Uint32 H = dex.height;
+    Uint32 xs = (k / dex.tilesy) * dex.tile, ys = (k % dex.tilesy) * dex.tile;
+    Uint32 xe = xs + dex.tile < dex.width ? xs + dex.tile : dex.width;
+    Uint32 ye = ys + dex.tile < H ? ys + dex.tile : H;
+    mesh_out = (float *)(m + o);
+    mesh_quads = 0;
+    mesh_max = max;
+
+    for (Uint32 x=xs; x<xe; x++) {
+        float x0 = dex.x0 + x * dex.csx, x1 = x0 + dex.csx;
+        // open runs of equal height faces per span index (tops, bottoms).
+        // runs only exist below the most spans seen in the column so far
+        float run_z[2][DEXEL_MORE];
+        Uint32 run_y[2][DEXEL_MORE];
+        Uint8 run_on[2][DEXEL_MORE] = { { 0 } };
+        Uint32 most = 0;
+        for (Uint32 y=ys; y<=ye; y++) {
+            Uint32 r = x * H + y;
+            Uint32 n = y < ye ? dex.count[r] : 0;
+            float *sp = y < ye ? ray_spans(r) : 0;
+            if (n > most) most = n;
+            for (Uint32 s=0; s<most; s++) {
+                for (Uint32 t=0; t<2; t++) {
+                    float z = s < n ? sp[s * 2 + (t ? 0 : 1)] : 0;
+                    if (run_on[t][s] && s < n && run_z[t][s] == z) continue;
+                    if (run_on[t][s]) {
+                        mesh_flat(x0, x1, dex.y0 + run_y[t][s] * dex.csy, dex.y0 + y * dex.csy, run_z[t][s], !t);
+                        run_on[t][s] = 0;
+                    }
+                    if (s < n) {
+                        run_on[t][s] = 1;
+                        run_z[t][s] = z;
+                        run_y[t][s] = y;
+                    }
+                }
+            }
+            if (y == ye) break;
+            float y0 = dex.y0 + y * dex.csy, y1 = y0 + dex.csy;
+            mesh_walls(r, x + 1 < dex.width ? (Sint32)(r + H) : -1, 0, x0, x1, y0, y1);
+            mesh_walls(r, x > 0 ? (Sint32)(r - H) : -1, 1, x0, x1, y0, y1);
+            mesh_walls(r, y + 1 < H ? (Sint32)(r + 1) : -1, 2, x0, x1, y0, y1);
+            mesh_walls(r, y > 0 ? (Sint32)(r - 1) : -1, 3, x0, x1, y0, y1);
+        }
+    }
+
+    if (mesh_quads <= max) {
+        dex.dirty[k] = 0;
+    }
+    return mesh_quads;
 }
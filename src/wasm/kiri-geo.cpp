@@ -1,12 +1,16 @@
 //#define use_int32
 
 #include <emscripten.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
 #include "clipper.hpp"
 
 typedef unsigned char Uint8;
 typedef unsigned short Uint16;
 typedef unsigned int Uint32;
 typedef int int32;
+typedef unsigned long long Uint64;
 
 using namespace ClipperLib;
 
@@ -187,3 +191,1758 @@ Uint32 poly_diff(Uint32 memat, Uint32 polysA, Uint32 polysB, Uint8 AB, Uint8 BA,
 
     return resat;
 }
+
+// mesh slicing. segment end points are welded on their clipper scaled
+// x,y packed into a 64 bit key, the same truncation as Point.key
+
+struct zseg {
+    Uint64 a;
+    Uint64 b;
+    Uint32 edge;
+};
+
+struct slice_opts {
+    double zmin;
+    double zmax;
+    double prec;
+    double bridge;
+    float clean;
+    Uint32 flags;
+};
+
+struct slice_out {
+    std::vector<Uint8> data;
+
+    void put16(Uint16 v) {
+        Uint8 *b = (Uint8 *)&v;
+        data.insert(data.end(), b, b + 2);
+    }
+
+    void put32(Uint32 v) {
+        Uint8 *b = (Uint8 *)&v;
+        data.insert(data.end(), b, b + 4);
+    }
+
+    // counts that do not fit 16 bits are escaped with 0xffff
+    void putPath(Path &path) {
+        Uint32 count = path.size();
+        if (count >= 0xffff) {
+            put16(0xffff);
+            put32(count);
+        } else {
+            put16(count);
+        }
+        for (IntPoint pt : path) {
+            put32((Uint32)(int32)pt.X);
+            put32((Uint32)(int32)pt.Y);
+        }
+    }
+};
+
+// match Number.round(3) applied to slicer input points
+static inline double round3(float v) {
+    return floor((double)v * 1000.0 + 0.5) / 1000.0;
+}
+
+static inline Uint64 zkey(double x, double y) {
+    return ((Uint64)(Uint32)(int32)(x * 100000.0) << 32) | (Uint32)(int32)(y * 100000.0);
+}
+
+static inline IntPoint zpoint(Uint64 key) {
+    return IntPoint((int32)(Uint32)(key >> 32), (int32)(Uint32)key);
+}
+
+static void add_zseg(std::vector<zseg> &segs, Uint64 a, Uint64 b, Uint32 edge) {
+    if (a == b) {
+        return;
+    }
+    if (a < b) {
+        segs.push_back({ a, b, edge });
+    } else {
+        segs.push_back({ b, a, edge });
+    }
+}
+
+// same cases as sliceZ(): 2 points on the plane make an edge line only
+// when the 3rd point is on the selected side. coplanar faces are dropped
+static void slice_tri(float *v, double z, slice_opts &opt, std::vector<zseg> &segs) {
+    double p[3][3];
+    Uint8 on[3], over[3], under[3];
+    Uint8 non = 0, nover = 0, nunder = 0;
+    for (Uint32 k = 0; k < 3; k++) {
+        p[k][0] = round3(v[k * 3]);
+        p[k][1] = round3(v[k * 3 + 1]);
+        p[k][2] = round3(v[k * 3 + 2]);
+        double delta = p[k][2] - z;
+        if (fabs(delta) < opt.prec) {
+            on[non++] = k;
+        } else if (delta < 0) {
+            under[nunder++] = k;
+        } else {
+            over[nover++] = k;
+        }
+    }
+    if (nunder == 3 || nover == 3 || non == 3) {
+        return;
+    }
+    if (non == 2) {
+        bool add = ((opt.flags & 1) && (nover == 1 || z == opt.zmax)) ||
+            ((opt.flags & 2) && (nunder == 1 || z == opt.zmin));
+        if (add) {
+            double *a = p[on[0]], *b = p[on[1]];
+            add_zseg(segs, zkey(a[0], a[1]), zkey(b[0], b[1]), 1);
+        }
+        return;
+    }
+    if (nunder == 0 || nover == 0) {
+        return;
+    }
+    Uint64 keys[2];
+    Uint32 nkeys = 0;
+    for (Uint32 i = 0; i < nover; i++) {
+        for (Uint32 j = 0; j < nunder; j++) {
+            // Point.intersectZ() from the over point
+            double *a = p[over[i]], *b = p[under[j]];
+            double dz = b[2] - a[2];
+            double pct = 1 - ((b[2] - z) / dz);
+            keys[nkeys++] = zkey(a[0] + (b[0] - a[0]) * pct, a[1] + (b[1] - a[1]) * pct);
+        }
+    }
+    if (nkeys == 1) {
+        keys[nkeys++] = zkey(p[on[0]][0], p[on[0]][1]);
+    }
+    add_zseg(segs, keys[0], keys[1], 0);
+}
+
+#define NONE 0xffffffff
+
+static inline Uint32 mix64(Uint64 k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    return (Uint32)k;
+}
+
+// open addressing table of slots holding dense ids. callers compare
+// keys through the id so one table type serves points, segments and cells
+struct khash {
+    std::vector<Uint32> slots;
+    Uint32 mask;
+
+    khash(Uint32 count) {
+        Uint32 size = 16;
+        while (size < count * 2) {
+            size <<= 1;
+        }
+        slots.assign(size, NONE);
+        mask = size - 1;
+    }
+
+    // return the slot for hash holding an id that matches or is empty
+    template <typename Match>
+    Uint32 &find(Uint32 hash, Match match) {
+        for (Uint32 i = hash & mask; ; i = (i + 1) & mask) {
+            Uint32 &slot = slots[i];
+            if (slot == NONE || match(slot)) {
+                return slot;
+            }
+        }
+    }
+};
+
+// removeDuplicateLines(): shared interior lines cancel. a duplicated
+// edge line survives once. first occurrence order is kept
+static void dedup_zsegs(std::vector<zseg> &segs) {
+    Uint32 count = segs.size(), keep = 0;
+    khash table(count);
+    std::vector<Uint32> dups(count, 0);
+    for (Uint32 i = 0; i < count; i++) {
+        zseg &s = segs[i];
+        Uint32 &slot = table.find(mix64(s.a) ^ mix64(s.b * 31), [&](Uint32 id) {
+            return segs[id].a == s.a && segs[id].b == s.b;
+        });
+        if (slot == NONE) {
+            slot = i;
+        } else {
+            segs[slot].edge |= s.edge;
+            dups[slot]++;
+            dups[i] = NONE;
+        }
+    }
+    for (Uint32 i = 0; i < count; i++) {
+        if (dups[i] == 0 || (dups[i] != NONE && segs[i].edge)) {
+            segs[keep++] = segs[i];
+        }
+    }
+    segs.resize(keep);
+}
+
+static inline double zdist(Uint64 k1, Uint64 k2) {
+    double dx = (double)((int32)(Uint32)(k1 >> 32) - (int32)(Uint32)(k2 >> 32)) / 100000.0;
+    double dy = (double)((int32)(Uint32)k1 - (int32)(Uint32)k2) / 100000.0;
+    return sqrt(dx * dx + dy * dy);
+}
+
+static void emit_path(Path &path, bool closed, slice_opts &opt, Paths &closes, Paths &opens) {
+    if (!closed && path.size() > 2) {
+        // open paths with a gap under the bridge distance close like
+        // the connect list in sliceConnect()
+        double dx = (double)(path.front().X - path.back().X) / 100000.0;
+        double dy = (double)(path.front().Y - path.back().Y) / 100000.0;
+        double gap = floor(sqrt(dx * dx + dy * dy) * 10000.0 + 0.5) / 10000.0;
+        if (gap >= opt.bridge) {
+            opens.push_back(path);
+            return;
+        }
+    }
+    if (path.size() < 3) {
+        return;
+    }
+    if (opt.clean > 0) {
+        // a path cleaned away is dropped like poly.clean() in emit()
+        Path clean;
+        CleanPolygon(path, clean, opt.clean);
+        path = clean;
+    }
+    if (path.size() > 2) {
+        closes.push_back(path);
+    }
+}
+
+// sliceConnect() over welded points. each point links to the points it
+// shares a segment with plus at most one bridge from stub matching
+struct zlinker {
+    std::vector<Uint64> keys;
+    std::vector<Uint32> off;
+    std::vector<Uint32> adj;
+    std::vector<Uint32> bridge;
+    std::vector<Uint8> del;
+    std::vector<std::vector<Uint32>> branches;
+    Uint32 base;
+
+    Uint32 degree(Uint32 p) {
+        return off[p + 1] - off[p] + (bridge[p] != NONE ? 1 : 0);
+    }
+
+    bool linked(Uint32 p, Uint32 q) {
+        for (Uint32 i = off[p]; i < off[p + 1]; i++) {
+            if (adj[i] == q) {
+                return true;
+            }
+        }
+        return bridge[p] == q;
+    }
+
+    void links(Uint32 p, std::vector<Uint32> &out) {
+        out.clear();
+        for (Uint32 i = off[p]; i < off[p + 1]; i++) {
+            if (!del[adj[i]]) {
+                out.push_back(adj[i]);
+            }
+        }
+        if (bridge[p] != NONE && !del[bridge[p]]) {
+            out.push_back(bridge[p]);
+        }
+    }
+
+    double area(std::vector<Uint32> &path) {
+        Uint32 count = path.size();
+        if (count < 3) {
+            return 0;
+        }
+        double area2 = 0;
+        for (Uint32 i = 0; i < count; i++) {
+            IntPoint p1 = zpoint(keys[path[i]]), p2 = zpoint(keys[path[(i + 1) % count]]);
+            area2 += (double)(p2.X - p1.X) * (double)(p2.Y + p1.Y);
+        }
+        return fabs(area2);
+    }
+
+    // findNextPath(): follow single links and at forks explore every
+    // branch (up to 500) with the points used so far marked
+    void explore(Uint32 point, Uint32 branch) {
+        std::vector<Uint32> marked, next;
+        for (;;) {
+            if (point == base && (branches[branch].size() || branches.size() > 1)) {
+                break;
+            }
+            if (del[point]) {
+                break;
+            }
+            del[point] = 1;
+            branches[branch].push_back(point);
+            marked.push_back(point);
+            links(point, next);
+            if (next.size() == 0) {
+                break;
+            }
+            if (next.size() == 1) {
+                point = next[0];
+                continue;
+            }
+            if (branches.size() < 500) {
+                for (Uint32 p : next) {
+                    std::vector<Uint32> copy = branches[branch];
+                    branches.push_back(std::move(copy));
+                    explore(p, branches.size() - 1);
+                }
+            }
+            break;
+        }
+        for (Uint32 p : marked) {
+            del[p] = 0;
+        }
+    }
+
+    // the branch enclosing the greatest area wins and its points are used
+    std::vector<Uint32> &next_path(Uint32 point) {
+        base = point;
+        branches.clear();
+        branches.emplace_back();
+        explore(point, 0);
+        Uint32 best = 0;
+        double max = -1;
+        for (Uint32 i = 0; i < branches.size(); i++) {
+            double a = area(branches[i]);
+            if (a > max) {
+                max = a;
+                best = i;
+            }
+        }
+        for (Uint32 p : branches[best]) {
+            del[p] = 1;
+        }
+        return branches[best];
+    }
+
+    // pair each stub with the nearest later stub under the bridge distance
+    void bridge_stubs(std::vector<Uint32> &stubs, double max) {
+        Uint32 count = stubs.size();
+        if (count < 2 || max <= 0) {
+            return;
+        }
+        // bin stubs on a grid of bridge sized cells
+        auto cell = [&](Uint64 key, int32 dx, int32 dy) {
+            IntPoint p = zpoint(key);
+            Uint64 cx = (Uint32)((int32)floor(p.X / (max * 100000.0)) + dx);
+            Uint64 cy = (Uint32)((int32)floor(p.Y / (max * 100000.0)) + dy);
+            return (cx << 32) | cy;
+        };
+        std::vector<Uint64> cells(count);
+        std::vector<Uint32> order(count), start;
+        for (Uint32 i = 0; i < count; i++) {
+            cells[i] = cell(keys[stubs[i]], 0, 0);
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](Uint32 a, Uint32 b) {
+            return cells[a] < cells[b] || (cells[a] == cells[b] && a < b);
+        });
+        khash table(count);
+        for (Uint32 i = 0; i < count; i++) {
+            Uint64 c = cells[order[i]];
+            if (i == 0 || c != cells[order[i - 1]]) {
+                table.find(mix64(c), [&](Uint32 id) { return cells[order[start[id]]] == c; }) = start.size();
+                start.push_back(i);
+            }
+        }
+        start.push_back(count);
+        std::vector<Uint8> used(count, 0);
+        for (Uint32 i = 0; i < count; i++) {
+            if (used[i]) {
+                continue;
+            }
+            Uint64 ki = keys[stubs[i]];
+            Uint32 best = NONE;
+            double min = 0;
+            for (int32 dx = -1; dx <= 1; dx++) {
+                for (int32 dy = -1; dy <= 1; dy++) {
+                    Uint64 c = cell(ki, dx, dy);
+                    Uint32 id = table.find(mix64(c), [&](Uint32 id) { return cells[order[start[id]]] == c; });
+                    if (id == NONE) {
+                        continue;
+                    }
+                    for (Uint32 k = start[id]; k < start[id + 1]; k++) {
+                        Uint32 j = order[k];
+                        if (j <= i || used[j]) {
+                            continue;
+                        }
+                        double d = zdist(ki, keys[stubs[j]]);
+                        if (best == NONE || d < min || (d == min && j < best)) {
+                            min = d;
+                            best = j;
+                        }
+                    }
+                }
+            }
+            if (best != NONE && min < max) {
+                bridge[stubs[i]] = stubs[best];
+                bridge[stubs[best]] = stubs[i];
+                used[i] = used[best] = 1;
+            }
+        }
+    }
+};
+
+// weld segment end points through a hash of their keys then connect
+// paths with the fork and stub handling of sliceConnect()
+static void link_zsegs(std::vector<zseg> &segs, slice_opts &opt, Paths &closes, Paths &opens) {
+    Uint32 count = segs.size();
+    zlinker zl;
+    khash table(count);
+    std::vector<Uint32> ends(count * 2);
+    for (Uint32 i = 0; i < count * 2; i++) {
+        Uint64 key = i & 1 ? segs[i >> 1].b : segs[i >> 1].a;
+        Uint32 &slot = table.find(mix64(key), [&](Uint32 id) { return zl.keys[id] == key; });
+        if (slot == NONE) {
+            slot = zl.keys.size();
+            zl.keys.push_back(key);
+        }
+        ends[i] = slot;
+    }
+    Uint32 npoints = zl.keys.size();
+    zl.off.assign(npoints + 1, 0);
+    zl.adj.resize(count * 2);
+    zl.bridge.assign(npoints, NONE);
+    zl.del.assign(npoints, 0);
+    for (Uint32 i = 0; i < count * 2; i++) {
+        zl.off[ends[i] + 1]++;
+    }
+    for (Uint32 i = 0; i < npoints; i++) {
+        zl.off[i + 1] += zl.off[i];
+    }
+    std::vector<Uint32> fill(zl.off.begin(), zl.off.end() - 1);
+    for (Uint32 i = 0; i < count * 2; i++) {
+        zl.adj[fill[ends[i]]++] = ends[i ^ 1];
+    }
+    std::vector<Uint32> forks, stubs;
+    for (Uint32 p = 0; p < npoints; p++) {
+        Uint32 deg = zl.degree(p);
+        if (deg > 2) {
+            forks.push_back(p);
+        }
+        if (deg < 2) {
+            stubs.push_back(p);
+        }
+    }
+    zl.bridge_stubs(stubs, opt.bridge);
+    Paths connect;
+    Path path;
+    auto walk = [&](Uint32 p) {
+        std::vector<Uint32> &ids = zl.next_path(p);
+        bool closed = ids.size() > 2 && zl.linked(ids.front(), ids.back());
+        path.clear();
+        for (Uint32 id : ids) {
+            path.push_back(zpoint(zl.keys[id]));
+        }
+        // bridged open paths are emitted last as in sliceConnect()
+        if (closed) {
+            emit_path(path, true, opt, closes, opens);
+        } else if (path.size() > 2) {
+            connect.push_back(path);
+        }
+    };
+    for (Uint32 p : forks) {
+        if (!zl.del[p] && zl.degree(p) > 2) {
+            walk(p);
+        }
+    }
+    for (Uint32 p = 0; p < npoints; p++) {
+        if (!zl.del[p]) {
+            walk(p);
+        }
+    }
+    for (Path &open : connect) {
+        emit_path(open, false, opt, closes, opens);
+    }
+}
+
+// triangle z extents sorted by their low end for the layer sweep
+struct zindex {
+    std::vector<Uint32> order;
+    std::vector<float> lo;
+    std::vector<float> hi;
+
+    zindex(float *v, Uint32 count) : order(count), lo(count), hi(count) {
+        for (Uint32 t = 0; t < count; t++) {
+            float *p = v + t * 9;
+            lo[t] = std::min(p[2], std::min(p[5], p[8]));
+            hi[t] = std::max(p[2], std::max(p[5], p[8]));
+            order[t] = t;
+        }
+        std::sort(order.begin(), order.end(), [this](Uint32 a, Uint32 b) {
+            return lo[a] < lo[b];
+        });
+    }
+};
+
+/**
+ * slice a triangle soup at each z
+ *
+ * verts = float x,y,z triples, count triangles
+ * zs = doubles, nz layers (any order)
+ * flags = 1 over, 2 under selection for lines on the slice plane
+ * prec = precision_slice_z, bridge = max gap closed on open paths
+ * clean = CleanPolygon distance in clipper units (0 = skip)
+ *
+ * layers are swept in ascending z over an active set of the triangles
+ * spanning the current z, so each triangle is only tested against the
+ * layers it crosses
+ *
+ * returns a malloc'd block: Uint32 byte length, then for each layer in
+ * zs order a Uint32 segment count, closed polys and open paths each
+ * written as null terminated packed polys (mem_clr to release)
+ */
+__attribute__ ((export_name("mesh_slice")))
+Uint32 mesh_slice(Uint32 verts, Uint32 count, Uint32 zs, Uint32 nz, Uint32 flags, double zmin, double zmax, double prec, double bridge, float clean) {
+    float *v = (float *)(mem + verts);
+    double *zv = (double *)(mem + zs);
+    slice_opts opt = { zmin, zmax, prec, bridge, clean, flags };
+    zindex index(v, count);
+    std::vector<Uint32> layers(nz), active;
+    std::vector<slice_out> outs(nz);
+    std::vector<zseg> segs;
+    for (Uint32 l = 0; l < nz; l++) {
+        layers[l] = l;
+    }
+    std::sort(layers.begin(), layers.end(), [zv](Uint32 a, Uint32 b) {
+        return zv[a] < zv[b];
+    });
+    Uint32 next = 0;
+    for (Uint32 l : layers) {
+        double z = zv[l];
+        // float extents are widened past the rounding of input points
+        float pad = prec + 0.001 + fabs(z) * 1e-6;
+        float zlo = z - pad, zhi = z + pad;
+        while (next < count && index.lo[index.order[next]] <= zhi) {
+            active.push_back(index.order[next++]);
+        }
+        Uint32 keep = 0;
+        for (Uint32 t : active) {
+            if (index.hi[t] >= zlo) {
+                active[keep++] = t;
+            }
+        }
+        active.resize(keep);
+        segs.clear();
+        for (Uint32 t : active) {
+            slice_tri(v + t * 9, z, opt, segs);
+        }
+        dedup_zsegs(segs);
+        Paths closes, opens;
+        slice_out &out = outs[l];
+        out.put32(segs.size());
+        for (zseg &seg : segs) {
+            out.put32((Uint32)(seg.a >> 32));
+            out.put32((Uint32)seg.a);
+            out.put32((Uint32)(seg.b >> 32));
+            out.put32((Uint32)seg.b);
+            out.put32(seg.edge);
+        }
+        link_zsegs(segs, opt, closes, opens);
+        for (Path &path : closes) {
+            out.putPath(path);
+        }
+        out.put16(0);
+        for (Path &path : opens) {
+            out.putPath(path);
+        }
+        out.put16(0);
+    }
+    Uint32 size = 4;
+    for (slice_out &out : outs) {
+        size += out.data.size();
+    }
+    Uint8 *res = (Uint8 *)malloc(size);
+    *(Uint32 *)res = size;
+    Uint32 pos = 4;
+    for (slice_out &out : outs) {
+        memcpy(res + pos, out.data.data(), out.data.size());
+        pos += out.data.size();
+    }
+    return (Uint32)res;
+}
+
+// adaptive layer planning. a facet with normal z component nz leaves a
+// cusp of h * |nz| on a layer of height h
+
+/**
+ * histogram facet slope along z
+ *
+ * verts = float x,y,z triples, count triangles
+ * bins of height bin starting at zmin. hist = nbins * 3 floats:
+ *   max |nz| of the sloped facets spanning the bin
+ *   curvature as the change of that slope angle per mm
+ *   z of a horizontal facet in the bin or -1
+ */
+__attribute__ ((export_name("mesh_zhist")))
+void mesh_zhist(Uint32 verts, Uint32 count, float zmin, float bin, Uint32 nbins, Uint32 hist) {
+    float *v = (float *)(mem + verts);
+    float *h = (float *)(mem + hist);
+    for (Uint32 b = 0; b < nbins; b++) {
+        h[b * 3] = 0;
+        h[b * 3 + 1] = 0;
+        h[b * 3 + 2] = -1;
+    }
+    for (Uint32 t = 0; t < count; t++) {
+        float *p = v + t * 9;
+        double ux = p[3] - p[0], uy = p[4] - p[1], uz = p[5] - p[2];
+        double vx = p[6] - p[0], vy = p[7] - p[1], vz = p[8] - p[2];
+        double nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+        double len = sqrt(nx * nx + ny * ny + nz * nz);
+        if (len == 0) {
+            continue;
+        }
+        float lo = std::min(p[2], std::min(p[5], p[8]));
+        float hi = std::max(p[2], std::max(p[5], p[8]));
+        int32 b0 = std::max(0, (int32)floor((lo - zmin) / bin));
+        int32 b1 = std::min((int32)nbins - 1, (int32)floor((hi - zmin) / bin));
+        if (b0 > b1) {
+            continue;
+        }
+        if (hi - lo < 0.0001) {
+            float &flat = h[b0 * 3 + 2];
+            if (flat < 0 || lo < flat) {
+                flat = lo;
+            }
+            continue;
+        }
+        float slope = fabs(nz) / len;
+        for (int32 b = b0; b <= b1; b++) {
+            h[b * 3] = std::max(h[b * 3], slope);
+        }
+    }
+    for (Uint32 b = 1; b + 1 < nbins; b++) {
+        double a0 = asin(std::min(1.0f, h[(b - 1) * 3]));
+        double a1 = asin(std::min(1.0f, h[(b + 1) * 3]));
+        h[b * 3 + 1] = fabs(a1 - a0) / (bin * 2);
+    }
+}
+
+/**
+ * plan layers from zmin to zmax over a mesh_zhist histogram
+ *
+ * the first layer is h0. each following layer is the tallest in
+ * [hmin, hmax] whose cusp h * |nz| + curvature * h^2 / 8 stays under
+ * cusp for every bin it covers. layers are cut short to end on
+ * horizontal facets. out = float pairs (layer top, layer height)
+ * returns the layer count (at most outmax)
+ */
+__attribute__ ((export_name("mesh_zplan")))
+Uint32 mesh_zplan(Uint32 hist, Uint32 nbins, float zmin, float zmax, float bin, float hmin, float hmax, float h0, float cusp, Uint32 out, Uint32 outmax) {
+    float *h = (float *)(mem + hist);
+    float *o = (float *)(mem + out);
+    Uint32 count = 0;
+    double z = zmin;
+    if (h0 > 0 && outmax > 0) {
+        z += h0;
+        o[count * 2] = z;
+        o[count * 2 + 1] = h0;
+        count++;
+    }
+    while (z < zmax - 0.0001 && count < outmax) {
+        double step = hmax;
+        Uint32 b = (Uint32)std::max(0.0, floor((z - zmin) / bin));
+        for (; b < nbins && zmin + b * bin < z + step + hmin; b++) {
+            double nz = h[b * 3], k = h[b * 3 + 1], fit = hmax;
+            if (k > 0) {
+                fit = (sqrt(nz * nz + k * cusp / 2) - nz) / (k / 4);
+            } else if (nz > 0) {
+                fit = cusp / nz;
+            }
+            if (zmin + b * bin < z + step) {
+                step = std::max((double)hmin, std::min(step, fit));
+            }
+            // land on horizontal facets. one that the next layer could
+            // not reach splits the rise to it into two layers
+            double rise = h[b * 3 + 2] - z;
+            if (rise >= hmin && rise < step + hmin) {
+                step = rise <= step || rise < hmin * 2 ? rise : rise / 2;
+                break;
+            }
+        }
+        if (z + step > zmax) {
+            step = std::max((double)hmin, zmax - z);
+        }
+        z += step;
+        o[count * 2] = z;
+        o[count * 2 + 1] = step;
+        count++;
+    }
+    return count;
+}
+
+// flat regions. triangles with all three z within 0.0001 share a
+// region with others at the same rounded z facing the same way
+
+struct flat_tri {
+    int32 zk;
+    int32 dir;
+    Uint32 tri;
+};
+
+/**
+ * find horizontal regions of a mesh and how far sloped facets shift
+ * its outline between layers
+ *
+ * verts = float x,y,z triples, count triangles. zs = nz ascending
+ * doubles. gaps = nz floats where gaps[i] is the largest horizontal
+ * run of a sloped facet between zs[i-1] and zs[i] (below zs[0] for 0)
+ *
+ * returns a malloc'd block: Uint32 byte length, Uint32 region count,
+ * then per region float z, int32 facing (1 up, -1 down) and the region
+ * as null terminated packed polys (mem_clr to release)
+ */
+__attribute__ ((export_name("mesh_flats")))
+Uint32 mesh_flats(Uint32 verts, Uint32 count, Uint32 zs, Uint32 nz, Uint32 gaps) {
+    float *v = (float *)(mem + verts);
+    double *zv = (double *)(mem + zs);
+    float *g = (float *)(mem + gaps);
+    std::vector<flat_tri> flats;
+    for (Uint32 i = 0; i < nz; i++) {
+        g[i] = 0;
+    }
+    for (Uint32 t = 0; t < count; t++) {
+        float *p = v + t * 9;
+        double ux = p[3] - p[0], uy = p[4] - p[1], uz = p[5] - p[2];
+        double vx = p[6] - p[0], vy = p[7] - p[1], vz = p[8] - p[2];
+        double nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nzv = ux * vy - uy * vx;
+        double nxy = sqrt(nx * nx + ny * ny);
+        if (nzv == 0) {
+            // vertical facets do not change the outline
+            continue;
+        }
+        double lo = std::min(p[2], std::min(p[5], p[8]));
+        double hi = std::max(p[2], std::max(p[5], p[8]));
+        if (hi - lo < 0.0001) {
+            flats.push_back({ (int32)floor(round3(lo) * 1000.0 + 0.5), nzv > 0 ? 1 : -1, t });
+            continue;
+        }
+        // run across a gap is capped by the facet footprint
+        double span = std::max(
+            std::max(p[0], std::max(p[3], p[6])) - std::min(p[0], std::min(p[3], p[6])),
+            std::max(p[1], std::max(p[4], p[7])) - std::min(p[1], std::min(p[4], p[7])));
+        double slope = fabs(nzv) / nxy;
+        Uint32 i = std::lower_bound(zv, zv + nz, lo) - zv;
+        for (; i < nz; i++) {
+            double za = i > 0 ? std::max(lo, zv[i - 1]) : lo;
+            double zb = std::min(hi, zv[i]);
+            if (za > hi) {
+                break;
+            }
+            g[i] = std::max(g[i], (float)std::min(span, (zb - za) * slope));
+        }
+    }
+    std::sort(flats.begin(), flats.end(), [](const flat_tri &a, const flat_tri &b) {
+        return a.zk != b.zk ? a.zk < b.zk : a.dir < b.dir;
+    });
+    slice_out out;
+    Uint32 regions = 0;
+    for (Uint32 i = 0, j; i < flats.size(); i = j) {
+        Paths tris, outs;
+        for (j = i; j < flats.size() && flats[j].zk == flats[i].zk && flats[j].dir == flats[i].dir; j++) {
+            float *p = v + flats[j].tri * 9;
+            Path tri;
+            for (Uint32 k = 0; k < 9; k += 3) {
+                tri << IntPoint((cInt)(p[k] * 100000.0), (cInt)(p[k + 1] * 100000.0));
+            }
+            tris.push_back(tri);
+        }
+        Clipper clip;
+        clip.AddPaths(tris, ptSubject, true);
+        clip.Execute(ctUnion, outs, pftNonZero, pftNonZero);
+        if (outs.empty()) {
+            continue;
+        }
+        float z = flats[i].zk / 1000.0f;
+        Uint32 zbits;
+        memcpy(&zbits, &z, 4);
+        out.put32(zbits);
+        out.put32((Uint32)flats[i].dir);
+        for (Path &path : outs) {
+            out.putPath(path);
+        }
+        out.put16(0);
+        regions++;
+    }
+    Uint32 size = 8 + out.data.size();
+    Uint8 *res = (Uint8 *)malloc(size);
+    *(Uint32 *)res = size;
+    *(Uint32 *)(res + 4) = regions;
+    memcpy(res + 8, out.data.data(), out.data.size());
+    return (Uint32)res;
+}
+
+// triply periodic minimal surface infill. fields are sampled over one
+// period of the x,y plane with rows along y and columns along x
+
+#define TPMS_GYROID 0
+#define TPMS_SCHWARZ 1
+#define TPMS_DIAMOND 2
+
+struct tpms_grid {
+    Uint32 rez;
+    std::vector<float> sx, cx, f;
+    // crossings on horizontal (x) edges then vertical (y) edges
+    std::vector<float> px, py;
+    std::vector<int32> link;
+
+    tpms_grid(Uint32 rez) : rez(rez), sx(rez + 1), cx(rez + 1), f((rez + 1) * (rez + 1)) {
+        for (Uint32 i = 0; i <= rez; i++) {
+            double a = i * 2 * M_PI / rez;
+            sx[i] = sin(a);
+            cx[i] = cos(a);
+        }
+        Uint32 edges = rez * (rez + 1) * 2;
+        px.resize(edges);
+        py.resize(edges);
+        link.resize(edges * 2);
+    }
+
+    // the fields are separable so rows are sums of per axis terms
+    void sample(Uint32 type, double z) {
+        float sz = sin(z * 2 * M_PI), cz = cos(z * 2 * M_PI);
+        Uint32 n = rez + 1;
+        for (Uint32 r = 0; r < n; r++) {
+            float sr = sx[r], cr = cx[r];
+            float *row = f.data() + r * n;
+            switch (type) {
+                case TPMS_SCHWARZ:
+                    for (Uint32 c = 0; c < n; c++) {
+                        row[c] = cx[c] + cr + cz;
+                    }
+                    break;
+                case TPMS_DIAMOND:
+                    for (Uint32 c = 0; c < n; c++) {
+                        row[c] = sr * sx[c] * sz + sr * cx[c] * cz + cr * sx[c] * cz + cr * cx[c] * sz;
+                    }
+                    break;
+                default:
+                    for (Uint32 c = 0; c < n; c++) {
+                        row[c] = sr * cx[c] + sx[c] * cz + sz * cr;
+                    }
+                    break;
+            }
+        }
+    }
+
+    Uint32 hedge(Uint32 r, Uint32 c) {
+        return r * rez + c;
+    }
+
+    Uint32 vedge(Uint32 r, Uint32 c) {
+        return rez * (rez + 1) + c * rez + r;
+    }
+
+    IntPoint point(Uint32 e) {
+        return IntPoint((cInt)(px[e] * 100000.0f), (cInt)(py[e] * 100000.0f));
+    }
+
+    void join(Uint32 a, Uint32 b) {
+        link[a * 2 + (link[a * 2] < 0 ? 0 : 1)] = b;
+        link[b * 2 + (link[b * 2] < 0 ? 0 : 1)] = a;
+    }
+
+    // marching squares at level. saddles follow the cell center value
+    void contour(float level, Uint32 &lr, Uint32 &td, slice_out &out) {
+        Uint32 n = rez + 1;
+        float *v = f.data();
+        std::fill(link.begin(), link.end(), -1);
+        for (Uint32 r = 0; r <= rez; r++) {
+            for (Uint32 c = 0; c <= rez; c++) {
+                float a = v[r * n + c] - level;
+                if (c < rez) {
+                    float b = v[r * n + c + 1] - level;
+                    if ((a < 0) != (b < 0)) {
+                        Uint32 e = hedge(r, c);
+                        px[e] = (c + a / (a - b)) / rez;
+                        py[e] = (float)r / rez;
+                        lr++;
+                    }
+                }
+                if (r < rez) {
+                    float b = v[(r + 1) * n + c] - level;
+                    if ((a < 0) != (b < 0)) {
+                        Uint32 e = vedge(r, c);
+                        px[e] = (float)c / rez;
+                        py[e] = (r + a / (a - b)) / rez;
+                        td++;
+                    }
+                }
+            }
+        }
+        for (Uint32 r = 0; r < rez; r++) {
+            for (Uint32 c = 0; c < rez; c++) {
+                float v0 = v[r * n + c] - level, v1 = v[r * n + c + 1] - level;
+                float v2 = v[(r + 1) * n + c + 1] - level, v3 = v[(r + 1) * n + c] - level;
+                Uint32 k = (v0 < 0) | (v1 < 0) << 1 | (v2 < 0) << 2 | (v3 < 0) << 3;
+                Uint32 eb = hedge(r, c), et = hedge(r + 1, c), el = vedge(r, c), er = vedge(r, c + 1);
+                switch (k) {
+                    case 0: case 15: break;
+                    case 1: case 14: join(el, eb); break;
+                    case 2: case 13: join(eb, er); break;
+                    case 3: case 12: join(el, er); break;
+                    case 4: case 11: join(er, et); break;
+                    case 6: case 9: join(eb, et); break;
+                    case 7: case 8: join(el, et); break;
+                    case 5: case 10:
+                        if (((v0 + v1 + v2 + v3) < 0) == (k == 5)) {
+                            join(el, et);
+                            join(eb, er);
+                        } else {
+                            join(el, eb);
+                            join(er, et);
+                        }
+                        break;
+                }
+            }
+        }
+        // open lines end on the tile border. what remains are loops
+        Uint32 edges = px.size();
+        for (int pass = 0; pass < 2; pass++) {
+            for (Uint32 e = 0; e < edges; e++) {
+                if (link[e * 2] < 0 || (pass == 0 && link[e * 2 + 1] >= 0)) {
+                    continue;
+                }
+                Path path;
+                path << point(e);
+                for (int32 prev = -1, at = e; ; ) {
+                    int32 *la = &link[at * 2];
+                    int32 next = la[0] != prev ? la[0] : la[1];
+                    // consume the links so each line is walked once
+                    la[0] = la[1] = -1;
+                    if (next < 0) {
+                        break;
+                    }
+                    path << point(next);
+                    prev = at;
+                    at = next;
+                    if (at == (int32)e) {
+                        break;
+                    }
+                }
+                thin(path);
+                if (path.size() > 1) {
+                    out.putPath(path);
+                }
+            }
+        }
+    }
+
+    // drop points within a tenth of a cell of the line through their
+    // neighbors. the first and last points always stay
+    void thin(Path &path) {
+        double tol = 10000.0 / rez;
+        Uint32 keep = 1;
+        for (Uint32 i = 1; i + 1 < path.size(); i++) {
+            IntPoint &a = path[keep - 1], &b = path[i], &c = path[i + 1];
+            double dx = c.X - a.X, dy = c.Y - a.Y;
+            double len = sqrt(dx * dx + dy * dy);
+            if (len > 0 && fabs(dx * (b.Y - a.Y) - dy * (b.X - a.X)) / len < tol) {
+                continue;
+            }
+            path[keep++] = b;
+        }
+        if (path.size() > 1) {
+            path[keep++] = path.back();
+        }
+        path.resize(keep);
+    }
+};
+
+/**
+ * contour a triply periodic minimal surface over one period in x and y
+ *
+ * type = 0 gyroid, 1 schwarz p, 2 diamond. rez samples per side. zs =
+ * nz doubles giving z as a fraction of the period. lines are traced at
+ * tip and -tip (once when tip is 0) in tile units scaled by 100000
+ *
+ * returns a malloc'd block: Uint32 byte length, then for each layer
+ * Uint32 x edge and y edge crossing counts and null terminated packed
+ * polylines. closed loops repeat their first point (mem_clr to release)
+ */
+__attribute__ ((export_name("tpms_slice")))
+Uint32 tpms_slice(Uint32 type, Uint32 rez, Uint32 zs, Uint32 nz, float tip) {
+    double *zv = (double *)(mem + zs);
+    tpms_grid grid(rez);
+    slice_out out;
+    for (Uint32 l = 0; l < nz; l++) {
+        Uint32 lr = 0, td = 0;
+        slice_out lines;
+        grid.sample(type, zv[l]);
+        grid.contour(tip, lr, td, lines);
+        if (tip != 0) {
+            grid.contour(-tip, lr, td, lines);
+        }
+        out.put32(lr);
+        out.put32(td);
+        out.data.insert(out.data.end(), lines.data.begin(), lines.data.end());
+        out.put16(0);
+    }
+    Uint32 size = 4 + out.data.size();
+    Uint8 *res = (Uint8 *)malloc(size);
+    *(Uint32 *)res = size;
+    memcpy(res + 4, out.data.data(), out.data.size());
+    return (Uint32)res;
+}
+
+// sparse infill. patterns are generated as polylines and clipped while
+// they are walked against the even-odd region of the target polygons
+
+#define FILL_HEX 0
+#define FILL_GRID 1
+#define FILL_TRIANGLE 2
+#define FILL_LINEAR 3
+#define FILL_CUBIC 4
+#define FILL_GYROID 5
+#define FILL_SCHWARZ 6
+#define FILL_DIAMOND 7
+
+struct fill_opts {
+    double minx, miny, maxx, maxy;
+    double width;
+    double spacing;
+    double density;
+    double repeat;
+    // tpms tile size in mm and samples per tile side
+    double tile;
+    Uint32 rez;
+};
+
+struct fill_edge {
+    double x0, y0, x1, y1;
+    // the unshifted clipper points
+    IntPoint a, b;
+};
+
+struct fill_clip {
+    std::vector<fill_edge> edges;
+    std::vector<std::vector<Uint32>> cells;
+    std::vector<Uint32> stamp;
+    std::vector<std::pair<double, Uint32>> hits;
+    Uint32 visit = 0;
+    double minx, miny, cell;
+    int32 nx, ny;
+    Paths &polys;
+    Paths out;
+    Path cur;
+    bool inside, started = false;
+    double lx, ly;
+    // the current pattern line in clipper units as js passes it, repeated
+    // points included, whether it touches a region edge and where its
+    // output starts. such lines go to clipper
+    Paths along;
+    Path line;
+    bool onedge = false;
+    Uint32 mark = 0;
+
+    fill_clip(Paths &polys) : polys(polys) {
+        double maxx = -1e30, maxy = -1e30;
+        minx = miny = 1e30;
+        for (Path &path : polys) {
+            for (Uint32 i = 0, n = path.size(); i < n; i++) {
+                IntPoint &a = path[i], &b = path[(i + 1) % n];
+                // regions sit a fraction of a clipper unit off the pattern so
+                // pattern vertices never land exactly on region vertices
+                fill_edge e = {
+                    a.X / 100000.0 - 3.17e-7, a.Y / 100000.0 - 1.13e-7,
+                    b.X / 100000.0 - 3.17e-7, b.Y / 100000.0 - 1.13e-7,
+                    a, b
+                };
+                if (e.y0 == e.y1 && e.x0 == e.x1) {
+                    continue;
+                }
+                edges.push_back(e);
+                minx = std::min(minx, e.x0);
+                miny = std::min(miny, e.y0);
+                maxx = std::max(maxx, e.x0);
+                maxy = std::max(maxy, e.y0);
+            }
+        }
+        if (edges.empty()) {
+            nx = ny = 0;
+            return;
+        }
+        // about two edges per cell in a grid of at most 256 x 256
+        double w = maxx - minx, h = maxy - miny;
+        cell = std::max(sqrt(w * h * 2 / edges.size()), std::max(w, h) / 256);
+        cell = std::max(cell, 1e-3);
+        nx = (int32)(w / cell) + 1;
+        ny = (int32)(h / cell) + 1;
+        cells.resize(nx * ny);
+        stamp.resize(edges.size());
+        for (Uint32 i = 0; i < edges.size(); i++) {
+            fill_edge &e = edges[i];
+            int32 cx0 = col(std::min(e.x0, e.x1)), cx1 = col(std::max(e.x0, e.x1));
+            int32 cy0 = row(std::min(e.y0, e.y1)), cy1 = row(std::max(e.y0, e.y1));
+            for (int32 y = cy0; y <= cy1; y++) {
+                for (int32 x = cx0; x <= cx1; x++) {
+                    cells[y * nx + x].push_back(i);
+                }
+            }
+        }
+    }
+
+    int32 col(double x) {
+        return std::max(0, std::min(nx - 1, (int32)floor((x - minx) / cell)));
+    }
+
+    int32 row(double y) {
+        return std::max(0, std::min(ny - 1, (int32)floor((y - miny) / cell)));
+    }
+
+    void point(double x, double y) {
+        IntPoint pt((cInt)round(x * 100000.0), (cInt)round(y * 100000.0));
+        if (cur.empty() || !(cur.back() == pt)) {
+            cur << pt;
+        }
+    }
+
+    void flush() {
+        if (cur.size() > 1) {
+            out.push_back(cur);
+        }
+        cur.clear();
+    }
+
+    // even-odd parity of a point from a ray along +x
+    bool contains(double x, double y) {
+        bool in = false;
+        if (!nx) {
+            return in;
+        }
+        int32 r = row(y);
+        visit++;
+        for (int32 c = col(x); c < nx; c++) {
+            for (Uint32 i : cells[r * nx + c]) {
+                if (stamp[i] == visit) {
+                    continue;
+                }
+                stamp[i] = visit;
+                fill_edge &e = edges[i];
+                if ((e.y0 > y) != (e.y1 > y)) {
+                    double ex = e.x0 + (y - e.y0) * (e.x1 - e.x0) / (e.y1 - e.y0);
+                    if (ex > x) {
+                        in = !in;
+                    }
+                }
+            }
+        }
+        return in;
+    }
+
+    // pattern points snap to clipper units the way js toClipper() truncates
+    void emit(double x, double y) {
+        IntPoint pt((cInt)(x * 100000.0), (cInt)(y * 100000.0));
+        x = pt.X / 100000.0;
+        y = pt.Y / 100000.0;
+        line << pt;
+        if (!started) {
+            started = true;
+            inside = contains(x, y);
+            if (inside) {
+                point(x, y);
+            }
+        } else if (x != lx || y != ly) {
+            segment(lx, ly, x, y);
+        }
+        lx = x;
+        ly = y;
+    }
+
+    void newline() {
+        if (onedge) {
+            out.resize(mark);
+            along.push_back(line);
+        } else if (inside) {
+            flush();
+        }
+        cur.clear();
+        line.clear();
+        mark = out.size();
+        started = inside = onedge = false;
+    }
+
+    // where a pattern line touches or runs along a region edge clipper
+    // splits or keeps it depending on the order of the coincident edges
+    // in its active edge list. rather than model that those lines are
+    // clipped the way js clips them
+    void finish() {
+        if (along.empty()) {
+            return;
+        }
+        Clipper clip;
+        PolyTree tree;
+        Paths res;
+        clip.AddPaths(along, ptSubject, false);
+        clip.AddPaths(polys, ptClip, true);
+        clip.Execute(ctIntersection, tree, pftNonZero, pftEvenOdd);
+        OpenPathsFromPolyTree(tree, res);
+        out.insert(out.end(), res.begin(), res.end());
+        along.clear();
+    }
+
+    // edge i and the segment a b meet other than by crossing inside both:
+    // an end of one lies on the other or they overlap
+    bool on_edge(Uint32 i, const IntPoint &a, const IntPoint &b) {
+        fill_edge &e = edges[i];
+        return on_segment(a, b, e.a) || on_segment(a, b, e.b) ||
+            on_segment(e.a, e.b, a) || on_segment(e.a, e.b, b);
+    }
+
+    static bool on_segment(const IntPoint &a, const IntPoint &b, const IntPoint &p) {
+        return (b.X - a.X) * (p.Y - a.Y) == (b.Y - a.Y) * (p.X - a.X) &&
+            p.X >= std::min(a.X, b.X) && p.X <= std::max(a.X, b.X) &&
+            p.Y >= std::min(a.Y, b.Y) && p.Y <= std::max(a.Y, b.Y);
+    }
+
+    // crossings are found with the same half open rule as the ray test
+    void segment(double x0, double y0, double x1, double y1) {
+        double dx = x1 - x0, dy = y1 - y0;
+        hits.clear();
+        if (nx && (dx || dy)) {
+            IntPoint ia = line[line.size() - 2], ib = line.back();
+            visit++;
+            walk(x0, y0, x1, y1, [&](Uint32 i) {
+                if (!onedge && on_edge(i, ia, ib)) {
+                    onedge = true;
+                }
+                fill_edge &e = edges[i];
+                double ca = dx * (e.y0 - y0) - dy * (e.x0 - x0);
+                double cb = dx * (e.y1 - y0) - dy * (e.x1 - x0);
+                if ((ca > 0) == (cb > 0)) {
+                    return;
+                }
+                double ex = e.x1 - e.x0, ey = e.y1 - e.y0;
+                double den = dx * ey - dy * ex;
+                if (den == 0) {
+                    return;
+                }
+                double t = ((e.x0 - x0) * ey - (e.y0 - y0) * ex) / den;
+                if (t > 0 && t <= 1) {
+                    hits.push_back({ t, i });
+                }
+            });
+            std::sort(hits.begin(), hits.end());
+        }
+        for (Uint32 h = 0; h < hits.size(); h++) {
+            // touching a vertex crosses two edges at once and changes nothing
+            if (h + 1 < hits.size() && hits[h + 1].first == hits[h].first) {
+                h++;
+                continue;
+            }
+            double hx = x0 + dx * hits[h].first, hy = y0 + dy * hits[h].first;
+            point(hx, hy);
+            if (inside) {
+                flush();
+            }
+            inside = !inside;
+        }
+        if (inside) {
+            point(x1, y1);
+        }
+    }
+
+    // visit the edges in every cell the segment passes through
+    template <typename F>
+    void walk(double x0, double y0, double x1, double y1, F fn) {
+        double fx0 = (x0 - minx) / cell, fy0 = (y0 - miny) / cell;
+        double fx1 = (x1 - minx) / cell, fy1 = (y1 - miny) / cell;
+        // clamp the walk to the grid
+        double t0 = 0, t1 = 1;
+        double d[2] = { fx1 - fx0, fy1 - fy0 }, s[2] = { fx0, fy0 }, lim[2] = { (double)nx, (double)ny };
+        for (int a = 0; a < 2; a++) {
+            if (d[a] == 0) {
+                if (s[a] < 0 || s[a] >= lim[a]) {
+                    return;
+                }
+                continue;
+            }
+            double ta = (0 - s[a]) / d[a], tb = (lim[a] - s[a]) / d[a];
+            if (ta > tb) {
+                std::swap(ta, tb);
+            }
+            t0 = std::max(t0, ta);
+            t1 = std::min(t1, tb);
+        }
+        if (t0 > t1) {
+            return;
+        }
+        double sx = fx0 + d[0] * t0, sy = fy0 + d[1] * t0;
+        int32 cx = std::max(0, std::min(nx - 1, (int32)floor(sx)));
+        int32 cy = std::max(0, std::min(ny - 1, (int32)floor(sy)));
+        int32 ex = std::max(0, std::min(nx - 1, (int32)floor(fx0 + d[0] * t1)));
+        int32 ey = std::max(0, std::min(ny - 1, (int32)floor(fy0 + d[1] * t1)));
+        int32 stx = d[0] > 0 ? 1 : -1, sty = d[1] > 0 ? 1 : -1;
+        double tdx = d[0] != 0 ? fabs(1 / d[0]) : 1e30, tdy = d[1] != 0 ? fabs(1 / d[1]) : 1e30;
+        double tmx = d[0] != 0 ? ((d[0] > 0 ? cx + 1 - fx0 : fx0 - cx) / fabs(d[0])) : 1e30;
+        double tmy = d[1] != 0 ? ((d[1] > 0 ? cy + 1 - fy0 : fy0 - cy) / fabs(d[1])) : 1e30;
+        for (Uint32 guard = nx + ny + 2; guard > 0; guard--) {
+            for (Uint32 i : cells[cy * nx + cx]) {
+                if (stamp[i] != visit) {
+                    stamp[i] = visit;
+                    fn(i);
+                }
+            }
+            if (cx == ex && cy == ey) {
+                break;
+            }
+            if (tmx < tmy) {
+                cx += stx;
+                tmx += tdx;
+            } else {
+                cy += sty;
+                tmy += tdy;
+            }
+            if (cx < 0 || cy < 0 || cx >= nx || cy >= ny) {
+                break;
+            }
+        }
+    }
+};
+
+// js Number.round(7) for positive values
+static inline double round7(double v) {
+    return floor(v * 10000000.0 + 0.5) / 10000000.0;
+}
+
+// ports of the fill.js emitters. the same points in the same order
+
+static void fill_hex(fill_opts &o, fill_clip &f) {
+    double vhlen = (1 / o.density) * o.width * 0.5;
+    double anxlen = round7(cos(30 * M_PI / 180) * vhlen);
+    double anylen = round7(sin(30 * M_PI / 180) * vhlen);
+    double maxy = o.maxy + (vhlen + anylen * 2);
+    bool even = true;
+    double x = o.minx, y;
+    for (;;) {
+        if (even && x > o.maxx) break;
+        if (!even && x > o.maxx + anxlen + o.spacing) break;
+        y = o.miny;
+        f.newline();
+        while (y <= maxy) {
+            f.emit(x, y);
+            y += vhlen;
+            f.emit(x, y);
+            if (even) x += anxlen; else x -= anxlen;
+            y += anylen;
+            f.emit(x, y);
+            y += vhlen;
+            f.emit(x, y);
+            if (even) x -= anxlen; else x += anxlen;
+            y += anylen;
+        }
+        x += o.spacing;
+        if (even) x += (anxlen * 2);
+        even = !even;
+        f.newline();
+    }
+}
+
+static void fill_grid(fill_opts &o, fill_clip &f) {
+    double offset = o.spacing / 2;
+    double tile = (1 / o.density) * o.width;
+    double tile_x = tile + offset;
+    double tile_xc = (o.maxx - o.minx) / tile_x;
+    double tile_yc = (o.maxy - o.miny) / tile;
+    for (Uint32 tx = 0; tx <= tile_xc; tx++) {
+        f.newline();
+        for (Uint32 ty = 0; ty <= tile_yc; ty++) {
+            double bx = tx * tile_x + o.minx;
+            double by = ty * tile + o.miny;
+            if ((tx + ty) % 2) {
+                f.emit(bx, by);
+                f.emit(bx + tile_x - offset, by + tile);
+            } else {
+                f.emit(bx + tile_x - offset, by);
+                f.emit(bx, by + tile);
+            }
+        }
+    }
+    f.newline();
+}
+
+static void fill_triangle(fill_opts &o, fill_clip &f) {
+    double offset = o.spacing;
+    double line_w = o.width / 2;
+    double tile = (1 / o.density) * (o.width * 1.25);
+    double tile_x = tile + offset * 2 + line_w;
+    double tile_xc = (o.maxx - o.minx) / tile_x;
+    double tile_yc = (o.maxy - o.miny) / tile;
+    for (Uint32 tx = 0; tx <= tile_xc; tx++) {
+        f.newline();
+        for (Uint32 ty = 0; ty <= tile_yc; ty++) {
+            double bx = tx * tile_x + o.minx;
+            double by = ty * tile + o.miny;
+            if ((tx + ty) % 2) {
+                f.emit(bx, by);
+                f.emit(bx + tile_x - offset - line_w, by + tile);
+            } else {
+                f.emit(bx + tile_x - offset - line_w, by);
+                f.emit(bx, by + tile);
+            }
+        }
+    }
+    for (Uint32 tx = 0; tx <= tile_xc; tx++) {
+        double bx = tx * tile_x + o.minx;
+        double xp = bx + tile_x - line_w / 2 - offset / 2;
+        f.newline();
+        f.emit(xp, o.miny);
+        f.emit(xp, o.maxy);
+    }
+    f.newline();
+}
+
+// linear alternates x and y lines. cubic adds a diagonal pass
+static void fill_lines(fill_opts &o, fill_clip &f, Uint32 index, int32 types) {
+    double span = std::max(o.maxx - o.minx, o.maxy - o.miny);
+    double steps = floor((span / o.width) * o.density);
+    double step = span / steps;
+    // same index math as js. a missing (NaN) or zero repeat leaves no
+    // pattern index and a negative one can land on -1 like js % does
+    double zq = floor(index / o.repeat);
+    int32 ztype = isfinite(zq) ? (int32)fmod(zq, types) : -1;
+    if (ztype == 1) {
+        for (double tx = o.minx; tx <= o.maxx; tx += step) {
+            f.newline();
+            f.emit(tx, o.miny);
+            f.emit(tx, o.maxy);
+        }
+    } else if (ztype == 0) {
+        for (double ty = o.miny; ty <= o.maxy; ty += step) {
+            f.newline();
+            f.emit(o.minx, ty);
+            f.emit(o.maxx, ty);
+        }
+    } else if (types == 3) {
+        for (double tx = o.minx; tx <= o.maxx; tx += step) {
+            f.newline();
+            f.emit(tx, o.miny);
+            f.emit(tx + 1000, o.maxy + 1000);
+        }
+        for (double ty = o.miny; ty <= o.maxy; ty += step) {
+            f.newline();
+            f.emit(o.minx, ty);
+            f.emit(o.minx + 1000, ty + 1000);
+        }
+    }
+    f.newline();
+}
+
+// tile one tpms period over the bounds. pieces ending on a tile border
+// are joined to the piece continuing in the next tile before clipping
+static void fill_tpms(fill_opts &o, fill_clip &f, tpms_grid &grid, Uint32 type, double z) {
+    slice_out lines;
+    Uint32 lr = 0, td = 0;
+    grid.sample(type, z / o.tile);
+    grid.contour(0, lr, td, lines);
+    std::vector<std::vector<double>> unit;
+    for (Uint32 pos = 0; pos < lines.data.size(); ) {
+        Uint32 count = *(Uint16 *)(lines.data.data() + pos);
+        pos += 2;
+        if (count == 0xffff) {
+            count = *(Uint32 *)(lines.data.data() + pos);
+            pos += 4;
+        }
+        std::vector<double> pts;
+        for (Uint32 i = 0; i < count; i++, pos += 8) {
+            pts.push_back(*(int32 *)(lines.data.data() + pos) / 100000.0);
+            pts.push_back(*(int32 *)(lines.data.data() + pos + 4) / 100000.0);
+        }
+        unit.push_back(pts);
+    }
+    std::vector<std::vector<double>> pieces;
+    double tile_x = (o.maxx - o.minx) / o.tile, tile_y = (o.maxy - o.miny) / o.tile;
+    for (Uint32 ty = 0; ty <= tile_y; ty++) {
+        for (Uint32 tx = 0; tx <= tile_x; tx++) {
+            for (auto &pts : unit) {
+                std::vector<double> piece(pts.size());
+                for (Uint32 i = 0; i < pts.size(); i += 2) {
+                    piece[i] = pts[i] * o.tile + tx * o.tile + o.minx;
+                    piece[i + 1] = pts[i + 1] * o.tile + ty * o.tile + o.miny;
+                }
+                pieces.push_back(piece);
+            }
+        }
+    }
+    // endpoints meet within a micron across tile borders
+    auto key = [](double x, double y) {
+        return ((Uint64)(Uint32)(int32)round(x * 1000.0) << 32) | (Uint32)(int32)round(y * 1000.0);
+    };
+    std::vector<Uint64> ends(pieces.size() * 2);
+    std::vector<Uint32> order(ends.size()), mate(ends.size(), NONE);
+    for (Uint32 p = 0; p < pieces.size(); p++) {
+        auto &pc = pieces[p];
+        ends[p * 2] = key(pc[0], pc[1]);
+        ends[p * 2 + 1] = key(pc[pc.size() - 2], pc[pc.size() - 1]);
+    }
+    for (Uint32 i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](Uint32 a, Uint32 b) {
+        return ends[a] < ends[b];
+    });
+    // ends pair up when exactly two of different pieces meet
+    for (Uint32 i = 0; i < order.size(); ) {
+        Uint32 j = i + 1;
+        while (j < order.size() && ends[order[j]] == ends[order[i]]) {
+            j++;
+        }
+        if (j - i == 2 && order[i] / 2 != order[i + 1] / 2) {
+            mate[order[i]] = order[i + 1];
+            mate[order[i + 1]] = order[i];
+        }
+        i = j;
+    }
+    std::vector<Uint8> used(pieces.size());
+    std::vector<double> chain;
+    for (int pass = 0; pass < 2; pass++) {
+        for (Uint32 p = 0; p < pieces.size(); p++) {
+            // chains start from a free end, then the remaining rings
+            if (used[p] || (pass == 0 && mate[p * 2] != NONE && mate[p * 2 + 1] != NONE)) {
+                continue;
+            }
+            chain.clear();
+            for (Uint32 end = pass == 0 && mate[p * 2] != NONE ? p * 2 + 1 : p * 2; ; ) {
+                Uint32 pc = end / 2;
+                if (used[pc]) {
+                    break;
+                }
+                used[pc] = 1;
+                auto &pts = pieces[pc];
+                // continuing pieces skip the point they share
+                Uint32 skip = chain.empty() ? 0 : 2;
+                if ((end & 1) == 0) {
+                    chain.insert(chain.end(), pts.begin() + skip, pts.end());
+                } else {
+                    for (Uint32 i = pts.size() - skip; i > 0; i -= 2) {
+                        chain.push_back(pts[i - 2]);
+                        chain.push_back(pts[i - 1]);
+                    }
+                }
+                end = mate[end ^ 1];
+                if (end == NONE) {
+                    break;
+                }
+            }
+            // short fragments are dropped as in fill.js
+            double len = 0;
+            for (Uint32 i = 2; i < chain.size(); i += 2) {
+                len += hypot(chain[i] - chain[i - 2], chain[i + 1] - chain[i - 1]);
+            }
+            if (len <= 2) {
+                continue;
+            }
+            f.newline();
+            for (Uint32 i = 0; i < chain.size(); i += 2) {
+                f.emit(chain[i], chain[i + 1]);
+            }
+            f.newline();
+        }
+    }
+}
+
+/**
+ * generate and clip sparse infill for a batch of layers
+ *
+ * memat = per layer: float64 z, Uint32 layer index, Uint32 poly count
+ * and packed polys. the polys are the fill region with solids inside
+ * it as even-odd holes. params = float64 minx, miny, maxx, maxy (bounds),
+ * line width, spacing, density, repeat, tpms tile and tpms resolution
+ *
+ * returns a malloc'd block: Uint32 byte length, then for each layer
+ * the clipped open lines as null terminated packed polys (mem_clr to
+ * release)
+ */
+__attribute__ ((export_name("fill_sparse")))
+Uint32 fill_sparse(Uint32 type, Uint32 memat, Uint32 layers, Uint32 params) {
+    double *pv = (double *)(mem + params);
+    fill_opts o = { pv[0], pv[1], pv[2], pv[3], pv[4], pv[5], pv[6], pv[7], pv[8], (Uint32)pv[9] };
+    bool tpms = type >= FILL_GYROID;
+    tpms_grid grid(tpms ? std::max(o.rez, (Uint32)4) : 1);
+    slice_out out;
+    Uint32 pos = memat;
+    for (Uint32 l = 0; l < layers; l++) {
+        double z = *(double *)(mem + pos);
+        Uint32 index = *(Uint32 *)(mem + pos + 8);
+        Uint32 count = *(Uint32 *)(mem + pos + 12);
+        Paths polys(count);
+        pos = readPolys(polys, pos + 16, count);
+        fill_clip f(polys);
+        switch (type) {
+            case FILL_HEX: fill_hex(o, f); break;
+            case FILL_GRID: fill_grid(o, f); break;
+            case FILL_TRIANGLE: fill_triangle(o, f); break;
+            case FILL_LINEAR: fill_lines(o, f, index, 2); break;
+            case FILL_CUBIC: fill_lines(o, f, index, 3); break;
+            default: fill_tpms(o, f, grid, type - FILL_GYROID, z); break;
+        }
+        f.finish();
+        for (Path &path : f.out) {
+            out.putPath(path);
+        }
+        out.put16(0);
+    }
+    Uint32 size = 4 + out.data.size();
+    Uint8 *res = (Uint8 *)malloc(size);
+    *(Uint32 *)res = size;
+    memcpy(res + 4, out.data.data(), out.data.size());
+    return (Uint32)res;
+}
+
+// a layer's flats or bridges and the layer range they are projected over
+struct solid_source {
+    Uint32 from, to;
+    Paths *paths;
+};
+
+// a and b fill separately so a union result and raw source polys of
+// either winding direction do not cancel where they overlap
+static void solid_union(const Paths &a, const Paths &b, Paths &out) {
+    Paths res;
+    Clipper clip;
+    clip.AddPaths(a, ptSubject, true);
+    clip.AddPaths(b, ptClip, true);
+    clip.Execute(ctUnion, res, pftNonZero, pftNonZero);
+    out.swap(res);
+}
+
+// union of the sources over one layer kept as a two stack queue. sources
+// entering are unioned into back. front holds older sources ordered by
+// their last layer with a running union to each, so one leaving pops off
+// the top. only a source leaving out of that order re-stacks the window
+struct solid_window {
+    std::vector<solid_source> back, front;
+    std::vector<Paths> fronts;
+    Paths backs;
+
+    void enter(solid_source &src) {
+        back.push_back(src);
+        solid_union(backs, *src.paths, backs);
+    }
+
+    // drop sources ending before layer l. true when any were dropped
+    bool leave(Uint32 l) {
+        bool left = false;
+        while (front.size() && front.back().to < l) {
+            front.pop_back();
+            fronts.pop_back();
+            left = true;
+        }
+        bool stale = false;
+        for (solid_source &src : back) {
+            stale |= src.to < l;
+        }
+        if (!stale) {
+            return left;
+        }
+        for (solid_source &src : back) {
+            if (src.to >= l) {
+                front.push_back(src);
+            }
+        }
+        back.clear();
+        backs.clear();
+        std::sort(front.begin(), front.end(), [](const solid_source &a, const solid_source &b) {
+            return a.to > b.to;
+        });
+        fronts.resize(front.size());
+        for (Uint32 i = 0; i < front.size(); i++) {
+            if (i == 0) {
+                solid_union(Paths(), *front[i].paths, fronts[i]);
+            } else {
+                solid_union(fronts[i - 1], *front[i].paths, fronts[i]);
+            }
+        }
+        return true;
+    }
+
+    void merged(Paths &out) {
+        if (fronts.empty()) {
+            out = backs;
+        } else if (back.empty()) {
+            out = fronts.back();
+        } else {
+            solid_union(fronts.back(), backs, out);
+        }
+    }
+};
+
+/**
+ * project flats down and bridges up through a stack of layers and
+ * merge them into per layer solid areas. sources enter and leave a
+ * sliding window as the sweep passes their range and the window union
+ * is updated as they do instead of rebuilt from every source
+ *
+ * memat = per layer: Uint32 flags (1 = trim), Uint32 layers to project
+ * flats down (including this one), Uint32 layers to project bridges up,
+ * Uint32 flat, bridge and fill region poly counts then those packed
+ * polys. trimmed layers are intersected with their fill region
+ *
+ * returns a malloc'd block: Uint32 byte length, then for each layer
+ * the solid areas as null terminated packed polys (mem_clr to release)
+ */
+__attribute__ ((export_name("solid_project")))
+Uint32 solid_project(Uint32 memat, Uint32 layers) {
+    std::vector<Paths> flats(layers), bridges(layers), inner(layers);
+    std::vector<Uint32> trim(layers);
+    std::vector<solid_source> sources;
+    Uint32 pos = memat;
+    for (Uint32 l = 0; l < layers; l++) {
+        Uint32 *head = (Uint32 *)(mem + pos);
+        Uint32 down = head[1], up = head[2];
+        trim[l] = head[0] & 1;
+        flats[l].resize(head[3]);
+        bridges[l].resize(head[4]);
+        inner[l].resize(head[5]);
+        pos = readPolys(flats[l], pos + 24, head[3]);
+        pos = readPolys(bridges[l], pos, head[4]);
+        pos = readPolys(inner[l], pos, head[5]);
+        if (down && flats[l].size()) {
+            sources.push_back({ l + 1 > down ? l + 1 - down : 0, l, &flats[l] });
+        }
+        if (up && bridges[l].size()) {
+            sources.push_back({ l, std::min(l + up - 1, layers - 1), &bridges[l] });
+        }
+    }
+    std::sort(sources.begin(), sources.end(), [](const solid_source &a, const solid_source &b) {
+        return a.from < b.from;
+    });
+
+    solid_window window;
+    Paths merged;
+    Uint32 next = 0;
+    slice_out out;
+    for (Uint32 l = 0; l < layers; l++) {
+        bool changed = window.leave(l);
+        while (next < sources.size() && sources[next].from == l) {
+            window.enter(sources[next++]);
+            changed = true;
+        }
+        if (changed) {
+            window.merged(merged);
+        }
+        if (merged.size() && trim[l]) {
+            Paths trimmed;
+            if (inner[l].size()) {
+                Clipper clip;
+                clip.AddPaths(merged, ptSubject, true);
+                clip.AddPaths(inner[l], ptClip, true);
+                clip.Execute(ctIntersection, trimmed, pftNonZero, pftEvenOdd);
+            }
+            for (Path &path : trimmed) {
+                out.putPath(path);
+            }
+        } else {
+            for (Path &path : merged) {
+                out.putPath(path);
+            }
+        }
+        out.put16(0);
+    }
+
+    Uint32 size = 4 + out.data.size();
+    Uint8 *res = (Uint8 *)malloc(size);
+    *(Uint32 *)res = size;
+    memcpy(res + 4, out.data.data(), out.data.size());
+    return (Uint32)res;
+}
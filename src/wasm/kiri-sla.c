@@ -1,9 +1,15 @@
 #include <emscripten.h>
 #include <string.h>
+#include <math.h>
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
 
 typedef unsigned char Uint8;
 typedef unsigned short Uint16;
 typedef unsigned int Uint32;
+typedef unsigned long long Uint64;
+typedef long long Int64;
 
 struct info {
     Uint16 width;  // image width
@@ -26,14 +32,66 @@ struct point {
     float y;
 };
 
+struct region {
+    Uint16 minx; // columns minx to maxx - 1
+    Uint16 maxx;
+    Uint16 miny; // rows miny to maxy - 1
+    Uint16 maxy;
+};
+
+// hash and bounds of a rendered polygon record (including inners)
+struct polysum {
+    Uint64 hash;
+    struct region bounds;
+};
+
+// open addressing slot used to match polygons between layers
+struct polyslot {
+    Uint64 hash;
+    Uint32 gen;   // slot is live only when gen matches the current pass
+    Uint32 count; // number of unmatched polygons with this hash
+};
+
+struct stats {
+    Uint32 pixels; // number of non-zero pixels
+    Uint16 minx;   // bounding box of non-zero pixels
+    Uint16 maxx;   // (inclusive, all zero when pixels == 0)
+    Uint16 miny;
+    Uint16 maxy;
+};
+
 const Uint8 ph_size = sizeof(struct poly);
 const Uint8 pt_size = sizeof(struct point);
 
 extern void reportf(float a, float b);
 extern void reporti(int a, int b);
+extern unsigned char __heap_base;
 
 Uint32 readoff; // read position offset
 
+// polygon summaries of the last rendered layer for render_delta(). they
+// live in a scratch block at the top of memory sized to the layer (sums
+// for two layers then twice as many hash slots) which render() resizes
+// and render_delta() grows. callers keep their data below scratch_base()
+struct polysum *sums[2];
+struct polyslot *slots;
+Uint32 sum_cap;     // polygon capacity of each sums[] array
+Uint32 sum_gen;     // current slot generation
+Uint8 sum_last;     // which sums[] holds the last layer
+Uint32 sum_count;   // number of polygons in the last layer
+Uint16 sum_width;   // raster dimensions of the last layer
+Uint16 sum_height;  // (zero until a layer has been rendered)
+
+/**
+ * returns the first memory location past static data and stack.
+ * callers pass this as the memory base pointer so rasters and
+ * records never overwrite module data (eg. rle tables)
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 heap_base() {
+    return (Uint32)&__heap_base;
+}
+
 Uint8 check_cross(Uint32 x, Uint32 y, struct point *p1, struct point *p2) {
     return (
         ((p1->y >= y) != (p2->y >= y)) &&
@@ -78,10 +136,14 @@ Uint8 is_inside_poly(Uint32 x, Uint32 y, unsigned char *m, Uint32 o) {
     return side;
 }
 
-void rasterize_poly(unsigned char *m, Uint32 o, Uint32 height) {
+void rasterize_poly(unsigned char *m, Uint32 o, Uint32 height, struct region *clip) {
     struct poly *poly = (struct poly *)(m + readoff);
 
     Uint32 nextpoly = readoff + poly->length;
+    Uint32 minx = poly->minx > clip->minx ? poly->minx : clip->minx;
+    Uint32 maxx = poly->maxx < clip->maxx ? poly->maxx : clip->maxx;
+    Uint32 miny = poly->miny > clip->miny ? poly->miny : clip->miny;
+    Uint32 maxy = poly->maxy < clip->maxy ? poly->maxy : clip->maxy;
 
     // skip post header
     readoff += ph_size;
@@ -97,9 +159,9 @@ void rasterize_poly(unsigned char *m, Uint32 o, Uint32 height) {
     // point data starts here
     Uint32 pstart = readoff;
 
-    // scan bounding area of polygon
-    for (Uint32 x=poly->minx; x<poly->maxx; x++) {
-        for (Uint32 y=poly->miny; y<poly->maxy; y++) {
+    // scan bounding area of polygon within the clip region
+    for (Uint32 x=minx; x<maxx; x++) {
+        for (Uint32 y=miny; y<maxy; y++) {
 
             Uint8 side = 0; // 0=outside, 1=inside
 
@@ -146,6 +208,141 @@ void rasterize_poly(unsigned char *m, Uint32 o, Uint32 height) {
     readoff = nextpoly;
 }
 
+// hash a polygon record 4 bytes at a time (records are 2 byte aligned)
+Uint64 hash_poly(unsigned char *m, Uint32 pos, Uint32 len) {
+    Uint64 h = 0xcbf29ce484222325ULL ^ len;
+    Uint32 i = 0;
+    for (; i + 4 <= len; i += 4) {
+        Uint32 w;
+        memcpy(&w, m + pos + i, 4);
+        h = (h ^ w) * 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    for (; i < len; i++) {
+        h = (h ^ m[pos + i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+void region_add(struct region *r, struct region *b) {
+    if (b->minx >= b->maxx || b->miny >= b->maxy) return;
+    if (r->minx >= r->maxx) {
+        *r = *b;
+        return;
+    }
+    if (b->minx < r->minx) r->minx = b->minx;
+    if (b->maxx > r->maxx) r->maxx = b->maxx;
+    if (b->miny < r->miny) r->miny = b->miny;
+    if (b->maxy > r->maxy) r->maxy = b->maxy;
+}
+
+// first byte of the render_delta() scratch block (memory end when unused)
+EMSCRIPTEN_KEEPALIVE
+Uint32 scratch_base() {
+    Uint32 top = __builtin_wasm_memory_size(0) << 16;
+    return sum_cap ? (Uint32)slots : top;
+}
+
+// size the scratch block for `polys` polygons keeping the summaries of
+// the last layer when `keep` is set. `end` is the first byte past the
+// caller's polygon records. returns 0 when the block would overlap them
+Uint8 scratch_fit(Uint32 polys, Uint8 keep, Uint8 *end) {
+    Uint32 cap = 64;
+    while (cap < polys) cap <<= 1;
+    if (keep && cap <= sum_cap && (Uint8 *)slots >= end) {
+        return 1;
+    }
+    if (keep && cap < sum_cap) {
+        cap = sum_cap;
+    }
+    Uint32 top = __builtin_wasm_memory_size(0) << 16;
+    Uint32 size = cap * 2 * (sizeof (struct polysum) + sizeof (struct polyslot));
+    if (size > top || (Uint8 *)(top - size) < end) {
+        sum_cap = 0;
+        sum_count = sum_width = sum_height = 0;
+        return 0;
+    }
+    // sums[i] sits just below sums[i-1] and the slots below both. moving
+    // the last layer up or down never lands on data that is still needed
+    struct polysum *last = (struct polysum *)(top - (sum_last + 1) * cap * sizeof (struct polysum));
+    if (keep && sum_count) {
+        memmove(last, sums[sum_last], sum_count * sizeof (struct polysum));
+    }
+    sums[0] = (struct polysum *)(top - cap * sizeof (struct polysum));
+    sums[1] = (struct polysum *)(top - 2 * cap * sizeof (struct polysum));
+    slots = (struct polyslot *)(top - size);
+    memset(slots, 0, cap * 2 * sizeof (struct polyslot));
+    sum_gen = 0;
+    sum_cap = cap;
+    return 1;
+}
+
+// first byte past the polygon records of the layer at i
+Uint8 *polys_end(unsigned char *m, Uint32 i) {
+    struct info *info = (struct info *)(m + i);
+    Uint32 pos = (sizeof (struct info)) + i;
+    for (Uint32 p=0; p<info->polys; p++) {
+        pos += ((struct poly *)(m + pos))->length;
+    }
+    return m + pos;
+}
+
+struct polyslot *slot_find(Uint64 hash) {
+    Uint32 mask = sum_cap * 2 - 1;
+    Uint32 at = (Uint32)(hash ^ (hash >> 32)) & mask;
+    for (;;) {
+        struct polyslot *slot = &slots[at];
+        if (slot->gen != sum_gen || slot->hash == hash) {
+            return slot;
+        }
+        at = (at + 1) & mask;
+    }
+}
+
+// summarize each polygon record of the layer at i into sums[which]
+Uint32 summarize(unsigned char *m, Uint32 i, Uint8 which) {
+    struct info *info = (struct info *)(m + i);
+    Uint32 pos = (sizeof (struct info)) + i;
+    for (Uint32 p=0; p<info->polys; p++) {
+        struct poly *poly = (struct poly *)(m + pos);
+        struct polysum *sum = &sums[which][p];
+        sum->hash = hash_poly(m, pos, poly->length);
+        sum->bounds.minx = poly->minx;
+        sum->bounds.maxx = poly->maxx;
+        sum->bounds.miny = poly->miny;
+        sum->bounds.maxy = poly->maxy;
+        pos += poly->length;
+    }
+    return info->polys;
+}
+
+// clear the raster within clip then draw every polygon that intersects it
+Uint32 render_region(unsigned char *m, Uint32 i, Uint32 o, struct region *clip) {
+    struct info *info = (struct info *)(m + i);
+    Uint32 height = info->height;
+
+    if (clip->minx == 0 && clip->maxx == info->width && clip->miny == 0 && clip->maxy == height) {
+        memset(m+o, 0, info->width * height);
+    } else {
+        for (Uint32 x=clip->minx; x<clip->maxx; x++) {
+            memset(m + o + x * height + clip->miny, 0, clip->maxy - clip->miny);
+        }
+    }
+
+    readoff = (sizeof (struct info)) + i;
+    for (Uint32 p=0; p<info->polys; p++) {
+        struct poly *poly = (struct poly *)(m + readoff);
+        if (poly->maxx <= clip->minx || poly->minx >= clip->maxx ||
+            poly->maxy <= clip->miny || poly->miny >= clip->maxy) {
+            readoff += poly->length;
+            continue;
+        }
+        rasterize_poly(m, o, height, clip);
+    }
+
+    return readoff;
+}
+
 /**
  * m = memory base pointer
  * i = input memory location (polygon records)
@@ -155,36 +352,243 @@ void rasterize_poly(unsigned char *m, Uint32 o, Uint32 height) {
 EMSCRIPTEN_KEEPALIVE
 Uint32 render(unsigned char *m, Uint32 i, Uint32 o) {
     struct info *info = (struct info *)(m + i);
-    Uint32 impos;
-    Uint8 inside;
-    Uint32 polypos = (sizeof (struct info)) + i;
+    struct region full = { 0, info->width, 0, info->height };
 
-    memset(m+o, 0, info->width * info->height);
+    // record this layer as the baseline for render_delta()
+    if (scratch_fit(info->polys, 0, polys_end(m, i))) {
+        sum_count = summarize(m, i, sum_last);
+        sum_width = info->width;
+        sum_height = info->height;
+    }
 
-    readoff = polypos;
-    for (Uint32 p=0; p<info->polys; p++) {
-        rasterize_poly(m, o, info->height);
+    return render_region(m, i, o, &full);
+}
+
+/**
+ * incremental render. the raster at `o` must still hold the layer drawn
+ * by the previous render() or render_delta() call. polygons are matched
+ * against that layer by content and only the union of the bounds of
+ * added and removed polygons is cleared and redrawn.
+ *
+ * m = memory base pointer
+ * i = input memory location (polygon records)
+ * o = output memory location (for raster)
+ * d = output memory location (changed region, empty when minx == maxx)
+ * returns last read position in memory
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 render_delta(unsigned char *m, Uint32 i, Uint32 o, Uint32 d) {
+    struct info *info = (struct info *)(m + i);
+    struct region *dirty = (struct region *)(m + d);
+    struct region full = { 0, info->width, 0, info->height };
+
+    dirty->minx = dirty->maxx = dirty->miny = dirty->maxy = 0;
+
+    Uint8 *end = polys_end(m, i);
+    if (end < m + d + sizeof (struct region)) {
+        end = m + d + sizeof (struct region);
     }
 
-    return readoff;
+    if (!scratch_fit(info->polys, 1, end)) {
+        // no room to summarize this layer, redraw everything
+        *dirty = full;
+        return render_region(m, i, o, &full);
+    }
+
+    Uint8 next = 1 - sum_last;
+    Uint32 count = summarize(m, i, next);
+
+    if (info->width != sum_width || info->height != sum_height) {
+        // no usable baseline, redraw everything
+        *dirty = full;
+    } else {
+        // count last layer polygons by hash
+        if (++sum_gen == 0) {
+            memset(slots, 0, sum_cap * 2 * sizeof (struct polyslot));
+            sum_gen = 1;
+        }
+        for (Uint32 p=0; p<sum_count; p++) {
+            struct polyslot *slot = slot_find(sums[sum_last][p].hash);
+            if (slot->gen != sum_gen) {
+                slot->gen = sum_gen;
+                slot->hash = sums[sum_last][p].hash;
+                slot->count = 0;
+            }
+            slot->count++;
+        }
+        // polygons without a match in the last layer were added
+        for (Uint32 p=0; p<count; p++) {
+            struct polyslot *slot = slot_find(sums[next][p].hash);
+            if (slot->gen == sum_gen && slot->count > 0) {
+                slot->count--;
+            } else {
+                region_add(dirty, &sums[next][p].bounds);
+            }
+        }
+        // last layer polygons left unmatched were removed
+        for (Uint32 p=0; p<sum_count; p++) {
+            struct polyslot *slot = slot_find(sums[sum_last][p].hash);
+            if (slot->count > 0) {
+                slot->count--;
+                region_add(dirty, &sums[sum_last][p].bounds);
+            }
+        }
+        // clamp to the raster
+        if (dirty->maxx > info->width) dirty->maxx = info->width;
+        if (dirty->maxy > info->height) dirty->maxy = info->height;
+        if (dirty->minx >= dirty->maxx || dirty->miny >= dirty->maxy) {
+            dirty->minx = dirty->maxx = dirty->miny = dirty->maxy = 0;
+        }
+    }
+
+    sum_last = next;
+    sum_count = count;
+    sum_width = info->width;
+    sum_height = info->height;
+
+    if (dirty->minx == dirty->maxx) {
+        // nothing changed, skip to the end of the polygon records
+        readoff = (sizeof (struct info)) + i;
+        for (Uint32 p=0; p<count; p++) {
+            readoff += ((struct poly *)(m + readoff))->length;
+        }
+        return readoff;
+    }
+
+    return render_region(m, i, o, dirty);
 }
 
-Uint8 rle_byte(Uint8 color, Uint8 count, Uint8 type) {
+// photons (type 1) run byte is the bit-reversed (count - 1) with color in bit 0
+static const Uint8 rle_rev[128] = {
+    0x00, 0x80, 0x40, 0xc0, 0x20, 0xa0, 0x60, 0xe0, 0x10, 0x90, 0x50, 0xd0, 0x30, 0xb0, 0x70, 0xf0,
+    0x08, 0x88, 0x48, 0xc8, 0x28, 0xa8, 0x68, 0xe8, 0x18, 0x98, 0x58, 0xd8, 0x38, 0xb8, 0x78, 0xf8,
+    0x04, 0x84, 0x44, 0xc4, 0x24, 0xa4, 0x64, 0xe4, 0x14, 0x94, 0x54, 0xd4, 0x34, 0xb4, 0x74, 0xf4,
+    0x0c, 0x8c, 0x4c, 0xcc, 0x2c, 0xac, 0x6c, 0xec, 0x1c, 0x9c, 0x5c, 0xdc, 0x3c, 0xbc, 0x7c, 0xfc,
+    0x02, 0x82, 0x42, 0xc2, 0x22, 0xa2, 0x62, 0xe2, 0x12, 0x92, 0x52, 0xd2, 0x32, 0xb2, 0x72, 0xf2,
+    0x0a, 0x8a, 0x4a, 0xca, 0x2a, 0xaa, 0x6a, 0xea, 0x1a, 0x9a, 0x5a, 0xda, 0x3a, 0xba, 0x7a, 0xfa,
+    0x06, 0x86, 0x46, 0xc6, 0x26, 0xa6, 0x66, 0xe6, 0x16, 0x96, 0x56, 0xd6, 0x36, 0xb6, 0x76, 0xf6,
+    0x0e, 0x8e, 0x4e, 0xce, 0x2e, 0xae, 0x6e, 0xee, 0x1e, 0x9e, 0x5e, 0xde, 0x3e, 0xbe, 0x7e, 0xfe,
+};
+
+// per-mask encoder state while scanning the raster
+struct rle_state {
+    Uint8 *out;   // next output byte
+    Uint32 start; // raster position where the current run started
+    Uint8 color;  // color of the current run (0 or 1)
+};
+
+// emit one run of `len` pixels, split at the format's max count
+Uint8 *rle_run(Uint8 *out, Uint8 color, Uint32 len, Uint8 type) {
     if (type == 0) {
-        return (count & 0x7f) | ((color << 7) & 0x80);
+        Uint8 hi = color << 7;
+        for (; len > 125; len -= 125) *out++ = hi | 125;
+        *out++ = hi | len;
     } else {
-        Uint8 run = count - 1;
-        return
-            (run & 1  ? 128 : 0) |
-            (run & 2  ?  64 : 0) |
-            (run & 4  ?  32 : 0) |
-            (run & 8  ?  16 : 0) |
-            (run & 16 ?   8 : 0) |
-            (run & 32 ?   4 : 0) |
-            (run & 64 ?   2 : 0) | color;
+        for (; len > 128; len -= 128) *out++ = rle_rev[127] | color;
+        *out++ = rle_rev[len - 1] | color;
+    }
+    return out;
+}
+
+// consume `bits` (bit i = pixel pos + i is set under the mask) emitting
+// a run at every transition. bits above the chunk length must be clear
+static inline void rle_bits(struct rle_state *st, Uint32 bits, Uint32 pos, Uint32 n, Uint8 type) {
+    Uint32 trans = (bits ^ ((bits << 1) | st->color)) & ((1u << n) - 1);
+    while (trans) {
+        Uint32 p = pos + __builtin_ctz(trans);
+        st->out = rle_run(st->out, st->color, p - st->start, type);
+        st->start = p;
+        st->color ^= 1;
+        trans &= trans - 1;
     }
 }
 
+// encode one stream per mask (count <= 4) in a single pass over the raster.
+// a zero mask is valid and encodes the whole raster as color 0 runs
+Uint32 rle_encode_masks(unsigned char *mem, Uint32 in, Uint32 ilen, Uint8 *mask, Uint32 count, Uint32 out, Uint32 *len, Uint8 type) {
+    struct rle_state state[4];
+    Uint8 *px = mem + in;
+    Uint32 pos = 0;
+
+    for (Uint32 k=0; k<count; k++) {
+        state[k].out = mem + out + k * ilen;
+        state[k].start = 0;
+        state[k].color = (px[0] & mask[k]) ? 1 : 0;
+    }
+
+#ifdef __wasm_simd128__
+    v128_t zero = wasm_i8x16_splat(0);
+    v128_t vmask[4];
+    for (Uint32 k=0; k<count; k++) {
+        vmask[k] = wasm_i8x16_splat(mask[k]);
+    }
+    for (; pos + 16 <= ilen; pos += 16) {
+        v128_t v = wasm_v128_load(px + pos);
+        for (Uint32 k=0; k<count; k++) {
+            Uint32 bits = wasm_i8x16_bitmask(wasm_i8x16_ne(wasm_v128_and(v, vmask[k]), zero));
+            rle_bits(&state[k], bits, pos, 16, type);
+        }
+    }
+#else
+    // swar: high bit of each byte set when (byte & mask) != 0, then gather
+    // the 8 high bits into a byte with a multiply
+    Uint64 wmask[4];
+    for (Uint32 k=0; k<count; k++) {
+        wmask[k] = mask[k] * 0x0101010101010101ULL;
+    }
+    for (; pos + 8 <= ilen; pos += 8) {
+        Uint64 w;
+        memcpy(&w, px + pos, 8);
+        for (Uint32 k=0; k<count; k++) {
+            Uint64 t = w & wmask[k];
+            Uint64 hi = (((t & 0x7f7f7f7f7f7f7f7fULL) + 0x7f7f7f7f7f7f7f7fULL) | t) & 0x8080808080808080ULL;
+            Uint32 bits = ((hi >> 7) * 0x0102040810204080ULL) >> 56;
+            rle_bits(&state[k], bits, pos, 8, type);
+        }
+    }
+#endif
+
+    // remaining tail pixels
+    for (; pos < ilen; pos++) {
+        for (Uint32 k=0; k<count; k++) {
+            rle_bits(&state[k], (px[pos] & mask[k]) ? 1 : 0, pos, 1, type);
+        }
+    }
+
+    // close out the final run of each stream and record lengths
+    Uint32 total = 0;
+    for (Uint32 k=0; k<count; k++) {
+        struct rle_state *st = &state[k];
+        st->out = rle_run(st->out, st->color, ilen - st->start, type);
+        len[k] = st->out - (mem + out + k * ilen);
+        total += len[k];
+    }
+
+    return total;
+}
+
+/**
+ * mem   = memory base pointer
+ * in    = input memory location (raster)
+ * ilen  = input raster length in bytes
+ * masks = up to 4 pixel masks packed one per byte, low byte first. a zero
+ *         byte ends the list
+ * out   = output memory location. stream for mask k is written at
+ *         out + k * ilen (worst case encoding is one byte per pixel)
+ * lens  = output memory location for the Uint32 length of each stream
+ * type  = 0=photon, 1=photons
+ * returns total length of all rle-encoded streams
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 rle_encode_all(unsigned char *mem, Uint32 in, Uint32 ilen, Uint32 masks, Uint32 out, Uint32 lens, Uint8 type) {
+    Uint8 mask[4];
+    Uint32 count = 0;
+    for (; count < 4 && (masks & 0xff); masks >>= 8, count++) {
+        mask[count] = masks & 0xff;
+    }
+    return rle_encode_masks(mem, in, ilen, mask, count, out, (Uint32 *)(mem + lens), type);
+}
+
 /**
  * mem  = memory base pointer
  * in   = input memory location (raster)
@@ -195,23 +599,619 @@ Uint8 rle_byte(Uint8 color, Uint8 count, Uint8 type) {
  */
 EMSCRIPTEN_KEEPALIVE
 Uint32 rle_encode(unsigned char *mem, Uint32 in, Uint32 ilen, Uint8 mask, Uint32 out, Uint8 type) {
-    Uint8 color = (mem[in++] & mask) ? 1 : 0; // current color
-    Uint8 count = 1; // number of color matches
-    Uint8 cmax = type == 0 ? 125 : 128; // count max
-    Uint8 next; // next color
-    Uint32 opos = out;
-    while (--ilen > 0) {
-        next = (mem[in++] & mask) ? 1 : 0;
-        if (color != next || count == cmax) {
-            mem[opos++] = rle_byte(color, count, type);
-            count = 0;
+    Uint32 len;
+    return rle_encode_masks(mem, in, ilen, &mask, 1, out, &len, type);
+}
+
+/**
+ * m      = memory base pointer
+ * o      = raster memory location
+ * width  = raster width (columns)
+ * height = raster height (bytes per column)
+ * s      = output memory location (stats record)
+ * returns number of non-zero pixels
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 raster_stats(unsigned char *m, Uint32 o, Uint32 width, Uint32 height, Uint32 s) {
+    struct stats *stats = (struct stats *)(m + s);
+    Uint32 pixels = 0;
+    Uint32 minx = width, maxx = 0, miny = height, maxy = 0;
+
+    for (Uint32 x=0; x<width; x++) {
+        Uint8 *col = m + o + x * height;
+        Uint32 count = 0;
+        Uint32 first = height, last = 0;
+        Uint32 y = 0;
+#ifdef __wasm_simd128__
+        v128_t zero = wasm_i8x16_splat(0);
+        for (; y + 16 <= height; y += 16) {
+            Uint32 bits = wasm_i8x16_bitmask(wasm_i8x16_ne(wasm_v128_load(col + y), zero));
+            if (bits) {
+                count += __builtin_popcount(bits);
+                if (first == height) first = y + __builtin_ctz(bits);
+                last = y + 31 - __builtin_clz(bits);
+            }
+        }
+#endif
+        for (; y < height; y++) {
+            if (col[y]) {
+                count++;
+                if (first == height) first = y;
+                last = y;
+            }
+        }
+        if (count) {
+            pixels += count;
+            if (x < minx) minx = x;
+            maxx = x;
+            if (first < miny) miny = first;
+            if (last > maxy) maxy = last;
         }
-        count++;
-        color = next;
     }
 
-    if (count > 0) {
-        mem[opos++] = rle_byte(color, count, type);
+    if (pixels == 0) {
+        minx = maxx = miny = maxy = 0;
     }
-    return opos - out;
+    stats->pixels = pixels;
+    stats->minx = minx;
+    stats->maxx = maxx;
+    stats->miny = miny;
+    stats->maxy = maxy;
+
+    return pixels;
+}
+
+// emit one 6 byte CXDLP line record (13 bit y_start, 13 bit y_end, 14 bit x, 8 bit color)
+Uint8 *cxdlp_line(Uint8 *out, Uint32 y_start, Uint32 y_end, Uint32 x_end, Uint8 color) {
+    out[0] = y_start >> 5;
+    out[1] = (y_start << 3) | (y_end >> 10);
+    out[2] = y_end >> 2;
+    out[3] = (y_end << 6) | (x_end >> 8);
+    out[4] = x_end;
+    out[5] = color;
+    return out + 6;
+}
+
+/**
+ * m      = memory base pointer
+ * o      = raster memory location
+ * height = raster height (bytes per column)
+ * minx   = first column to scan
+ * maxx   = last column to scan (inclusive)
+ * out    = output memory location (for line records)
+ * max    = maximum number of records that fit at the output location
+ * returns number of line records in the raster which may exceed `max`
+ * in which case the output is truncated and should be discarded
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 raster_lines(unsigned char *m, Uint32 o, Uint32 height, Uint32 minx, Uint32 maxx, Uint32 out, Uint32 max) {
+    Uint8 *rec = m + out;
+    Uint32 count = 0;
+
+    for (Uint32 x=minx; x<=maxx; x++) {
+        Uint8 *col = m + o + x * height;
+        Uint8 last = col[0];
+        Uint32 start = 0;
+        Uint32 y = 1;
+        while (y < height) {
+#ifdef __wasm_simd128__
+            // compare each pixel to its predecessor 16 at a time
+            Uint32 bits = 0;
+            while (y + 16 <= height) {
+                bits = wasm_i8x16_bitmask(wasm_i8x16_ne(
+                    wasm_v128_load(col + y),
+                    wasm_v128_load(col + y - 1)
+                ));
+                if (bits) break;
+                y += 16;
+            }
+            if (bits) {
+                y += __builtin_ctz(bits);
+            } else {
+                for (; y < height && col[y] == last; y++) ;
+            }
+#else
+            // skip runs 8 pixels at a time while they match the last color
+            Uint64 lastw = last * 0x0101010101010101ULL;
+            for (;;) {
+                Uint64 word;
+                if (y + 8 > height) break;
+                memcpy(&word, col + y, 8);
+                if (word != lastw) break;
+                y += 8;
+            }
+            for (; y < height && col[y] == last; y++) ;
+#endif
+            if (y >= height) {
+                break;
+            }
+            if (last) {
+                if (count++ < max) rec = cxdlp_line(rec, start, y, x, last);
+            }
+            last = col[y];
+            start = y++;
+        }
+        // close run reaching the end of the column
+        if (last) {
+            if (count++ < max) rec = cxdlp_line(rec, start, height, x, last);
+        }
+    }
+
+    return count;
+}
+
+// dst[i] = min (op 0) or max (op 1) of a[i] and b[i]. dst may alias `a`
+// when `b` points ahead of it (used for in place window doubling)
+void span_minmax(Uint8 *dst, Uint8 *a, Uint8 *b, Uint32 n, Uint8 op) {
+    Uint32 i = 0;
+#ifdef __wasm_simd128__
+    if (op) {
+        for (; i + 16 <= n; i += 16) {
+            wasm_v128_store(dst + i, wasm_u8x16_max(wasm_v128_load(a + i), wasm_v128_load(b + i)));
+        }
+    } else {
+        for (; i + 16 <= n; i += 16) {
+            wasm_v128_store(dst + i, wasm_u8x16_min(wasm_v128_load(a + i), wasm_v128_load(b + i)));
+        }
+    }
+#endif
+    if (op) {
+        for (; i < n; i++) dst[i] = a[i] > b[i] ? a[i] : b[i];
+    } else {
+        for (; i < n; i++) dst[i] = a[i] < b[i] ? a[i] : b[i];
+    }
+}
+
+// dst[i] = sum of w[k] * src[i + k * step] for k < taps (weights sum to 256)
+void span_conv(Uint8 *dst, Uint8 *src, Uint32 n, Uint32 step, Uint16 *w, Uint32 taps) {
+    Uint32 i = 0;
+#ifdef __wasm_simd128__
+    v128_t round = wasm_i16x8_splat(128);
+    for (; i + 16 <= n; i += 16) {
+        v128_t lo = round, hi = round;
+        for (Uint32 k=0; k<taps; k++) {
+            v128_t v = wasm_v128_load(src + i + k * step);
+            v128_t wk = wasm_i16x8_splat(w[k]);
+            lo = wasm_i16x8_add(lo, wasm_i16x8_mul(wasm_u16x8_extend_low_u8x16(v), wk));
+            hi = wasm_i16x8_add(hi, wasm_i16x8_mul(wasm_u16x8_extend_high_u8x16(v), wk));
+        }
+        wasm_v128_store(dst + i, wasm_u8x16_narrow_i16x8(wasm_u16x8_shr(lo, 8), wasm_u16x8_shr(hi, 8)));
+    }
+#endif
+    for (; i < n; i++) {
+        Uint32 acc = 128;
+        for (Uint32 k=0; k<taps; k++) {
+            acc += w[k] * src[i + k * step];
+        }
+        dst[i] = acc >> 8;
+    }
+}
+
+// copy columns into t with `r` pad columns of `pad` on either side
+void pad_columns(Uint8 *img, Uint32 width, Uint32 height, Uint32 r, Uint8 *t, Uint8 pad) {
+    memset(t, pad, r * height);
+    memcpy(t + r * height, img, width * height);
+    memset(t + (r + width) * height, pad, r * height);
+}
+
+// copy each column into t with `r` pad rows of `pad` above and below
+void pad_rows(Uint8 *img, Uint32 width, Uint32 height, Uint32 r, Uint8 *t, Uint8 pad) {
+    Uint32 h2 = height + r * 2;
+    for (Uint32 x=0; x<width; x++) {
+        Uint8 *col = t + x * h2;
+        memset(col, pad, r);
+        memcpy(col + r, img + x * height, height);
+        memset(col + r + height, pad, r);
+    }
+}
+
+// in place window doubling until t[i] holds the min/max of `p` elements
+// `step` bytes apart starting at t[i]. returns p (largest power of 2 <= len)
+Uint32 span_double(Uint8 *t, Uint32 n, Uint32 step, Uint32 len, Uint8 op) {
+    Uint32 p = 1;
+    while (p * 2 <= len) {
+        span_minmax(t, t, t + p * step, n - p * step, op);
+        p *= 2;
+    }
+    return p;
+}
+
+// separable square window min (op 0) or max (op 1) of radius rx, ry.
+// each pass is O(log r) vector passes over the raster independent of
+// the number of window pixels. a window is the min/max of two
+// overlapping power of 2 windows
+void raster_morph(Uint8 *img, Uint32 width, Uint32 height, Uint32 rx, Uint32 ry, Uint8 *t, Uint8 op) {
+    Uint8 pad = op ? 0 : 255;
+    if (rx) {
+        Uint32 len = rx * 2 + 1;
+        Uint32 cols = width + rx * 2;
+        pad_columns(img, width, height, rx, t, pad);
+        Uint32 p = span_double(t, cols * height, height, len, op);
+        span_minmax(img, t, t + (len - p) * height, width * height, op);
+    }
+    if (ry) {
+        Uint32 len = ry * 2 + 1;
+        Uint32 h2 = height + ry * 2;
+        pad_rows(img, width, height, ry, t, pad);
+        Uint32 p = span_double(t, width * h2, 1, len, op);
+        for (Uint32 x=0; x<width; x++) {
+            span_minmax(img + x * height, t + x * h2, t + x * h2 + len - p, height, op);
+        }
+    }
+}
+
+/**
+ * shrink lit areas by the given radius in pixels (square window)
+ *
+ * m      = memory base pointer
+ * o      = raster memory location (modified in place)
+ * width  = raster width (columns)
+ * height = raster height (bytes per column)
+ * rx, ry = radius in pixels along x (columns) and y (rows)
+ * t      = scratch memory location of at least
+ *          max((width + 2 * rx) * height, width * (height + 2 * ry)) bytes
+ */
+EMSCRIPTEN_KEEPALIVE
+void raster_erode(unsigned char *m, Uint32 o, Uint32 width, Uint32 height, Uint32 rx, Uint32 ry, Uint32 t) {
+    raster_morph(m + o, width, height, rx, ry, m + t, 0);
+}
+
+/**
+ * grow lit areas by the given radius in pixels (square window)
+ * parameters are the same as raster_erode()
+ */
+EMSCRIPTEN_KEEPALIVE
+void raster_dilate(unsigned char *m, Uint32 o, Uint32 width, Uint32 height, Uint32 rx, Uint32 ry, Uint32 t) {
+    raster_morph(m + o, width, height, rx, ry, m + t, 1);
+}
+
+// gaussian weights for a kernel of 2r+1 taps (sigma = r/2) summing to 256
+Uint32 blur_kernel(Uint16 *w, Uint32 r) {
+    Uint32 taps = r * 2 + 1;
+    float sigma = r > 1 ? r / 2.0f : 0.5f;
+    float f[taps], sum = 0;
+    for (Uint32 k=0; k<taps; k++) {
+        float d = (float)k - r;
+        f[k] = expf(-(d * d) / (2 * sigma * sigma));
+        sum += f[k];
+    }
+    Uint32 total = 0;
+    for (Uint32 k=0; k<taps; k++) {
+        w[k] = (Uint16)(f[k] * 256 / sum + 0.5f);
+        total += w[k];
+    }
+    // fold rounding error into the center tap
+    w[r] += 256 - total;
+    return taps;
+}
+
+/**
+ * separable gaussian blur with a kernel radius of rx, ry pixels (sigma is
+ * half the radius). pixels outside the raster are treated as unlit.
+ * parameters are the same as raster_erode()
+ */
+EMSCRIPTEN_KEEPALIVE
+void raster_blur(unsigned char *m, Uint32 o, Uint32 width, Uint32 height, Uint32 rx, Uint32 ry, Uint32 t) {
+    Uint8 *img = m + o;
+    Uint8 *tmp = m + t;
+    if (rx) {
+        Uint16 w[rx * 2 + 1];
+        Uint32 taps = blur_kernel(w, rx);
+        pad_columns(img, width, height, rx, tmp, 0);
+        span_conv(img, tmp, width * height, height, w, taps);
+    }
+    if (ry) {
+        Uint16 w[ry * 2 + 1];
+        Uint32 taps = blur_kernel(w, ry);
+        Uint32 h2 = height + ry * 2;
+        pad_rows(img, width, height, ry, tmp, 0);
+        for (Uint32 x=0; x<width; x++) {
+            span_conv(img + x * height, tmp + x * h2, height, 1, w, taps);
+        }
+    }
+}
+
+/**
+ * scale each pixel by a mask raster: o[i] = o[i] * k[i] / 255
+ *
+ * m   = memory base pointer
+ * o   = raster memory location (modified in place)
+ * k   = mask raster memory location
+ * len = raster length in bytes
+ */
+EMSCRIPTEN_KEEPALIVE
+void raster_mask(unsigned char *m, Uint32 o, Uint32 k, Uint32 len) {
+    Uint8 *img = m + o;
+    Uint8 *msk = m + k;
+    Uint32 i = 0;
+#ifdef __wasm_simd128__
+    v128_t round = wasm_i16x8_splat(128);
+    for (; i + 16 <= len; i += 16) {
+        v128_t v = wasm_v128_load(img + i);
+        v128_t k = wasm_v128_load(msk + i);
+        v128_t lo = wasm_i16x8_add(wasm_i16x8_mul(wasm_u16x8_extend_low_u8x16(v), wasm_u16x8_extend_low_u8x16(k)), round);
+        v128_t hi = wasm_i16x8_add(wasm_i16x8_mul(wasm_u16x8_extend_high_u8x16(v), wasm_u16x8_extend_high_u8x16(k)), round);
+        // exact rounded divide by 255: (t + (t >> 8)) >> 8
+        lo = wasm_u16x8_shr(wasm_i16x8_add(lo, wasm_u16x8_shr(lo, 8)), 8);
+        hi = wasm_u16x8_shr(wasm_i16x8_add(hi, wasm_u16x8_shr(hi, 8)), 8);
+        wasm_v128_store(img + i, wasm_u8x16_narrow_i16x8(lo, hi));
+    }
+#endif
+    for (; i < len; i++) {
+        Uint32 t = img[i] * msk[i] + 128;
+        img[i] = (t + (t >> 8)) >> 8;
+    }
+}
+
+// support planning pillar record followed by (top - bottom + 1) points
+struct pillar {
+    Uint16 top;    // first (highest) layer of the pillar, below the tip
+    Uint16 bottom; // last (lowest) layer of the pillar
+    Uint16 flags;  // 1 = reached the floor, 2 = landed on the part
+    Uint16 pad;
+};
+
+struct cell {
+    Uint16 x;
+    Uint16 y;
+};
+
+#define PILLAR_FLOOR 1
+#define PILLAR_LANDED 2
+
+// support planner working state (see support_plan)
+struct planner {
+    Uint8 *stack;    // packed occupancy bits, one bitmap per layer
+    Uint32 lbytes;   // bytes per packed layer
+    Uint32 width;
+    Uint32 height;
+    Uint32 radius;   // pillar radius in cells
+    Uint8 *occ;      // unpacked occupancy of the current layer
+    Uint16 *tips;    // per cell (layer + 1) of the most recent covering tip
+    Uint8 *out;      // next output record
+    Uint8 *end;      // end of output memory
+    Uint32 count;    // number of pillars emitted
+};
+
+static inline Uint8 occupied(struct planner *pl, Uint32 layer, Uint32 idx) {
+    return (pl->stack[layer * pl->lbytes + (idx >> 3)] >> (idx & 7)) & 1;
+}
+
+void unpack_layer(struct planner *pl, Uint32 layer, Uint8 *dst) {
+    Uint8 *src = pl->stack + layer * pl->lbytes;
+    Uint32 n = pl->width * pl->height;
+    for (Uint32 i=0; i<n; i++) {
+        dst[i] = (src[i >> 3] >> (i & 7)) & 1 ? 255 : 0;
+    }
+}
+
+/**
+ * rasterize one layer of polygon records (same format as render) and
+ * pack it into the occupancy stack used by support_plan()
+ *
+ * m     = memory base pointer
+ * i     = input memory location (polygon records)
+ * w     = work memory location (width * height bytes)
+ * s     = occupancy stack memory location
+ * layer = layer index in the stack
+ * returns last read position in memory
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 support_layer(unsigned char *m, Uint32 i, Uint32 w, Uint32 s, Uint32 layer) {
+    struct info *info = (struct info *)(m + i);
+    struct region full = { 0, info->width, 0, info->height };
+    Uint32 n = info->width * info->height;
+    Uint32 lbytes = (n + 7) >> 3;
+    Uint8 *raster = m + w;
+    Uint8 *bits = m + s + layer * lbytes;
+    Uint32 end = render_region(m, i, w, &full);
+    memset(bits, 0, lbytes);
+    for (Uint32 p=0; p<n; p++) {
+        if (raster[p]) bits[p >> 3] |= 1 << (p & 7);
+    }
+    return end;
+}
+
+// mark cells within radius r of (x,y) as covered by a tip at layer
+void stamp_tip(struct planner *pl, Uint32 x, Uint32 y, Uint32 r, Uint32 layer) {
+    Uint32 x0 = x > r ? x - r : 0, x1 = x + r < pl->width ? x + r : pl->width - 1;
+    Uint32 y0 = y > r ? y - r : 0, y1 = y + r < pl->height ? y + r : pl->height - 1;
+    for (Uint32 xx=x0; xx<=x1; xx++) {
+        int dx = (int)xx - (int)x;
+        for (Uint32 yy=y0; yy<=y1; yy++) {
+            int dy = (int)yy - (int)y;
+            if ((Uint32)(dx * dx + dy * dy) <= r * r) {
+                pl->tips[yy + xx * pl->height] = layer + 1;
+            }
+        }
+    }
+}
+
+// trace a pillar from under the tip at (x,y) down through the occupancy
+// stack. the center steps away from any part cells under the pillar
+// footprint and the pillar ends on the floor or where the center lands
+// on the part. returns the pillar flags or 0 if there was no room
+Uint32 trace_pillar(struct planner *pl, Uint32 x, Uint32 y, Uint32 top, Uint8 land) {
+    struct pillar *rec = (struct pillar *)pl->out;
+    struct cell *pts = (struct cell *)(pl->out + sizeof(struct pillar));
+    int r = pl->radius;
+    Uint32 layer = top;
+    Uint32 flags = 0;
+
+    if ((Uint8 *)(pts + top + 1) > pl->end) {
+        return 0;
+    }
+
+    for (;;) {
+        Uint32 idx = y + x * pl->height;
+        if (occupied(pl, layer, idx)) {
+            flags = PILLAR_LANDED;
+            layer++;
+            break;
+        }
+        // sum offsets of part cells under the pillar footprint
+        int sx = 0, sy = 0;
+        for (int dx=-r; dx<=r; dx++) {
+            int xx = (int)x + dx;
+            if (xx < 0 || xx >= (int)pl->width) continue;
+            for (int dy=-r; dy<=r; dy++) {
+                int yy = (int)y + dy;
+                if (yy < 0 || yy >= (int)pl->height || dx * dx + dy * dy > r * r) continue;
+                if (occupied(pl, layer, yy + xx * pl->height)) {
+                    sx += dx;
+                    sy += dy;
+                }
+            }
+        }
+        if (sx < 0 && x + 1 < pl->width) x++;
+        if (sx > 0 && x > 0) x--;
+        if (sy < 0 && y + 1 < pl->height) y++;
+        if (sy > 0 && y > 0) y--;
+        pts[top - layer].x = x;
+        pts[top - layer].y = y;
+        if (layer == 0) {
+            flags = PILLAR_FLOOR;
+            break;
+        }
+        layer--;
+    }
+
+    if (flags == PILLAR_LANDED && (!land || layer > top)) {
+        return 0;
+    }
+
+    rec->top = top;
+    rec->bottom = layer;
+    rec->flags = flags;
+    rec->pad = 0;
+    pl->out = (Uint8 *)(pts + (top - layer + 1));
+    pl->count++;
+    return flags;
+}
+
+/**
+ * plan support pillars from an occupancy stack built with support_layer().
+ * for each layer (bottom up) the cells not within `reach` of a part cell
+ * in the layer below are overhangs. overhangs are grouped into islands.
+ * pillars are placed on a `spacing` grid inside each island and at the
+ * cell nearest the center of any island left without coverage. a tip
+ * covers cells within the grid diagonal for `zspan` layers above it while
+ * those cells stay part of every layer in between. island cells still
+ * uncovered after that get a pillar of their own. each new pillar is
+ * traced downward against the stack.
+ *
+ * m       = memory base pointer
+ * s       = occupancy stack memory location
+ * w       = work memory location. at least 9 * width * height +
+ *           (width + 2 * reach) * (height + 2 * reach) bytes
+ * layers  = number of layers in the stack
+ * width   = grid width (columns)
+ * height  = grid height (cells per column)
+ * spacing = pillar grid spacing in cells
+ * reach   = self supporting overhang distance in cells
+ * radius  = pillar radius in cells
+ * zspan   = layers a tip covers above itself
+ * land    = 1 to keep pillars that land on the part
+ * out     = output memory location (pillar records)
+ * max     = output memory size in bytes
+ * returns number of pillar records written
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 support_plan(
+    unsigned char *m, Uint32 s, Uint32 w, Uint32 layers, Uint32 width, Uint32 height,
+    Uint32 spacing, Uint32 reach, Uint32 radius, Uint32 zspan, Uint8 land, Uint32 out, Uint32 max)
+{
+    Uint32 n = width * height;
+    Uint8 *occ = m + w;
+    Uint8 *below = occ + n;
+    Uint8 *tmp = below + n;
+    Uint8 *seen = tmp + (width + reach * 2) * (height + reach * 2);
+    Uint32 *queue = (Uint32 *)(seen + n);
+    Uint16 *tips = (Uint16 *)(queue + n);
+    Uint32 cover;
+    struct planner pl = {
+        m + s, (n + 7) >> 3, width, height, radius,
+        occ, tips, m + out, m + out + max, 0
+    };
+
+    if (spacing < 1) spacing = 1;
+    // half the grid diagonal so grid tips leave no gaps between them
+    cover = (spacing * 181 + 255) >> 8;
+    memset(tips, 0, n * sizeof(Uint16));
+
+    for (Uint32 layer=1; layer<layers; layer++) {
+        unpack_layer(&pl, layer, occ);
+        unpack_layer(&pl, layer - 1, below);
+        // a tip stops covering a cell once the part leaves it. a later
+        // overhang there rests on nothing the tip holds up
+        for (Uint32 i=0; i<n; i++) {
+            if (!occ[i]) tips[i] = 0;
+        }
+        raster_morph(below, width, height, reach, reach, tmp, 1);
+        // overhang cells are part cells with no part below within reach
+        for (Uint32 i=0; i<n; i++) {
+            seen[i] = occ[i] && !below[i] ? 0 : 1;
+        }
+        for (Uint32 seed=0; seed<n; seed++) {
+            if (seen[seed]) continue;
+            // flood fill the island (4 connected)
+            Uint32 qn = 0;
+            Uint64 cx = 0, cy = 0;
+            Uint8 covered = 0;
+            queue[qn++] = seed;
+            seen[seed] = 1;
+            for (Uint32 q=0; q<qn; q++) {
+                Uint32 idx = queue[q];
+                Uint32 x = idx / height, y = idx % height;
+                cx += x;
+                cy += y;
+                if (tips[idx] && layer + 1 - tips[idx] <= zspan) covered = 1;
+                if (y > 0 && !seen[idx - 1]) { seen[idx - 1] = 1; queue[qn++] = idx - 1; }
+                if (y + 1 < height && !seen[idx + 1]) { seen[idx + 1] = 1; queue[qn++] = idx + 1; }
+                if (x > 0 && !seen[idx - height]) { seen[idx - height] = 1; queue[qn++] = idx - height; }
+                if (x + 1 < width && !seen[idx + height]) { seen[idx + height] = 1; queue[qn++] = idx + height; }
+            }
+            // grid candidates not yet covered by a tip
+            for (Uint32 q=0; q<qn; q++) {
+                Uint32 idx = queue[q];
+                Uint32 x = idx / height, y = idx % height;
+                if (x % spacing || y % spacing) continue;
+                if (tips[idx] && layer + 1 - tips[idx] <= zspan) continue;
+                if (trace_pillar(&pl, x, y, layer - 1, land)) {
+                    stamp_tip(&pl, x, y, cover, layer);
+                    covered = 1;
+                }
+            }
+            if (!covered) {
+                // uncovered island gets a pillar at the cell nearest its center
+                cx /= qn;
+                cy /= qn;
+                Uint32 best = queue[0];
+                Uint64 bestd = ~0ULL;
+                for (Uint32 q=0; q<qn; q++) {
+                    Uint32 idx = queue[q];
+                    Int64 dx = (Int64)(idx / height) - (Int64)cx;
+                    Int64 dy = (Int64)(idx % height) - (Int64)cy;
+                    Uint64 d = dx * dx + dy * dy;
+                    if (d < bestd) {
+                        bestd = d;
+                        best = idx;
+                    }
+                }
+                if (trace_pillar(&pl, best / height, best % height, layer - 1, land)) {
+                    stamp_tip(&pl, best / height, best % height, cover, layer);
+                }
+            }
+            // island edges out of reach of any grid tip
+            for (Uint32 q=0; q<qn; q++) {
+                Uint32 idx = queue[q];
+                if (tips[idx] && layer + 1 - tips[idx] <= zspan) continue;
+                if (trace_pillar(&pl, idx / height, idx % height, layer - 1, land)) {
+                    stamp_tip(&pl, idx / height, idx % height, cover, layer);
+                }
+            }
+        }
+    }
+
+    return pl.count;
 }
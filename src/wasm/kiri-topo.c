@@ -0,0 +1,862 @@
+#include <emscripten.h>
+#include <string.h>
+#include <math.h>
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+typedef unsigned char Uint8;
+typedef unsigned short Uint16;
+typedef unsigned int Uint32;
+typedef short Int16;
+typedef int Sint32;
+
+extern void reportf(float a, float b);
+extern void reporti(int a, int b);
+extern unsigned char __heap_base;
+
+// unrolled mesh triangle as produced by widget.getGeoVertices()
+struct tri {
+    float x0, y0, z0;
+    float x1, y1, z1;
+    float x2, y2, z2;
+};
+
+// topo grid. cells are column major (cell x,y at x * steps_y + y) and
+// sample the mesh at x = min_x + x * step, y = min_y + y * step. zero
+// cells are empty and read as the grid floor
+struct topo {
+    Uint32 steps_x;
+    Uint32 steps_y;
+    float min_x;
+    float min_y;
+    float step;
+    float floor; // lowest z kept in the grid
+};
+
+// xy bounds of triangles that raised at least one grid cell
+struct bounds {
+    float min_x;
+    float min_y;
+    float max_x;
+    float max_y;
+};
+
+// one tool profile cell: grid offset from the tool tip and the height
+// of the tool surface relative to the tip (zero or below)
+struct tcell {
+    Int16 dx;
+    Int16 dy;
+    float dz;
+};
+
+// parameters of one topo trace pass (all scan lines along one axis)
+struct trace {
+    double from;      // line extent along the axis in mm
+    double to;
+    double step;      // mm per step
+    double box_min;   // points outside the box along the axis are skipped
+    double box_max;
+    Uint32 axis;      // 0 = lines along x at fixed y, 1 = along y at fixed x
+    Uint32 density;   // grid cells per step
+    Uint32 curves;    // curves only: drop flat runs and steep walls
+    Uint32 reach;     // margin of the dilated grid in cells
+    Sint32 grid;      // grid index along the line at the first step
+    float leave;      // added to every point z
+    float flatness;   // slope and flat z tolerance
+    float maxangle;   // curves only: wall angle (degrees) that ends a line
+    float tab_height; // points below this are checked against tabs
+    float near;       // clip edge tolerance in mm
+};
+
+// one scan line: fixed coordinate in mm and grid index across the axis
+struct scan {
+    float at;
+    Sint32 grid;
+};
+
+// one output polyline: scan line index and points
+struct polyline {
+    Uint32 scan;
+    Uint32 count;
+};
+
+// one clip ring's crossings with the current scan line
+struct ring {
+    Uint32 group; // owning clip polygon (outer ring plus holes)
+    Uint32 hole;
+    Uint32 start; // first crossing in cross[]
+    Uint32 count;
+    Uint32 next;  // crossings below the current point
+    Uint32 nstart; // first near interval in nears[]
+    Uint32 ncount;
+};
+
+#define RING_MAX 4096
+#define CROSS_MAX 262144
+#define GROUP_MAX 1024
+
+struct ring rings[RING_MAX];
+float cross[CROSS_MAX];
+float nears[CROSS_MAX * 2];
+float group_z[GROUP_MAX];
+
+// edge coverage slop in cells so shared edges never leave cracks
+#define EDGE_EPS 1e-4f
+
+// profile columns at least this tall with concave heights dilate by a
+// monotone search, O((rows + cells) log rows) per column instead of a
+// pass per kernel cell.
+// CONCAVE_TOL absorbs profile rounding (mm)
+#ifdef __wasm_simd128__
+#define CONCAVE_MIN 96
+#else
+#define CONCAVE_MIN 8
+#endif
+#define CONCAVE_TOL 1e-5f
+
+/**
+ * returns the first memory location past static data and stack.
+ * callers pass this as the memory base pointer so the grid and
+ * buffers never overwrite module data
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 heap_base() {
+    return (Uint32)&__heap_base;
+}
+
+// raise cells j0..j1 of one column to z = za + zb * j where that is
+// above the current (or floor for empty) cell value
+static void raise_span(float *col, Sint32 j0, Sint32 j1, float za, float zb, float floor) {
+    Sint32 j = j0;
+#ifdef __wasm_simd128__
+    v128_t vf = wasm_f32x4_splat(floor);
+    v128_t va = wasm_f32x4_splat(za);
+    v128_t vb = wasm_f32x4_splat(zb);
+    v128_t vj = wasm_f32x4_make(j, j + 1, j + 2, j + 3);
+    v128_t v4 = wasm_f32x4_splat(4);
+    v128_t zero = wasm_f32x4_splat(0);
+    // z is evaluated per cell (not accumulated) to match the scalar build
+    for (; j + 3 <= j1; j += 4) {
+        v128_t vz = wasm_f32x4_add(va, wasm_f32x4_mul(vb, vj));
+        v128_t cur = wasm_v128_load(col + j);
+        v128_t eff = wasm_v128_bitselect(vf, cur, wasm_f32x4_eq(cur, zero));
+        v128_t up = wasm_f32x4_gt(vz, eff);
+        wasm_v128_store(col + j, wasm_v128_bitselect(vz, cur, up));
+        vj = wasm_f32x4_add(vj, v4);
+    }
+#endif
+    for (; j <= j1; j++) {
+        float z = za + zb * j;
+        float cur = col[j];
+        if (z > (cur != 0 ? cur : floor)) {
+            col[j] = z;
+        }
+    }
+}
+
+// rasterize one triangle into grid columns x0 to x1 - 1. the column
+// pointer is for column x0. returns 1 if any cell was raised
+static Uint32 raster_tri(struct tri *t, struct topo *g, float *grid, Sint32 x0, Sint32 x1) {
+    float ax = t->x0, ay = t->y0, az = t->z0;
+    float bx = t->x1, by = t->y1, bz = t->z1;
+    float cx = t->x2, cy = t->y2, cz = t->z2;
+    float zmax = fmaxf(az, fmaxf(bz, cz));
+    if (zmax <= g->floor) {
+        return 0;
+    }
+    // plane gradient. vertical faces are covered by their neighbours
+    float ux = bx - ax, uy = by - ay, uz = bz - az;
+    float vx = cx - ax, vy = cy - ay, vz = cz - az;
+    float det = ux * vy - uy * vx;
+    if (fabsf(det) < 1e-12f) {
+        return 0;
+    }
+    float dzdx = (uz * vy - uy * vz) / det;
+    float dzdy = (ux * vz - uz * vx) / det;
+    float zmin = fminf(az, fminf(bz, cz));
+    float step = g->step;
+    float inv = 1.0f / step;
+    // covered columns in grid units
+    float gx0 = (fminf(ax, fminf(bx, cx)) - g->min_x) * inv;
+    float gx1 = (fmaxf(ax, fmaxf(bx, cx)) - g->min_x) * inv;
+    Sint32 i0 = (Sint32)ceilf(gx0 - EDGE_EPS);
+    Sint32 i1 = (Sint32)floorf(gx1 + EDGE_EPS);
+    if (i0 < x0) i0 = x0;
+    if (i1 > x1 - 1) i1 = x1 - 1;
+    if (i0 > i1) {
+        return 0;
+    }
+    float px[3] = { ax, bx, cx };
+    float py[3] = { ay, by, cy };
+    Sint32 ymax = (Sint32)g->steps_y - 1;
+    Uint32 hit = 0;
+    for (Sint32 i = i0; i <= i1; i++) {
+        float x = g->min_x + i * step;
+        // y extent where the vertical line at x crosses the triangle
+        float lo = INFINITY, hi = -INFINITY;
+        for (Uint32 e = 0; e < 3; e++) {
+            float sx = px[e], sy = py[e];
+            float ex = px[(e + 1) % 3], ey = py[(e + 1) % 3];
+            float ex0 = fminf(sx, ex), ex1 = fmaxf(sx, ex);
+            if (x < ex0 - EDGE_EPS * step || x > ex1 + EDGE_EPS * step) {
+                continue;
+            }
+            float y0, y1;
+            if (ex1 - ex0 < 1e-9f) {
+                y0 = sy;
+                y1 = ey;
+            } else {
+                float f = (x - sx) / (ex - sx);
+                f = f < 0 ? 0 : f > 1 ? 1 : f;
+                y0 = y1 = sy + (ey - sy) * f;
+            }
+            lo = fminf(lo, fminf(y0, y1));
+            hi = fmaxf(hi, fmaxf(y0, y1));
+        }
+        if (lo > hi) {
+            continue;
+        }
+        Sint32 j0 = (Sint32)ceilf((lo - g->min_y) * inv - EDGE_EPS);
+        Sint32 j1 = (Sint32)floorf((hi - g->min_y) * inv + EDGE_EPS);
+        if (j0 < 0) j0 = 0;
+        if (j1 > ymax) j1 = ymax;
+        if (j0 > j1) {
+            continue;
+        }
+        // plane z along this column as za + zb * j, clamped at the ends
+        // so edge slop never extrapolates past the triangle
+        float za = az + dzdx * (x - ax) + dzdy * (g->min_y - ay);
+        float zb = dzdy * step;
+        float *col = grid + (i - x0) * g->steps_y;
+        float z0 = za + zb * j0, z1 = za + zb * j1;
+        if (z0 < zmin || z0 > zmax || z1 < zmin || z1 > zmax) {
+            for (Sint32 j = j0; j <= j1; j++) {
+                float z = fminf(fmaxf(za + zb * j, zmin), zmax);
+                float cur = col[j];
+                if (z > (cur != 0 ? cur : g->floor)) {
+                    col[j] = z;
+                }
+            }
+        } else {
+            raise_span(col, j0, j1, za, zb, g->floor);
+        }
+        hit = 1;
+    }
+    return hit;
+}
+
+/**
+ * top down z-buffer raster of a triangle mesh into the columns x0 to
+ * x1 - 1 of a topo grid. each cell keeps the highest surface above it.
+ * column tiles are independent so callers split a grid across threads
+ * and every tile matches the single pass result
+ *
+ * m     = memory base pointer
+ * v     = triangle memory location (count * 9 floats, x,y,z unrolled)
+ * count = number of triangles
+ * g     = grid description location (struct topo)
+ * o     = grid tile memory location ((x1 - x0) * steps_y floats)
+ * x0    = first grid column of the tile
+ * x1    = grid column past the tile
+ * b     = bounds output location (struct bounds) of raising triangles
+ *
+ * returns the number of triangles that raised a cell
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 topo_raster(
+    Uint8 *m, Uint32 v, Uint32 count, Uint32 g, Uint32 o,
+    Uint32 x0, Uint32 x1, Uint32 b)
+{
+    struct tri *tris = (struct tri *)(m + v);
+    struct topo *topo = (struct topo *)(m + g);
+    struct bounds *box = (struct bounds *)(m + b);
+    float *grid = (float *)(m + o);
+    float step = topo->step;
+    // tile edges in mm with the same slop used per column
+    float tx0 = topo->min_x + ((float)x0 - EDGE_EPS) * step;
+    float tx1 = topo->min_x + ((float)x1 - 1 + EDGE_EPS) * step;
+    Uint32 raised = 0;
+    box->min_x = box->min_y = INFINITY;
+    box->max_x = box->max_y = -INFINITY;
+    if (x1 > topo->steps_x) {
+        x1 = topo->steps_x;
+    }
+    for (Uint32 i = 0; i < count; i++) {
+        struct tri *t = &tris[i];
+        float minx = fminf(t->x0, fminf(t->x1, t->x2));
+        float maxx = fmaxf(t->x0, fmaxf(t->x1, t->x2));
+        if (maxx < tx0 || minx > tx1) {
+            continue;
+        }
+        if (raster_tri(t, topo, grid, (Sint32)x0, (Sint32)x1)) {
+            float miny = fminf(t->y0, fminf(t->y1, t->y2));
+            float maxy = fmaxf(t->y0, fmaxf(t->y1, t->y2));
+            box->min_x = fminf(box->min_x, minx);
+            box->max_x = fmaxf(box->max_x, maxx);
+            box->min_y = fminf(box->min_y, miny);
+            box->max_y = fmaxf(box->max_y, maxy);
+            raised++;
+        }
+    }
+    return raised;
+}
+
+// dst[i] = max(dst[i], src[i] + add) for n cells
+static void max_into(float *dst, float *src, Uint32 n, float add) {
+    Uint32 i = 0;
+#ifdef __wasm_simd128__
+    v128_t va = wasm_f32x4_splat(add);
+    for (; i + 4 <= n; i += 4) {
+        v128_t v = wasm_f32x4_add(wasm_v128_load(src + i), va);
+        wasm_v128_store(dst + i, wasm_f32x4_max(wasm_v128_load(dst + i), v));
+    }
+#endif
+    for (; i < n; i++) {
+        float v = src[i] + add;
+        if (v > dst[i]) {
+            dst[i] = v;
+        }
+    }
+}
+
+// out[y] = max(src[y .. y + len - 1]) for n cells using block prefix
+// and suffix maxima (constant work per cell for any window length)
+static void window_max(float *out, float *src, Uint32 n, Uint32 len, float *pre, float *suf) {
+    Uint32 span = n + len - 1;
+    for (Uint32 i = 0; i < span; i++) {
+        pre[i] = (i % len) ? fmaxf(pre[i - 1], src[i]) : src[i];
+    }
+    for (Uint32 i = span; i-- > 0; ) {
+        suf[i] = (i + 1 == span || (i + 1) % len == 0) ? src[i] : fmaxf(suf[i + 1], src[i]);
+    }
+    for (Uint32 y = 0; y < n; y++) {
+        out[y] = fmaxf(suf[y], pre[y + len - 1]);
+    }
+}
+
+// out[y] = max over k < len of src[y + k] + dz[k] for rows y0 to y1 - 1
+// with the best y + k searched in j0 to j1. for a kernel concave in k
+// the best y + k never moves back as y grows, so the rows above the
+// middle row search up to its best and the rows below from it on
+static void concave_rows(
+    float *out, float *src, float *dz, Uint32 len,
+    Uint32 y0, Uint32 y1, Uint32 j0, Uint32 j1)
+{
+    while (y0 < y1) {
+        Uint32 ym = (y0 + y1) / 2;
+        Uint32 lo = j0 > ym ? j0 : ym;
+        Uint32 hi = j1 < ym + len - 1 ? j1 : ym + len - 1;
+        Uint32 best = lo;
+        float bv = -INFINITY;
+        for (Uint32 j = lo; j <= hi; j++) {
+            float v = src[j] + dz[j - ym];
+            if (v > bv) {
+                bv = v;
+                best = j;
+            }
+        }
+        out[ym] = bv;
+        concave_rows(out, src, dz, len, y0, ym, j0, best);
+        y0 = ym + 1;
+        j0 = best;
+    }
+}
+
+// true when kernel cells are contiguous in dy and their dz is concave
+// (ball and taper columns). their dz is copied to dz
+static Uint32 concave_column(struct tcell *kern, Uint32 n, float *dz) {
+    for (Uint32 k = 0; k < n; k++) {
+        if (kern[k].dy != kern[0].dy + (Sint32)k) {
+            return 0;
+        }
+        dz[k] = kern[k].dz;
+    }
+    for (Uint32 k = 1; k + 1 < n; k++) {
+        if (dz[k - 1] + dz[k + 1] > dz[k] * 2 + CONCAVE_TOL) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// order profile cells by dx then dy
+static void sort_cells(struct tcell *c, Uint32 count) {
+    for (Uint32 i = 1; i < count; i++) {
+        struct tcell t = c[i];
+        Uint32 j = i;
+        while (j > 0 && (c[j - 1].dx > t.dx || (c[j - 1].dx == t.dx && c[j - 1].dy > t.dy))) {
+            c[j] = c[j - 1];
+            j--;
+        }
+        c[j] = t;
+    }
+}
+
+// true when the profile column at dx holds exactly the kernel cells
+static Uint32 same_column(struct tcell *c, Uint32 count, struct tcell *kern, Uint32 n, Sint32 dx) {
+    Uint32 lo = 0, hi = count;
+    while (lo < hi) {
+        Uint32 mid = (lo + hi) / 2;
+        if (c[mid].dx < dx) lo = mid + 1; else hi = mid;
+    }
+    if (lo + n > count || (lo + n < count && c[lo + n].dx == dx)) {
+        return 0;
+    }
+    for (Uint32 k = 0; k < n; k++) {
+        if (c[lo + k].dx != dx || c[lo + k].dy != kern[k].dy || c[lo + k].dz != kern[k].dz) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * scratch bytes needed by topo_dilate() for a grid and a profile
+ * reaching at most reach cells from the tip
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 dilate_size(Uint32 steps_x, Uint32 steps_y, Uint32 reach, Uint32 count) {
+    Uint32 px = steps_x + reach * 4;
+    Uint32 py = steps_y + reach * 4;
+    return (px * py + px * (steps_y + reach * 2) + py * 2) * 4 + count * sizeof(struct tcell);
+}
+
+/**
+ * dilate a topo grid by a tool profile so every cell holds the tip z
+ * of the tool resting on the surface there (Probe.toolAtZ for the whole
+ * grid). cells outside the grid and empty cells read as the floor.
+ * the output has a margin of reach cells on every side so probes just
+ * off the grid are lookups too. probes past the margin are the floor
+ *
+ * the profile is split into one column kernel per dx. each column is
+ * dilated along y once per distinct kernel and the kernel results are
+ * shifted into the output by dx. flat kernels (end mills) use a sliding
+ * window max. tall concave kernels (ball and taper mills) use a monotone
+ * divide and conquer search, O(log rows) per output cell. others take a simd max per
+ * kernel cell. mirrored columns of symmetric tools share one pass
+ *
+ * m     = memory base pointer
+ * g     = grid description location (struct topo)
+ * i     = input grid location (steps_x * steps_y floats)
+ * o     = output location ((steps_x + reach * 2) * (steps_y + reach * 2)
+ *         floats, cell x,y at (x + reach) * (steps_y + reach * 2) + y + reach)
+ * p     = profile location (count struct tcell)
+ * count = profile cells
+ * reach = largest |dx| or |dy| in the profile
+ * s     = scratch location (dilate_size() bytes)
+ */
+EMSCRIPTEN_KEEPALIVE
+void topo_dilate(
+    Uint8 *m, Uint32 g, Uint32 i, Uint32 o, Uint32 p,
+    Uint32 count, Uint32 reach, Uint32 s)
+{
+    struct topo *topo = (struct topo *)(m + g);
+    float *in = (float *)(m + i);
+    float *out = (float *)(m + o);
+    Uint32 sx = topo->steps_x;
+    Uint32 sy = topo->steps_y;
+    // output with margin, then padded input so no kernel reads past it
+    Uint32 ox = sx + reach * 2;
+    Uint32 oy = sy + reach * 2;
+    Uint32 px = ox + reach * 2;
+    Uint32 py = oy + reach * 2;
+    Uint32 edge = reach * 2;
+    float floor = topo->floor;
+    float *pad = (float *)(m + s);
+    float *scr = pad + px * py;
+    float *pre = scr + px * oy;
+    float *suf = pre + py;
+    struct tcell *cells = (struct tcell *)(suf + py);
+
+    // floor padded copy of the grid with empty cells at the floor
+    for (Uint32 x = 0; x < px; x++) {
+        float *col = pad + x * py;
+        if (x < edge || x >= sx + edge) {
+            for (Uint32 y = 0; y < py; y++) col[y] = floor;
+            continue;
+        }
+        float *src = in + (x - edge) * sy;
+        for (Uint32 y = 0; y < edge; y++) col[y] = floor;
+        for (Uint32 y = 0; y < sy; y++) col[y + edge] = src[y] != 0 ? src[y] : floor;
+        for (Uint32 y = sy + edge; y < py; y++) col[y] = floor;
+    }
+    for (Uint32 k = 0; k < ox * oy; k++) {
+        out[k] = floor;
+    }
+
+    memcpy(cells, m + p, count * sizeof(struct tcell));
+    sort_cells(cells, count);
+
+    for (Uint32 k0 = 0, k1; k0 < count; k0 = k1) {
+        Sint32 dx = cells[k0].dx;
+        for (k1 = k0; k1 < count && cells[k1].dx == dx; k1++);
+        Uint32 n = k1 - k0;
+        struct tcell *kern = cells + k0;
+        // mirrored columns that match share the pass of the negative one
+        Uint32 mirror = dx != 0 && same_column(cells, count, kern, n, -dx);
+        if (mirror && dx > 0) {
+            continue;
+        }
+        Uint32 flat = 1;
+        for (Uint32 k = 1; flat && k < n; k++) {
+            flat = kern[k].dz == kern[0].dz && kern[k].dy == kern[k - 1].dy + 1;
+        }
+        // pre holds the kernel heights. window_max() only runs when flat
+        Uint32 concave = !flat && n >= CONCAVE_MIN && concave_column(kern, n, pre);
+        // dilate every padded column along y by this kernel
+        for (Uint32 x = 0; x < px; x++) {
+            float *col = pad + x * py + reach;
+            float *dst = scr + x * oy;
+            if (flat) {
+                window_max(dst, col + kern[0].dy, oy, n, pre, suf);
+                if (kern[0].dz != 0) {
+                    for (Uint32 y = 0; y < oy; y++) dst[y] += kern[0].dz;
+                }
+            } else if (concave) {
+                concave_rows(dst, col + kern[0].dy, pre, n, 0, oy, 0, oy + n - 1);
+            } else {
+                for (Uint32 y = 0; y < oy; y++) dst[y] = -INFINITY;
+                for (Uint32 k = 0; k < n; k++) {
+                    max_into(dst, col + kern[k].dy, oy, kern[k].dz);
+                }
+            }
+        }
+        // shift into the output by dx (and -dx when mirrored)
+        for (Uint32 x = 0; x < ox; x++) {
+            max_into(out + x * oy, scr + (x + reach + dx) * oy, oy, 0);
+            if (mirror) {
+                max_into(out + x * oy, scr + (x + reach - dx) * oy, oy, 0);
+            }
+        }
+    }
+}
+
+// narrow [lo,hi] to the a where lo <= k * a + c <= hi holds
+static void solve_range(float k, float c, float lo, float hi, float *a0, float *a1) {
+    if (k == 0) {
+        if (c < lo || c > hi) *a0 = INFINITY;
+        return;
+    }
+    float r0 = (lo - c) / k, r1 = (hi - c) / k;
+    *a0 = fmaxf(*a0, fminf(r0, r1));
+    *a1 = fminf(*a1, fmaxf(r0, r1));
+}
+
+// interval along the scan line within near of segment 1-2 (a = along
+// the axis, b = across). returns 0 when the line misses
+static Uint32 near_range(float a1, float b1, float a2, float b2, float at, float near, float *lo, float *hi) {
+    float n0 = INFINITY, n1 = -INFINITY;
+    float db = at - b1;
+    if (fabsf(db) <= near) {
+        float w = sqrtf(near * near - db * db);
+        n0 = fminf(n0, a1 - w);
+        n1 = fmaxf(n1, a1 + w);
+    }
+    db = at - b2;
+    if (fabsf(db) <= near) {
+        float w = sqrtf(near * near - db * db);
+        n0 = fminf(n0, a2 - w);
+        n1 = fmaxf(n1, a2 + w);
+    }
+    // band beside the segment: projection in [0,1], offset within near
+    float ua = a2 - a1, ub = b2 - b1;
+    float ll = ua * ua + ub * ub;
+    if (ll > 0) {
+        float len = sqrtf(ll);
+        float r0 = -INFINITY, r1 = INFINITY;
+        solve_range(ua / ll, (at - b1) * ub / ll - a1 * ua / ll, 0, 1, &r0, &r1);
+        solve_range(ub / len, -(at - b1) * ua / len - a1 * ub / len, -near, near, &r0, &r1);
+        if (r0 <= r1) {
+            n0 = fminf(n0, r0);
+            n1 = fmaxf(n1, r1);
+        }
+    }
+    *lo = n0;
+    *hi = n1;
+    return n0 <= n1;
+}
+
+// clip polygons are streamed as Uint32 groups, then per group float z,
+// Uint32 rings, and per ring Uint32 points followed by x,y floats. the
+// first ring of a group is the outer, the rest are holes. ring crossings
+// with the scan line (sorted along the axis) and near edge intervals are
+// collected starting at ring r0. returns the ring count or 0xffffffff
+// when limits overflow
+static Uint32 clip_scan(
+    Uint8 *c, Uint32 axis, float at, float near,
+    Uint32 r0, Uint32 *c0, Uint32 *n0, Uint32 *groups)
+{
+    Uint32 *u = (Uint32 *)c;
+    Uint32 ng = *u++;
+    Uint32 nr = r0;
+    Uint32 nc = *c0;
+    Uint32 nn = *n0;
+    *groups = ng;
+    for (Uint32 gi = 0; gi < ng; gi++) {
+        float *f = (float *)u;
+        if (gi >= GROUP_MAX) return 0xffffffff;
+        group_z[gi] = *f++;
+        u = (Uint32 *)f;
+        Uint32 count = *u++;
+        for (Uint32 ri = 0; ri < count; ri++) {
+            Uint32 points = *u++;
+            float *pt = (float *)u;
+            if (nr >= RING_MAX) return 0xffffffff;
+            struct ring *r = &rings[nr++];
+            r->group = gi;
+            r->hole = ri > 0;
+            r->start = nc;
+            r->next = 0;
+            r->nstart = nn;
+            // same crossing rule as point.inPolygon() with the ray cast
+            // along the scan axis
+            for (Uint32 k = 0; k < points; k++) {
+                float *p1 = pt + k * 2;
+                float *p2 = pt + ((k + 1) % points) * 2;
+                float a1 = axis ? p1[1] : p1[0], b1 = axis ? p1[0] : p1[1];
+                float a2 = axis ? p2[1] : p2[0], b2 = axis ? p2[0] : p2[1];
+                if (fminf(b1, b2) <= at + near && fmaxf(b1, b2) >= at - near) {
+                    if (nn >= CROSS_MAX) return 0xffffffff;
+                    nn += near_range(a1, b1, a2, b2, at, near, &nears[nn * 2], &nears[nn * 2 + 1]);
+                }
+                if ((b1 >= at) != (b2 >= at)) {
+                    if (nc >= CROSS_MAX) return 0xffffffff;
+                    float v = (a2 - a1) * (at - b1) / (b2 - b1) + a1;
+                    Uint32 j = nc++;
+                    while (j > r->start && cross[j - 1] > v) {
+                        cross[j] = cross[j - 1];
+                        j--;
+                    }
+                    cross[j] = v;
+                }
+            }
+            r->count = nc - r->start;
+            r->ncount = nn - r->nstart;
+            u = (Uint32 *)(pt + points * 2);
+        }
+    }
+    *c0 = nc;
+    *n0 = nn;
+    return nr - r0;
+}
+
+// advance the ring crossing cursors to a and count the groups that
+// contain a. points within near of an outer edge are inside and within
+// near of a hole edge are not in the hole (as point.isInPolygon()).
+// when in is given it receives 1 per containing group
+static Uint32 clip_inside(Uint32 r0, Uint32 nr, Uint32 ng, float a, Uint8 *in) {
+    Uint8 inside[GROUP_MAX];
+    Uint8 hole[GROUP_MAX];
+    for (Uint32 g = 0; g < ng; g++) inside[g] = hole[g] = 0;
+    for (Uint32 k = r0; k < r0 + nr; k++) {
+        struct ring *r = &rings[k];
+        float *c = cross + r->start;
+        while (r->next < r->count && c[r->next] < a) r->next++;
+        // ray toward +axis crosses the edges at or past a
+        Uint32 odd = (r->count - r->next) & 1;
+        Uint32 close = 0;
+        for (Uint32 k = 0; !close && k < r->ncount; k++) {
+            float *n = nears + (r->nstart + k) * 2;
+            close = a >= n[0] && a <= n[1];
+        }
+        if (r->hole) {
+            if (odd && !close) hole[r->group] = 1;
+        } else if (odd || close) {
+            inside[r->group] = 1;
+        }
+    }
+    Uint32 count = 0;
+    for (Uint32 g = 0; g < ng; g++) {
+        Uint32 ok = inside[g] && !hole[g];
+        if (in) in[g] = ok;
+        count += ok;
+    }
+    return count;
+}
+
+// polyline builder state for one scan line (Trace push_point/end_poly)
+struct tracer {
+    struct trace *tr;
+    struct polyline *lines;
+    float *points;
+    Uint32 line_max;
+    Uint32 point_max;
+    Uint32 nlines;
+    Uint32 npoints;
+    Uint32 scan;
+    Uint32 start;      // first point of the open polyline
+    Uint32 has_latent;
+    Uint32 has_last;
+    Uint32 has_slope;
+    Uint32 overflow;
+    double latent[3];
+    double last[3];
+    double slope;
+};
+
+static void trace_push(struct tracer *t, double *p) {
+    if (t->npoints >= t->point_max) {
+        t->overflow = 1;
+        return;
+    }
+    float *o = t->points + t->npoints++ * 3;
+    o[0] = p[0];
+    o[1] = p[1];
+    o[2] = p[2];
+}
+
+static void trace_end(struct tracer *t, double *p) {
+    if (t->has_latent) {
+        trace_push(t, t->latent);
+    }
+    Uint32 count = t->npoints - t->start;
+    if (count > 1 && t->nlines < t->line_max) {
+        t->lines[t->nlines].scan = t->scan;
+        t->lines[t->nlines].count = count;
+        t->nlines++;
+        t->start = t->npoints;
+    } else {
+        if (count > 1) t->overflow = 1;
+        t->npoints = t->start;
+    }
+    t->has_last = t->has_latent = t->has_slope = 0;
+    if (p) {
+        trace_push(t, p);
+        memcpy(t->last, p, sizeof(t->last));
+        t->has_last = 1;
+    }
+}
+
+static void trace_point(struct tracer *t, double x, double y, double z) {
+    struct trace *tr = t->tr;
+    double p[3] = { x, y, z };
+    if (t->has_last) {
+        double *l = t->last;
+        double dl = (x - l[0]) != 0 ? (x - l[0]) : (y - l[1]);
+        double dz = z - l[2];
+        double slope = atan2(dz, dl);
+        if (tr->curves && fabs(dz) < tr->flatness) {
+            trace_end(t, p);
+        } else if (t->has_slope && fabs(t->slope - slope) < tr->flatness) {
+            memcpy(t->latent, p, sizeof(p));
+            t->has_latent = 1;
+        } else {
+            if (t->has_latent) {
+                trace_push(t, t->latent);
+                t->has_latent = 0;
+            }
+            if (tr->curves) {
+                double dv = tr->axis ? fabs(l[1] - y) : fabs(l[0] - x);
+                double angle = atan2(fabs(dz), dv) * (180 / M_PI);
+                if (angle > tr->maxangle) {
+                    trace_end(t, 0);
+                }
+            }
+            trace_push(t, p);
+        }
+        t->slope = slope;
+        t->has_slope = 1;
+    } else {
+        trace_push(t, p);
+    }
+    memcpy(t->last, p, sizeof(p));
+    t->has_last = 1;
+}
+
+/**
+ * trace topo toolpaths for every scan line along one axis (Trace
+ * crossX/crossY) against a grid dilated by topo_dilate(). points are
+ * the tool tip at each step, raised to tabs and split where they leave
+ * the clip polygons, then thinned and split with the slope, flatness
+ * and curves only rules of the js tracer.
+ *
+ * m      = memory base pointer
+ * g      = grid description location (struct topo)
+ * d      = dilated grid location (see topo_dilate)
+ * t      = trace parameters location (struct trace)
+ * s      = scan lines location (count struct scan)
+ * count  = scan lines
+ * c      = clip to polygons location (0 = none)
+ * b      = tab polygons location (0 = none) with z as tab tops
+ * l      = polyline output location (struct polyline)
+ * lmax   = polyline output capacity
+ * p      = point output location (x,y,z floats)
+ * pmax   = point output capacity
+ *
+ * returns the number of polylines written (points follow in order) or
+ * 0xffffffff when an output or clip limit was exceeded
+ */
+EMSCRIPTEN_KEEPALIVE
+Uint32 topo_trace(
+    Uint8 *m, Uint32 g, Uint32 d, Uint32 t, Uint32 s, Uint32 count,
+    Uint32 c, Uint32 b, Uint32 l, Uint32 lmax, Uint32 p, Uint32 pmax)
+{
+    struct topo *topo = (struct topo *)(m + g);
+    struct trace *tr = (struct trace *)(m + t);
+    struct scan *scans = (struct scan *)(m + s);
+    float *grid = (float *)(m + d);
+    Sint32 reach = (Sint32)tr->reach;
+    Sint32 gw = (Sint32)topo->steps_x + reach * 2;
+    Sint32 gh = (Sint32)topo->steps_y + reach * 2;
+    Uint8 tab_in[GROUP_MAX];
+    struct tracer tc = {
+        .tr = tr,
+        .lines = (struct polyline *)(m + l),
+        .points = (float *)(m + p),
+        .line_max = lmax,
+        .point_max = pmax
+    };
+    for (Uint32 si = 0; si < count; si++) {
+        struct scan *sc = &scans[si];
+        Uint32 nc = 0, nn = 0, clip_groups = 0, tab_groups = 0;
+        Uint32 clip_rings = 0, tab_rings = 0;
+        if (c) {
+            clip_rings = clip_scan(m + c, tr->axis, sc->at, tr->near, 0, &nc, &nn, &clip_groups);
+            if (clip_rings == 0xffffffff) return 0xffffffff;
+        }
+        if (b) {
+            tab_rings = clip_scan(m + b, tr->axis, sc->at, tr->near, clip_rings, &nc, &nn, &tab_groups);
+            if (tab_rings == 0xffffffff) return 0xffffffff;
+        }
+        tc.scan = si;
+        tc.start = tc.npoints;
+        tc.has_last = tc.has_latent = tc.has_slope = 0;
+        Sint32 gi = tr->grid;
+        // js accumulates the position in doubles
+        for (double a = tr->from; a < tr->to; a += tr->step, gi += tr->density) {
+            if (a < tr->box_min || a > tr->box_max) {
+                continue;
+            }
+            Sint32 gx = tr->axis ? sc->grid : gi;
+            Sint32 gy = tr->axis ? gi : sc->grid;
+            Sint32 dx = gx + reach, dy = gy + reach;
+            float tv = (dx < 0 || dy < 0 || dx >= gw || dy >= gh) ?
+                topo->floor : grid[dx * gh + dy];
+            // raise to the tab top when inside every tab (as Trace.inClip)
+            if (tab_groups && tv < tr->tab_height) {
+                clip_inside(clip_rings, tab_rings, tab_groups, a, tab_in);
+                Uint32 ok = 1;
+                for (Uint32 k = 0; ok && k < tab_groups; k++) {
+                    ok = tab_in[k] && tv <= group_z[k];
+                }
+                if (ok) {
+                    tv = group_z[tab_groups - 1];
+                }
+            }
+            // leaving the clip polygons ends the polyline
+            if (clip_groups && clip_inside(0, clip_rings, clip_groups, a, 0) != clip_groups) {
+                trace_end(&tc, 0);
+                continue;
+            }
+            double x = tr->axis ? sc->at : a;
+            double y = tr->axis ? a : sc->at;
+            trace_point(&tc, x, y, (double)tv + tr->leave);
+        }
+        trace_end(&tc, 0);
+        if (tc.overflow) {
+            return 0xffffffff;
+        }
+    }
+    return tc.nlines;
+}
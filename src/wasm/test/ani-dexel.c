@@ -0,0 +1,111 @@
+/**
+ * checks dexel_cut() against an exact per-ray reference. rays are cut
+ * into more spans than fit inline so they move to pool blocks, then
+ * past a block and with the pool exhausted. cutting them back returns
+ * every block to the pool. removed material must never
+ * come back: every sample point cut in the reference must be empty in
+ * the dexel stock. material may only go missing where spans were
+ * dropped for lack of room
+ *
+ * cc -O2 -I test -o test/ani-dexel test/ani-dexel.c -lm
+ */
+
+#include "../kiri-ani.c"
+#include <stdio.h>
+#include <stdlib.h>
+
+unsigned char __heap_base;
+void reportf(float a, float b) {}
+void reporti(int a, int b) {}
+
+#define W 40
+#define H 40
+#define SZ 20.0f
+#define SAMPLES 2000
+
+static unsigned char mem[1 << 22];
+static Uint8 cut[W * H][SAMPLES];
+
+// is z inside the material of ray r
+static int solid(Uint32 r, float z) {
+    float *sp = ray_spans(r);
+    for (Uint32 s=0; s<dex.count[r]; s++) {
+        if (z > sp[s * 2] && z < sp[s * 2 + 1]) return 1;
+    }
+    return 0;
+}
+
+static float sample(Uint32 i) {
+    return -SZ / 2 + (i + 0.5f) * SZ / SAMPLES;
+}
+
+static void cut_ray(Uint32 x, Uint32 y, float lo, float hi) {
+    dexel_cut(x, y, lo, hi);
+    for (Uint32 i=0; i<SAMPLES; i++) {
+        float z = sample(i);
+        if (z > lo && z < hi) cut[x * H + y][i] = 1;
+    }
+}
+
+// cut slots evenly spaced gaps of random width into ray x,y
+static void slot_ray(Uint32 x, Uint32 y, Uint32 slots) {
+    for (Uint32 k=0; k<slots; k++) {
+        float z = -SZ / 2 + (k + 0.5f) * SZ / slots;
+        float w = SZ / slots * (0.2f + 0.3f * rand() / RAND_MAX);
+        cut_ray(x, y, z - w / 2, z + w / 2);
+    }
+}
+
+// compare rays from..to with the reference. counts samples cut in the
+// reference that hold material (re-added) and the reverse (dropped)
+static void compare(Uint32 from, Uint32 to, Uint32 *readded, Uint32 *dropped) {
+    *readded = *dropped = 0;
+    for (Uint32 r=from; r<to; r++)
+    for (Uint32 i=0; i<SAMPLES; i++) {
+        int have = solid(r, sample(i));
+        if (cut[r][i] && have) (*readded)++;
+        if (!cut[r][i] && !have) (*dropped)++;
+    }
+}
+
+int main() {
+    int fails = 0;
+    Uint32 readded, dropped;
+    srand(3);
+    dexel_init(mem, 0, W, H, 8, W, H, SZ);
+
+    // a pool block holds every span
+    for (Uint32 r=0; r<20; r++) slot_ray(0, r, 12);
+    compare(0, 20, &readded, &dropped);
+    printf("pooled   re-added %6u dropped %6u\n", readded, dropped);
+    fails += readded || dropped || dex.count[0] != 13;
+
+    // more spans than a block holds
+    for (Uint32 r=20; r<40; r++) slot_ray(0, r, 40);
+    compare(20, 40, &readded, &dropped);
+    printf("full     re-added %6u dropped %6u\n", readded, dropped);
+    fails += readded || dex.count[20] != DEXEL_MORE;
+
+    // the pool runs out
+    for (Uint32 x=1; x<W; x++)
+    for (Uint32 y=0; y<H; y++) slot_ray(x, y, 8);
+    compare(H, W * H, &readded, &dropped);
+    printf("no pool  re-added %6u dropped %6u\n", readded, dropped);
+    fails += readded || *dex.free != ~0u;
+
+    // rays back under DEXEL_SPANS return their blocks
+    for (Uint32 x=0; x<W; x++)
+    for (Uint32 y=0; y<H; y++) cut_ray(x, y, -SZ, SZ * 0.45f);
+    compare(0, W * H, &readded, &dropped);
+    Uint32 pooled = 0, free = 0;
+    for (Uint32 r=0; r<W*H; r++) pooled += dex.count[r] > DEXEL_SPANS;
+    for (Uint32 b=*dex.free; b!=~0u && free<=dex.blocks; free++) {
+        memcpy(&b, dex.more + b * DEXEL_MORE * 2, 4);
+    }
+    printf("recut    re-added %6u pooled %u free blocks %u of %u\n",
+        readded, pooled, free, dex.blocks);
+    fails += readded || pooled || free != dex.blocks;
+
+    printf("%s\n", fails ? "FAIL" : "ok");
+    return fails != 0;
+}
@@ -0,0 +1,205 @@
+/**
+ * compares the stock_moves() swept envelope against dense stepping of
+ * the same tool profile. convex profiles (flat, ball, taper) must sweep
+ * within a small fraction of a cell of the continuous reference. they
+ * may leave a little more stock than it where the quarter cell radial
+ * table is coarse for steep walls (ball rim) but may not cut deeper.
+ * non-convex profiles must fall back to grid stepping which never cuts
+ * below dense stamping of the same cells. stepping can miss a rim cell
+ * the denser stamps reach so only overcut is checked there. the radial
+ * table may not dip below the profile cells near any radius. bins with
+ * no cell read between their neighbors, not as zero
+ *
+ * cc -O2 -I test -o test/ani-sweep test/ani-sweep.c -lm
+ */
+
+#include "../kiri-ani.c"
+#include <stdio.h>
+#include <stdlib.h>
+
+unsigned char __heap_base;
+void reportf(float a, float b) {}
+void reporti(int a, int b) {}
+
+#define GW 160
+#define GH 120
+#define STEP 0.1f
+#define TOP 5.0f
+
+static unsigned char mem[1 << 22];
+static float ref[GW * GH];
+
+enum { FLAT, BALL, TAPER, CONCAVE, STEPPED };
+static const char *names[] = { "flat", "ball", "taper", "concave", "stepped" };
+
+// tool surface height above the tip at r mm from the axis
+static float height(int kind, float r, float rad) {
+    switch (kind) {
+        case BALL: return rad - sqrtf(fmaxf(0, rad * rad - r * r));
+        case TAPER: return r * 0.5f;
+        case CONCAVE: return sqrtf(r * rad) * 0.4f;
+        // ball with a raised shoulder. the ball part gives a long hull
+        case STEPPED: return rad - sqrtf(fmaxf(0, rad * rad - r * r)) + (r < rad * 0.6f ? 0 : 0.3f);
+    }
+    return 0;
+}
+
+// profile cells the way Tool.generateProfile() lays them out
+static Uint32 profile(int kind, float rad, struct tcell *c, Uint32 *mid) {
+    int pix = (int)(rad * 2 / STEP) + 1, ctr = pix / 2;
+    Uint32 n = 0;
+    for (int x=0; x<pix; x++)
+    for (int y=0; y<pix; y++) {
+        float r = sqrtf((float)((x - ctr) * (x - ctr) + (y - ctr) * (y - ctr))) * STEP;
+        if (r > rad) continue;
+        c[n++] = (struct tcell){ x, y, -height(kind, r, rad) };
+    }
+    *mid = ctr;
+    return n;
+}
+
+// profile cell heights by radius in cells, sorted and deduplicated
+static float prof_r[4096], prof_h[4096];
+static Uint32 prof_n;
+
+static int by_radius(const void *a, const void *b) {
+    float d = ((const float *)a)[0] - ((const float *)b)[0];
+    return d < 0 ? -1 : d > 0;
+}
+
+static void prof_init(struct tcell *c, Uint32 count, Uint32 mid) {
+    static float pair[8192][2];
+    for (Uint32 i=0; i<count; i++) {
+        float dx = (float)c[i].dx - mid, dy = (float)c[i].dy - mid;
+        pair[i][0] = sqrtf(dx * dx + dy * dy);
+        pair[i][1] = -c[i].dz;
+    }
+    qsort(pair, count, sizeof(pair[0]), by_radius);
+    prof_n = 0;
+    for (Uint32 i=0; i<count; i++) {
+        if (prof_n && pair[i][0] - prof_r[prof_n - 1] < 1e-4f) continue;
+        prof_r[prof_n] = pair[i][0];
+        prof_h[prof_n++] = pair[i][1];
+    }
+}
+
+// profile height between cell radii by linear interpolation
+static float prof_at(float r) {
+    if (r <= prof_r[0]) return prof_h[0];
+    for (Uint32 k=1; k<prof_n; k++) {
+        if (r <= prof_r[k]) {
+            float f = (r - prof_r[k - 1]) / (prof_r[k] - prof_r[k - 1]);
+            return prof_h[k - 1] + (prof_h[k] - prof_h[k - 1]) * f;
+        }
+    }
+    return prof_h[prof_n - 1];
+}
+
+// deepest the radial table sits below the lowest profile cell within a
+// cell of each bin radius
+static float radial_under(struct tcell *c, Uint32 count, Uint32 mid) {
+    float worst = 0;
+    for (Uint32 b=0; b<radial_len; b++) {
+        float r = (float)b / RADIAL_BINS, low = 1e30f;
+        for (Uint32 i=0; i<count; i++) {
+            float dx = (float)c[i].dx - mid, dy = (float)c[i].dy - mid;
+            if (fabsf(sqrtf(dx * dx + dy * dy) - r) <= 1 && -c[i].dz < low) low = -c[i].dz;
+        }
+        if (low < 1e30f && low - radial[b] > worst) worst = low - radial[b];
+    }
+    return worst;
+}
+
+// continuous reference: the profile at the exact tip position taken at
+// a sixteenth of a cell along the move
+static void ref_sweep(struct move *a, struct move *b) {
+    float reach = prof_r[prof_n - 1];
+    float dx = b->x - a->x, dy = b->y - a->y, dz = b->z - a->z;
+    float md = fmaxf(fabsf(dx), fmaxf(fabsf(dy), fabsf(dz)));
+    Uint32 steps = (Uint32)ceilf(md / STEP) * 16;
+    for (Uint32 s=0; s<=steps; s++) {
+        float f = steps ? (float)s / steps : 0;
+        float cx = cell_of(a->x + dx * f), cy = cell_of(a->y + dy * f), z = a->z + dz * f;
+        for (int gx=(int)floorf(cx - reach); gx<=(int)ceilf(cx + reach); gx++)
+        for (int gy=(int)floorf(cy - reach); gy<=(int)ceilf(cy + reach); gy++) {
+            if (gx < 0 || gy < 0 || gx >= GW || gy >= GH) continue;
+            float r = sqrtf((gx - cx) * (gx - cx) + (gy - cy) * (gy - cy));
+            if (r > reach) continue;
+            float tz = z + prof_at(r);
+            if (tz < ref[gx * GH + gy]) ref[gx * GH + gy] = tz;
+        }
+    }
+}
+
+// stamping reference: step_move() at sixteen times its step count
+static void ref_stamp(struct move *a, struct move *b) {
+    float dx = b->x - a->x, dy = b->y - a->y, dz = b->z - a->z;
+    float md = fmaxf(fabsf(dx), fmaxf(fabsf(dy), fabsf(dz)));
+    Uint32 steps = (Uint32)ceilf(md / STEP) * 16;
+    for (Uint32 s=0; s<=steps; s++) {
+        float f = steps ? (float)s / steps : 1;
+        stamp(a->x + dx * f, a->y + dy * f, a->z + dz * f, 0, 0, 0, 0);
+    }
+}
+
+static struct move path[] = {
+    { 2.0f, 2.0f, 4.0f, 0 },
+    { 13.0f, 2.5f, 4.0f, 1 },   // level
+    { 13.5f, 9.0f, 3.2f, 1 },   // ramp down
+    { 4.0f, 10.0f, 4.5f, 1 },   // ramp up
+    { 4.0f, 10.0f, 3.0f, 1 },   // plunge
+    { 7.3f, 6.1f, 3.4f, 1 },    // diagonal
+};
+#define PATH (sizeof(path) / sizeof(path[0]))
+
+int main() {
+    static float got[GW * GH];
+    int fails = 0;
+    float rad = 1.2f;
+    for (int kind=FLAT; kind<=STEPPED; kind++) {
+        struct tcell *cells = (struct tcell *)mem;
+        Uint32 mid, count = profile(kind, rad, cells, &mid);
+        Uint32 i = (count * sizeof(struct tcell) + 15) & ~15;
+        Uint32 g = i + sizeof(path);
+        Uint32 o = g + GW * GH * 4;
+        float *grid = (float *)(mem + g);
+        memcpy(mem + i, path, sizeof(path));
+        tool_init(mem, 0, count, (mid * 2 + 1) * STEP, mid, STEP);
+        float dip = radial_under(cells, count, mid);
+
+        stock_init(mem, g, GW, GH, STEP, TOP);
+        stock_moves(mem, i, PATH, o);
+        memcpy(got, grid, sizeof(got));
+
+        stock_init(mem, g, GW, GH, STEP, TOP);
+        if (tool_convex) {
+            prof_init(cells, count, mid);
+            memcpy(ref, grid, sizeof(ref));
+            for (Uint32 k=1; k<PATH; k++) {
+                ref_sweep(&path[k - 1], &path[k]);
+            }
+        } else {
+            for (Uint32 k=1; k<PATH; k++) {
+                ref_stamp(&path[k - 1], &path[k]);
+            }
+            memcpy(ref, grid, sizeof(ref));
+        }
+
+        // overcut is got below ref, undercut got above it
+        double over = 0, under = 0;
+        for (Uint32 c=0; c<GW*GH; c++) {
+            double e = got[c] - ref[c];
+            if (-e > over) over = -e;
+            if (e > under) under = e;
+        }
+        int concave = kind == CONCAVE || kind == STEPPED;
+        int fail = dip > 1e-5f || (tool_convex ?
+            concave || over > STEP * 0.02f || under > STEP * 0.5f :
+            !concave || over > 1e-5);
+        printf("%-8s cells %4u %s overcut %.5f undercut %.5f radial %.5f %s\n",
+            names[kind], count, tool_convex ? "sweep" : "step ",
+            over, under, dip, fail ? "FAIL" : "ok");
+        fails += fail;
+    }
+    return fails != 0;
+}
@@ -0,0 +1,3 @@
+// stand-in for the emscripten header when the wasm sources are built
+// natively by the test programs in this directory
+#define EMSCRIPTEN_KEEPALIVE
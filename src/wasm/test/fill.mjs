@@ -0,0 +1,175 @@
+/**
+ * compares kiri-geo fill_sparse() with the JS path it replaces: the
+ * fill.js emitter fed through a layerSparseFill() style target and
+ * clipped as an open path by Clipper with an even-odd clip fill. regions
+ * are a plate with a square hole whose edges fall on fill lines, a
+ * diamond and two overlapping squares (even-odd leaves the overlap out).
+ * each layer must give the same pieces within 1e-4 mm at both ends
+ *
+ * node test/fill.mjs (from src/wasm after building the wasm modules)
+ */
+
+import fs from 'fs';
+import { register } from 'module';
+
+// browser only modules pulled in by the fill.js import graph
+const stubs = {
+    'ext/three.js': 'class V{constructor(x=0,y=0,z=0){this.x=x;this.y=y;this.z=z}};class B{};' +
+        'export const THREE=new Proxy({Vector3:V,Vector2:V},{get:(t,k)=>t[k]||B});' +
+        'export const Line2=B,LineSegmentsGeometry=B,LineSegments2=B,LineGeometry=B,LineMaterial=B;',
+    'ext/earcut.js': 'export default function earcut(){return []}',
+    'moto/space.js': 'export const space={world:{add(){}}};',
+    'ext/tween.js': 'export const TWEEN={};',
+    'ext/quickjs.js': 'export function getQuickJS(){}'
+};
+register('data:text/javascript,' + encodeURIComponent(
+    `const stubs = ${JSON.stringify(stubs)};
+    export async function resolve(spec, ctx, next) {
+        for (let [k, v] of Object.entries(stubs)) {
+            if (spec.endsWith(k)) return { url: 'data:text/javascript,' + encodeURIComponent(v), shortCircuit: true };
+        }
+        return next(spec, ctx);
+    }`));
+
+const dir = new URL('..', import.meta.url).pathname;
+
+globalThis.self = globalThis;
+globalThis.navigator = { userAgent: 'node' };
+globalThis.THREE = (await import('../../ext/three.js')).THREE;
+globalThis.fetch = async url => ({
+    ok: true,
+    arrayBuffer: async () => fs.readFileSync(dir + url.replace('/wasm/', ''))
+});
+await import('../../add/array.js');
+await import('../../add/class.js');
+
+const { base } = await import('../../geo/base.js');
+const { wasm_ctrl, fillSparse } = await import('../../geo/wasm.js');
+const { fill } = await import('../../kiri/mode/fdm/work/fill.js');
+const { ClipperLib } = await import('../../ext/clip2.esm.js');
+const { newPoint } = await import('../../geo/point.js');
+const { newPolygon } = await import('../../geo/polygon.js');
+const POLY = await import('../../geo/polygons.js');
+
+wasm_ctrl.enable();
+for (let i = 0; !base.wasm && i < 500; i++) {
+    await new Promise(r => setTimeout(r, 10));
+}
+if (!base.wasm) {
+    console.log('kiri-geo.wasm did not load');
+    process.exit(1);
+}
+
+const ids = { hex: 0, grid: 1, triangle: 2, linear: 3, cubic: 4 };
+const z = 1;
+
+function rect(x0, y0, x1, y1) {
+    return newPolygon().addPoints([
+        newPoint(x0, y0, z), newPoint(x1, y0, z), newPoint(x1, y1, z), newPoint(x0, y1, z)
+    ]);
+}
+
+const plate = rect(0, 0, 60, 50);
+plate.addInner(rect(20, 20, 30, 30).reverse());
+const diamond = newPolygon().addPoints([
+    newPoint(25, 0, z), newPoint(50, 25, z), newPoint(25, 50, z), newPoint(0, 25, z)
+]);
+
+const regions = {
+    plate: [ plate ],
+    diamond: [ diamond ],
+    overlap: [ rect(0, 0, 30, 30), rect(15, 15, 45, 45) ]
+};
+
+// the layerSparseFill() emitter target and clip
+function fillJS(type, polys, index, opt) {
+    let lines = [], line = [];
+    fill[type]({
+        zIndex: () => index,
+        zValue: () => z,
+        zHeight: () => 0.2,
+        lineWidth: () => opt.lineWidth,
+        bounds: () => opt.bounds,
+        offset: () => opt.spacing,
+        density: () => opt.density,
+        repeat: () => opt.repeat,
+        emit: (x, y) => line.push(newPoint(x, y, z)),
+        newline: () => {
+            if (line.length) {
+                lines.push(line);
+                line = [];
+            }
+        }
+    });
+    if (line.length) {
+        lines.push(line);
+    }
+    let clip = new ClipperLib.Clipper(),
+        tree = new ClipperLib.PolyTree(),
+        out = [];
+    clip.AddPaths(lines.map(a => a.map(p => p.toClipper())), ClipperLib.PolyType.ptSubject, false);
+    clip.AddPaths(POLY.toClipper(polys), ClipperLib.PolyType.ptClip, true);
+    if (clip.Execute(ClipperLib.ClipType.ctIntersection, tree,
+        ClipperLib.PolyFillType.pftNonZero, ClipperLib.PolyFillType.pftEvenOdd)) {
+        for (let node of tree.m_AllPolys) {
+            out.push(POLY.fromClipperNode(node, z));
+        }
+    }
+    return out;
+}
+
+// pieces as sorted endpoint pairs so direction and order do not matter
+function ends(polys) {
+    return polys.map(p => {
+        let a = p.first(), b = p.last();
+        return a.x < b.x || (a.x === b.x && a.y < b.y) ? [a, b] : [b, a];
+    }).sort((p, q) => p[0].x - q[0].x || p[0].y - q[0].y || p[1].x - q[1].x || p[1].y - q[1].y);
+}
+
+function same(a, b) {
+    const near = (p, q) => Math.abs(p.x - q.x) < 1e-4 && Math.abs(p.y - q.y) < 1e-4;
+    let miss = b.slice();
+    for (let [p0, p1] of a) {
+        let i = miss.findIndex(([q0, q1]) => near(p0, q0) && near(p1, q1));
+        if (i < 0) {
+            return `${p0.x.toFixed(3)},${p0.y.toFixed(3)} -> ${p1.x.toFixed(3)},${p1.y.toFixed(3)}`;
+        }
+        miss.splice(i, 1);
+    }
+    return miss.length ? 'extra native pieces' : undefined;
+}
+
+let fails = 0;
+
+for (let [name, polys] of Object.entries(regions)) {
+    let bounds = POLY.setZ(polys.slice(), z).reduce((b, p) => {
+        b.min.x = Math.min(b.min.x, p.bounds.minx);
+        b.min.y = Math.min(b.min.y, p.bounds.miny);
+        b.max.x = Math.max(b.max.x, p.bounds.maxx);
+        b.max.y = Math.max(b.max.y, p.bounds.maxy);
+        return b;
+    }, { min: { x: Infinity, y: Infinity }, max: { x: -Infinity, y: -Infinity } });
+    for (let type of Object.keys(ids)) {
+        let opt = { bounds, lineWidth: 0.4, spacing: 0.4, density: 0.15, repeat: 2 };
+        let layers = [0, 1, 2, 3, 4, 5].map(index => ({ z, index, polys }));
+        let native = fillSparse(ids[type], layers, opt);
+        let bad = 0, pieces = 0, diff;
+        layers.forEach(({ index }, i) => {
+            let js = ends(fillJS(type, polys, index, opt));
+            let nat = ends(native[i]);
+            pieces += js.length;
+            let d = same(js, nat) ?? same(nat, js);
+            if (d) {
+                bad++;
+                diff ??= `layer ${index} ${js.length}/${nat.length} ${d}`;
+            }
+        });
+        if (bad) {
+            fails++;
+        }
+        console.log(`${name.padEnd(8)} ${type.padEnd(8)} pieces ${String(pieces).padStart(4)} ${bad ? 'FAIL ' + diff : 'ok'}`);
+    }
+}
+
+console.log(fails ? `FAIL ${fails}` : 'PASS');
+process.exit(fails ? 1 : 0);
@@ -0,0 +1,161 @@
+/**
+ * exercises the kiri-sla raster support planner (slaSupportNative) on
+ * stacked test parts: a T with a plate over a thin stem and a ledge
+ * hanging over a lower block. every pillar must start under an overhang,
+ * never pass through a part layer, overhangs must be covered within the
+ * pillar spacing and pillars clear of the part must reach the raft
+ *
+ * node test/sla.mjs (from src/wasm after building the wasm modules)
+ */
+
+import fs from 'fs';
+import { register } from 'module';
+
+// browser only modules pulled in by the slice.js import graph
+const stubs = {
+    'ext/three.js': 'class V{constructor(x=0,y=0,z=0){this.x=x;this.y=y;this.z=z}};class B{};' +
+        'export const THREE=new Proxy({Vector3:V,Vector2:V},{get:(t,k)=>t[k]||B});' +
+        'export const Line2=B,LineSegmentsGeometry=B,LineSegments2=B,LineGeometry=B,LineMaterial=B;',
+    'ext/earcut.js': 'export default function earcut(){return []}',
+    'moto/space.js': 'export const space={world:{add(){}}};',
+    'ext/tween.js': 'export const TWEEN={};',
+    'ext/quickjs.js': 'export function getQuickJS(){}'
+};
+register('data:text/javascript,' + encodeURIComponent(
+    `const stubs = ${JSON.stringify(stubs)};
+    export async function resolve(spec, ctx, next) {
+        for (let [k, v] of Object.entries(stubs)) {
+            if (spec.endsWith(k)) return { url: 'data:text/javascript,' + encodeURIComponent(v), shortCircuit: true };
+        }
+        return next(spec, ctx);
+    }`));
+
+const dir = new URL('..', import.meta.url).pathname;
+
+globalThis.self = globalThis;
+globalThis.navigator = { userAgent: 'node' };
+globalThis.THREE = (await import('../../ext/three.js')).THREE;
+// a missing simd build makes wasm_load() fall back to the scalar one
+let nosimd = false;
+globalThis.fetch = async url => ({
+    ok: !(nosimd && url.includes('simd')),
+    status: 404,
+    arrayBuffer: async () => fs.readFileSync(dir + url.replace('/wasm/', ''))
+});
+await import('../../add/array.js');
+await import('../../add/class.js');
+
+const { computeSupportsWasm } = await import('../../kiri/mode/sla/work/slice.js');
+const { SLA, wasm_load } = await import('../../kiri/mode/sla/work/init-work.js');
+const { newSlice, newTop } = await import('../../kiri/core/slice.js');
+const { newPoint } = await import('../../geo/point.js');
+const { newPolygon } = await import('../../geo/polygon.js');
+
+const height = 0.05;
+const settings = {
+    slaSlice: height,
+    slaSupportDensity: 0.5,
+    slaSupportSize: 0.6,
+    slaSupportPoints: 6
+};
+const spacing = (1 - settings.slaSupportDensity) * 10;
+
+function rect(x0, y0, x1, y1, z) {
+    return newPolygon().addPoints([
+        newPoint(x0, y0, z), newPoint(x1, y0, z), newPoint(x1, y1, z), newPoint(x0, y1, z)
+    ]);
+}
+
+// parts are lists of [ x0, y0, x1, y1, first layer, last layer ] boxes
+const parts = {
+    tee: [
+        [ 9, 9, 11, 11, 0, 39 ],
+        [ 2, 2, 18, 18, 40, 59 ]
+    ],
+    ledge: [
+        [ 0, 0, 8, 8, 0, 29 ],
+        [ 0, 0, 3, 8, 30, 69 ],
+        [ 0, 0, 16, 8, 70, 89 ]
+    ]
+};
+
+let fails = 0;
+
+function plan(name, boxes, wasm) {
+    // three raft layers and two gap layers below the part as sla_slice()
+    // lays them out, with every slice holding its z and index
+    const raft = 3, gap = 2;
+    const last = Math.max(...boxes.map(b => b[5]));
+    const slices = [];
+    for (let i = 0; i < raft + gap + last + 1; i++) {
+        const z = (i + 0.5) * height;
+        const slice = newSlice(z);
+        slice.index = i;
+        if (i < raft) {
+            slice.synth = true;
+            slice.tops.push(newTop(rect(-2, -2, 20, 20, z)));
+        }
+        const l = i - raft - gap;
+        for (const [ x0, y0, x1, y1, lo, hi ] of boxes) {
+            if (l >= lo && l <= hi) {
+                slice.tops.push(newTop(rect(x0, y0, x1, y1, z)));
+            }
+        }
+        slices.push(slice);
+    }
+    const widget = { slices, lastraft: slices[raft - 1] };
+    // pillar points are grid cell corners so part edges are taken a
+    // cell in (through) or out (floating)
+    const inside = (l, p, pad = 0) => boxes.some(([ x0, y0, x1, y1, lo, hi ]) =>
+        l >= lo && l <= hi && p.x > x0 - pad && p.x < x1 + pad && p.y > y0 - pad && p.y < y1 + pad);
+    const cell = 0.1;
+
+    const t0 = performance.now();
+    const ok = computeSupportsWasm(widget, settings, wasm, () => {});
+    const tn = performance.now() - t0;
+
+    // pillar centers by layer. a pillar starts where the layer above has none
+    let through = 0, floating = 0, pillars = 0, starts = [];
+    for (let i = raft + gap; i < slices.length; i++) {
+        const l = i - raft - gap;
+        for (const { point } of slices[i].pillars || []) {
+            pillars++;
+            if (inside(l, point, -cell)) through++;
+            const above = slices[i + 1]?.pillars || [];
+            if (!above.some(q => q.point.x === point.x && q.point.y === point.y)) {
+                starts.push(point);
+                if (!inside(l + 1, point, cell)) floating++;
+            }
+        }
+    }
+
+    // every overhang point (part cell with no part below) near a pillar start
+    let uncovered = 0, cells = 0;
+    for (let l = 1; l <= last; l++) {
+        for (let x = 0.25; x < 20; x += 0.5)
+        for (let y = 0.25; y < 20; y += 0.5) {
+            const p = { x, y };
+            if (!inside(l, p) || inside(l - 1, p)) continue;
+            cells++;
+            if (!starts.some(q => Math.hypot(q.x - x, q.y - y) <= spacing)) uncovered++;
+        }
+    }
+    const anchored = (widget.lastraft.pillars || []).length;
+    const bad = !ok || !starts.length || through || floating || uncovered || !anchored;
+    console.log(name, 'pillars', starts.length, 'cells', pillars, 'overhang', cells,
+        'uncovered', uncovered, 'through', through, 'floating', floating, 'anchored', anchored,
+        'native', tn.toFixed(1), 'ms', wasm.simd ? 'simd' : 'scalar', bad ? 'FAIL' : 'ok');
+    fails += bad ? 1 : 0;
+}
+
+for (const scalar of [ false, true ]) {
+    nosimd = scalar;
+    SLA.loading = undefined;
+    const wasm = await wasm_load();
+    for (const [ name, boxes ] of Object.entries(parts)) {
+        plan(name, boxes, wasm);
+    }
+}
+
+console.log(fails ? 'FAIL' : 'PASS');
+process.exit(fails ? 1 : 0);
@@ -0,0 +1,86 @@
+/**
+ * compares topo_dilate() with a brute force Probe.toolAtZ() over every
+ * output cell for flat, ball and taper profiles of growing radius, with
+ * profile heights as made by Tool.generateProfile() (zero at the tip,
+ * negative above it). reports the time of both
+ *
+ * cc -O2 -I test -o test/topo-dilate test/topo-dilate.c -lm
+ */
+
+#include "../kiri-topo.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+unsigned char __heap_base;
+void reportf(float a, float b) {}
+void reporti(int a, int b) {}
+
+#define SX 300
+#define SY 240
+#define RES 0.1f
+
+static Uint8 mem[1 << 27];
+
+enum { FLAT, BALL, TAPER };
+static const char *names[] = { "flat", "ball", "taper" };
+
+static double now() {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+int main() {
+    int fails = 0;
+    srand(5);
+    struct topo *g = (struct topo *)mem;
+    *g = (struct topo){ SX, SY, 0, 0, RES, 0.5f };
+    float *in = (float *)(mem + 64);
+    for (Uint32 k=0; k<SX*SY; k++) {
+        Uint32 x = k / SY, y = k % SY;
+        in[k] = rand() % 10 == 0 ? 0 : 2 + sinf(x * 0.05f) * cosf(y * 0.07f) + (rand() % 100) * 0.001f;
+    }
+    Uint32 p = 64 + SX * SY * 4;
+    for (int kind=FLAT; kind<=TAPER; kind++)
+    for (float rad=4; rad<=32; rad*=2) {
+        struct tcell *c = (struct tcell *)(mem + p);
+        int n = 0, reach = 0;
+        for (int dx=-(int)rad; dx<=(int)rad; dx++)
+        for (int dy=-(int)rad; dy<=(int)rad; dy++) {
+            float d = sqrtf((float)(dx * dx + dy * dy));
+            if (d > rad) continue;
+            float dz = kind == FLAT ? 0 :
+                kind == BALL ? (sqrtf(rad * rad - d * d) - rad) * RES :
+                -d * RES * 0.5f;
+            c[n++] = (struct tcell){ dx, dy, dz };
+            if (abs(dx) > reach) reach = abs(dx);
+        }
+        Uint32 o = (p + n * 8 + 15) & ~15;
+        Uint32 oy = SY + 2 * reach;
+        Uint32 s = o + (SX + 2 * reach) * oy * 4;
+        double t0 = now();
+        topo_dilate(mem, 0, 64, o, p, n, reach, s);
+        double tn = now() - t0;
+        float *out = (float *)(mem + o);
+        double md = 0;
+        t0 = now();
+        for (int x=-reach; x<SX+reach; x++)
+        for (int y=-reach; y<SY+reach; y++) {
+            float mz = -INFINITY;
+            for (int k=0; k<n; k++) {
+                int tx = x + c[k].dx, ty = y + c[k].dy;
+                float gv = tx < 0 || ty < 0 || tx >= SX || ty >= SY || in[tx * SY + ty] == 0 ?
+                    g->floor : in[tx * SY + ty];
+                mz = fmaxf(mz, c[k].dz + gv);
+            }
+            mz = fmaxf(mz, g->floor);
+            double e = fabs(mz - out[(x + reach) * oy + y + reach]);
+            if (e > md) md = e;
+        }
+        double tb = now() - t0;
+        int fail = md > 1e-4;
+        printf("%-6s r %2.0f cells %5d native %.3fs brute %.3fs maxdiff %g %s\n",
+            names[kind], rad, n, tn, tb, md, fail ? "FAIL" : "ok");
+        fails += fail;
+    }
+    return fails != 0;
+}
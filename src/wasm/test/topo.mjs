@@ -0,0 +1,206 @@
+/**
+ * compares the kiri-topo kernels with the JS paths in topo3.js they
+ * replace. dilate: dilate_native() against Probe.toolAtZ() at every
+ * cell of the dilated grid for flat, ball and taper profiles. timings
+ * are for both sides. trace: trace_native() against Trace crossX_sync()
+ * and crossY_sync() on both axes with and without curvesOnly, with a
+ * clip polygon with a hole and a tab
+ *
+ * node test/topo.mjs (from src/wasm after building the wasm modules)
+ */
+
+import fs from 'fs';
+import { register } from 'module';
+
+// browser only modules pulled in by the topo3.js import graph
+const stubs = {
+    'ext/three.js': 'class V{constructor(x=0,y=0,z=0){this.x=x;this.y=y;this.z=z}};class B{};' +
+        'export const THREE=new Proxy({Vector3:V,Vector2:V},{get:(t,k)=>t[k]||B});' +
+        'export const Line2=B,LineSegmentsGeometry=B,LineSegments2=B,LineGeometry=B,LineMaterial=B;',
+    'ext/earcut.js': 'export default function earcut(){return []}',
+    'moto/space.js': 'export const space={world:{add(){}}};',
+    'ext/tween.js': 'export const TWEEN={};',
+    'ext/quickjs.js': 'export function getQuickJS(){}'
+};
+register('data:text/javascript,' + encodeURIComponent(
+    `const stubs = ${JSON.stringify(stubs)};
+    export async function resolve(spec, ctx, next) {
+        for (let [k, v] of Object.entries(stubs)) {
+            if (spec.endsWith(k)) return { url: 'data:text/javascript,' + encodeURIComponent(v), shortCircuit: true };
+        }
+        return next(spec, ctx);
+    }`));
+
+globalThis.self = globalThis;
+globalThis.navigator = { userAgent: 'node' };
+globalThis.THREE = (await import('../../ext/three.js')).THREE;
+
+const { Probe, Trace, dilate_native, trace_native } = await import('../../kiri/mode/cam/work/topo3.js');
+const { newPoint } = await import('../../geo/point.js');
+const { newPolygon } = await import('../../geo/polygon.js');
+
+const dir = new URL('..', import.meta.url).pathname;
+const res = 0.1;
+const stepsX = 300, stepsY = 240, zMin = 0.5;
+
+let fails = 0;
+let seed = 7;
+const rnd = () => (seed = (seed * 16807) % 2147483647) / 2147483647;
+
+// terrain with holes (no data) which probe as zMin
+const data = new Float32Array(stepsX * stepsY);
+for (let x = 0; x < stepsX; x++)
+for (let y = 0; y < stepsY; y++) {
+    data[x * stepsY + y] = rnd() < 0.05 ? 0 :
+        2 + Math.sin(x * 0.05) * Math.cos(y * 0.07) + (x > 100 && x < 140 ? 1.5 : 0);
+}
+
+// x, y cell offsets and z offsets as made by Tool.generateProfile()
+function profile(kind, rad) {
+    const out = [];
+    for (let x = -rad; x <= rad; x++)
+    for (let y = -rad; y <= rad; y++) {
+        const d = Math.hypot(x, y);
+        if (d > rad) continue;
+        out.push(x, y, kind === 'flat' ? 0 :
+            kind === 'ball' ? (Math.sqrt(rad * rad - d * d) - rad) * res :
+            -d * res * 0.5);
+    }
+    return out;
+}
+
+async function instance(file) {
+    const bytes = fs.readFileSync(dir + file);
+    const { instance } = await WebAssembly.instantiate(bytes, {
+        env: { reportf() {}, reporti() {} }
+    });
+    const { exports } = instance;
+    const base = exports.heap_base();
+    return {
+        base,
+        exports,
+        memory: exports.memory,
+        heap: new Uint8Array(exports.memory.buffer, base),
+        view: new DataView(exports.memory.buffer, base)
+    };
+}
+
+function dilate(name, wasm) {
+    for (const kind of ['flat', 'ball', 'taper'])
+    for (const rad of [4, 8, 16, 32, 64]) {
+        // the simd build takes the concave path from r 48. probe every
+        // 7th column past r 32 to keep the JS side short
+        const every = rad > 32 ? 7 : 1;
+        const params = { data, profile: profile(kind, rad), stepsX, stepsY, zMin };
+        const probe = new Probe(params);
+        let t0 = performance.now();
+        const { dilated, reach } = dilate_native(wasm, params);
+        const tn = performance.now() - t0;
+        const oy = stepsY + reach * 2;
+        let md = 0;
+        t0 = performance.now();
+        for (let x = -reach; x < stepsX + reach; x += every)
+        for (let y = -reach; y < stepsY + reach; y++) {
+            const e = Math.abs(probe.toolAtZ(x, y) - dilated[(x + reach) * oy + y + reach]);
+            if (e > md) md = e;
+        }
+        const tj = performance.now() - t0;
+        const fail = md > 1e-4;
+        console.log(name, kind.padEnd(5), 'r', String(rad).padStart(2),
+            'native', tn.toFixed(1), 'ms js', tj.toFixed(1), 'ms maxdiff', md, fail ? 'FAIL' : 'ok');
+        fails += fail;
+    }
+}
+
+function ring(points) {
+    return newPolygon().addPoints(points.map(([x, y]) => newPoint(x, y, 0)));
+}
+
+function same(a, b) {
+    return Math.abs(a.x - b.x) <= 1e-4 && Math.abs(a.y - b.y) <= 1e-4 && Math.abs(a.z - b.z) <= 1e-4;
+}
+
+// same scan lines as Topo.generate() with a ball end mill
+function trace(name, wasm) {
+    const stepsX = 120, stepsY = 90, boundsX = 12, boundsY = 9, minX = 0, minY = 0;
+    const data = new Float32Array(stepsX * stepsY);
+    for (let x = 0; x < stepsX; x++)
+    for (let y = 0; y < stepsY; y++) {
+        data[x * stepsY + y] = rnd() < 0.05 ? 0 :
+            2 + Math.sin(x * 0.08) * Math.cos(y * 0.11) + (x > 50 && x < 70 ? 1.5 : 0);
+    }
+    const outer = ring([[-0.5, -0.5], [12.3, -0.2], [12.5, 9.4], [5, 10], [-0.7, 9.2]]);
+    outer.addInner(ring([[4, 3], [6, 3.2], [5.5, 5.1], [4.1, 5]]));
+    const tab = ring([[8, -1], [9, -1], [9, 10], [8, 10]]);
+    const box = { min: { x: -1, y: -1 }, max: { x: 12.6, y: 9.7 } };
+    const partOff = 0.5, gridDelta = 5, toolStep = 0.35, tabHeight = 3;
+    for (const curvesOnly of [false, true])
+    for (const density of [1, 2])
+    for (const axis of [0, 1]) {
+        const params = { profile: profile('ball', 8), data, stepsX, stepsY, boundsX, boundsY, minX, minY, zMin: 0.0001 };
+        const trace = new Trace(new Probe(params), { curvesOnly, maxangle: 50, flatness: 0.02, bridge: 0, contourX: !axis });
+        trace.init({ box, leave: 0.1, clipTo: [outer], clipTab: [tab], clipTabZ: [2.6], tabHeight, resolution: res, density });
+        const A = axis ? 'x' : 'y';
+        const lo = axis ? minX : minY, hi = axis ? boundsX : boundsY;
+        const flo = axis ? minY : minX, fhi = axis ? boundsY : boundsX;
+        const span = axis ? boundsX : boundsY, steps = axis ? stepsX : stepsY;
+        const scans = [], js = [];
+        let t0 = performance.now();
+        for (let v = lo - partOff; v <= hi + partOff; v += toolStep) {
+            if (v < box.min[A] || v > box.max[A]) continue;
+            const grid = Math.round(((v - lo) / span) * steps);
+            const cross = { from: flo - partOff, to: fhi + partOff };
+            scans.push({ at: v, grid });
+            if (axis) {
+                trace.crossY_sync({ ...cross, x: v, gridx: grid, gridy: -gridDelta }, polys => js.push(polys));
+            } else {
+                trace.crossX_sync({ ...cross, y: v, gridx: -gridDelta, gridy: grid }, polys => js.push(polys));
+            }
+        }
+        const tj = performance.now() - t0;
+        t0 = performance.now();
+        Object.assign(params, dilate_native(wasm, params));
+        const nat = trace_native(wasm, params, {
+            density, curvesOnly, maxangle: 50, flatness: 0.02, leave: 0.1, tabHeight,
+            step: res * density, grid: -gridDelta, axis,
+            from: flo - partOff, to: fhi + partOff,
+            boxMin: box.min[axis ? 'y' : 'x'], boxMax: box.max[axis ? 'y' : 'x']
+        }, scans, [outer], [tab]);
+        const tn = performance.now() - t0;
+        const byScan = new Map(nat.map(rec => [rec.scan, rec.polys]));
+        let bad = 0, lines = 0, points = 0;
+        js.forEach((polys, i) => {
+            const np = byScan.get(i) || [];
+            if (np.length !== polys.length) {
+                bad++;
+                return;
+            }
+            polys.forEach((poly, k) => {
+                const a = poly.points, b = np[k].points;
+                lines++;
+                points += a.length;
+                if (a.length !== b.length || a.some((p, j) => !same(p, b[j]))) {
+                    bad++;
+                }
+            });
+        });
+        console.log(name, 'trace', axis ? 'y' : 'x', 'density', density, curvesOnly ? 'curves' : 'all   ',
+            'lines', lines, 'points', points, 'native', tn.toFixed(1), 'ms js', tj.toFixed(1), 'ms',
+            bad ? `FAIL ${bad} lines differ` : 'ok');
+        fails += bad;
+    }
+}
+
+for (const file of ['kiri-topo.wasm', 'kiri-topo-simd.wasm']) {
+    const name = file.replace('.wasm', '');
+    if (!WebAssembly.validate(fs.readFileSync(dir + file))) {
+        console.log(name, 'not supported here');
+        continue;
+    }
+    const wasm = await instance(file);
+    dilate(name, wasm);
+    trace(name, wasm);
+}
+
+console.log(fails ? 'FAIL' : 'PASS');
+process.exit(fails ? 1 : 0);
@@ -362,6 +362,8 @@ self.lang['en-us'] = {
     sl_lahi_l:      ["height of each slice","layer in millimeters"],
     ad_minl_s:      "layer minimum",
     ad_minl_l:      ["adaptive min layer height","in millimeters","must be non-zero"],
+    ad_cusp_s:      "cusp error",
+    ad_cusp_l:      ["adaptive max stair step error","on sloped surfaces","in millimeters","smaller for finer layers"],
     ad_adap_s:      "adaptive height",
     ad_adap_l:      ["use adaptive layer heights","with 'layer height' as max","and 'layer min' as the min"],
     sl_ltop_s:      "top layers",
@@ -999,6 +1001,8 @@ self.lang['en-us'] = {
     sa_slsz_l:      ["max size of a","support pillar","in millimeters"],
     sa_slpt_s:      "points",
     sa_slpt_l:      ["number of points in","each support pillar","in millimeters"],
+    sa_slnt_s:      "raster plan",
+    sa_slnt_l:      ["plan pillars on layer bitmaps","much faster on large parts","pillars on a fixed grid","without mass based selection"],
     sl_slen_l:      "enable supports",
 
     sa_outp_m:      "output",
@@ -1006,6 +1010,14 @@ self.lang['en-us'] = {
     sa_opzo_l:      ["z layer offset","almost always 0.0","0.0-1.0 in millimeters"],
     sa_opaa_s:      "anti alias",
     sa_opaa_l:      ["enable anti-aliasing","produces larger files","can blur details"],
+    sa_cpbl_s:      "comp layers",
+    sa_cpbl_l:      ["number of bottom layers","using base erosion","0 = disabled"],
+    sa_cpbe_s:      "base erosion",
+    sa_cpbe_l:      ["elephant foot compensation","shrinks bottom layer images","in millimeters"],
+    sa_cper_s:      "erosion",
+    sa_cper_l:      ["light bleed compensation","shrinks all other layer images","negative values grow them","in millimeters"],
+    sa_cpbr_s:      "edge blur",
+    sa_cpbr_l:      ["edge exposure gradient","dims pixels inside part edges","photon needs anti alias above 1","in millimeters, 0 = disabled"],
 
     // EXPORT DIALOG
     ex_job:         "job",